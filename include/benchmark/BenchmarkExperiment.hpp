@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "core/Experiment.hpp"
+#include "core/Primitive.hpp"
 #include "benchmark/NomosBenchmark.hpp"
 
 extern "C" {
@@ -32,9 +33,12 @@ public:
             return -1;
         }
 
-        // Set elliptic curve
-        if (ep_param_set_any_pairf() != RLC_OK) {
-            std::cerr << "Failed to set elliptic curve" << std::endl;
+        // Set elliptic curve (selected with --curve, pairing by default)
+        try {
+            UseCurve(DefaultCurve());
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to set elliptic curve: " << e.what()
+                      << std::endl;
             return -1;
         }
 
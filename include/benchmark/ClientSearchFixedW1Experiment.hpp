@@ -5,6 +5,7 @@
 
 #include "benchmark/DatasetLoader.hpp"
 #include "core/Experiment.hpp"
+#include "nomos/PipelinedSearch.hpp"
 
 namespace nomos {
 namespace benchmark {
@@ -22,12 +23,18 @@ class ClientSearchFixedW1Experiment : public core::Experiment {
   void setRunAllDatasets(bool value);
   void setOutputDir(const std::string& output_dir);
   void setSchemeFilter(const std::string& scheme_filter);
+  void setServerThreads(size_t server_threads);
+  void setClientThreads(size_t client_threads);
+  /** @brief Also run Nomos through PipelinedSearch with this chunk size; 0
+   * (default) skips it. */
+  void setPipelineChunk(size_t chunk_slots);
 
  private:
   struct SweepResult {
     std::vector<double> client_times;
     std::vector<double> gatekeeper_times;
     std::vector<double> server_times;
+    std::vector<PipelinedSearch::Stats> pipeline_stats;  // Nomos only
   };
 
   struct ClientSearchRow {
@@ -51,6 +58,9 @@ class ClientSearchFixedW1Experiment : public core::Experiment {
   bool run_all_datasets_;
   std::string output_dir_;
   std::string scheme_filter_;
+  size_t server_threads_;
+  size_t client_threads_;
+  size_t pipeline_chunk_;
 
   std::vector<DatasetLoader::Dataset> getDatasetsToRun() const;
   bool shouldRunScheme(const std::string& scheme_name) const;
@@ -60,6 +70,9 @@ class ClientSearchFixedW1Experiment : public core::Experiment {
   void writeSchemeCsv(const std::string& output_dir, const std::string& scheme,
                       const std::vector<ClientSearchRow>& rows,
                       const std::string& time_column) const;
+  void writePipelineCsv(
+      const std::vector<ClientSearchRow>& rows,
+      const std::vector<PipelinedSearch::Stats>& pipeline_stats) const;
 
   SweepResult runNomosSweep(const DatasetSpec& spec) const;
   SweepResult runMcOdxtSweep(const DatasetSpec& spec) const;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "core/Experiment.hpp"
+#include "core/QueryPlanner.hpp"
+
+namespace nomos {
+namespace benchmark {
+
+/**
+ * @brief Nomos server search time for n = 3..8 keyword conjunctions, with the
+ * x-terms in input order (broadest first) vs ascending update count.
+ *
+ * Synthetic data: the s-term has s_term_updates documents and x-term k
+ * matches s_term_updates >> k of them, padded with other documents so the
+ * more selective x-terms also have the smaller update counts.
+ */
+class ConjunctionOrderExperiment : public core::Experiment {
+ public:
+  ConjunctionOrderExperiment();
+
+  int setup() override;
+  void run() override;
+  void teardown() override;
+  std::string getName() const override;
+
+  void setOutputDir(const std::string& output_dir);
+  void setServerThreads(size_t server_threads);
+  void setSTermUpdates(size_t s_term_updates);
+
+ private:
+  struct OrderRow {
+    size_t num_keywords;
+    std::string order;
+    double server_time_ms;
+    size_t results;
+  };
+
+  OrderRow measure(size_t num_keywords, core::XTermOrder order) const;
+  void writeCsv(const std::vector<OrderRow>& rows) const;
+
+  std::string output_dir_;
+  size_t server_threads_;
+  size_t s_term_updates_;
+};
+
+}  // namespace benchmark
+}  // namespace nomos
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace core {
+
+/**
+ * @brief Compressed group element held inline (POD, no heap allocation).
+ *
+ * Every supported curve compresses to kBytes (sign byte plus 32-byte x
+ * coordinate); the point at infinity is encoded as all zeros. Filled by
+ * SerializePoint / CompressPoint in core/Primitive.hpp.
+ */
+struct CompressedPoint {
+  static const size_t kBytes = 33;
+
+  uint8_t bytes[kBytes];
+
+  const uint8_t* data() const { return bytes; }
+  static size_t size() { return kBytes; }
+
+  /** @brief Byte string form, for interfaces still keyed by std::string. */
+  std::string str() const {
+    return std::string(reinterpret_cast<const char*>(bytes), kBytes);
+  }
+};
+
+inline bool operator==(const CompressedPoint& a, const CompressedPoint& b) {
+  return std::memcmp(a.bytes, b.bytes, CompressedPoint::kBytes) == 0;
+}
+
+inline bool operator!=(const CompressedPoint& a, const CompressedPoint& b) {
+  return !(a == b);
+}
+
+inline bool operator<(const CompressedPoint& a, const CompressedPoint& b) {
+  return std::memcmp(a.bytes, b.bytes, CompressedPoint::kBytes) < 0;
+}
+
+/**
+ * @brief Hash for unordered containers. The x coordinate of a hashed-to-curve
+ * point is already uniform, so eight of its bytes are used directly.
+ */
+struct CompressedPointHash {
+  size_t operator()(const CompressedPoint& p) const {
+    uint64_t h;
+    std::memcpy(&h, p.bytes + 1, sizeof(h));
+    return static_cast<size_t>(h ^ p.bytes[0]);
+  }
+};
+
+}  // namespace core
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/CompressedPoint.hpp"
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+namespace core {
+
+/**
+ * @brief Open-addressing TSet: addr -> (val, alpha).
+ *
+ * Keys are compressed curve points stored inline (up to kKeyBytes), alpha is
+ * stored inline as a kScalarBytes big-endian scalar, and val bytes live in one
+ * shared arena. A parallel one-byte control array holds a 7-bit hash tag per
+ * slot, so a probe usually touches one control byte and one slot.
+ *
+ * Inserting an existing key overwrites its (val, alpha), matching the
+ * std::map assignment semantics the servers relied on. Entries are never
+ * erased.
+ */
+class FlatTSet {
+ public:
+  static const size_t kKeyBytes = 33;
+  static const size_t kScalarBytes = 32;
+
+  /**
+   * @brief Read-only view of one entry.
+   *
+   * Points into the table; any insert may invalidate it.
+   */
+  struct Entry {
+    const uint8_t* val;
+    size_t val_len;
+    const uint8_t* alpha;  // kScalarBytes, big-endian
+
+    Entry() : val(nullptr), val_len(0), alpha(nullptr) {}
+
+    bool found() const { return alpha != nullptr; }
+    std::vector<uint8_t> copyVal() const {
+      return std::vector<uint8_t>(val, val + val_len);
+    }
+    void readAlpha(bn_t out) const { bn_read_bin(out, alpha, kScalarBytes); }
+  };
+
+  /** @brief Input record for bulkBuild; all pointers must outlive the call. */
+  struct Record {
+    const uint8_t* key;
+    size_t key_len;
+    const std::vector<uint8_t>* val;
+    const bn_st* alpha;
+  };
+
+  FlatTSet();
+
+  size_t size() const { return m_size; }
+  size_t capacity() const { return m_ctrl.size(); }
+
+  /** @brief Bytes held by the table and arena (excluding object header). */
+  size_t memoryBytes() const;
+
+  /**
+   * @brief Inserts or overwrites key -> (val, alpha).
+   * Throws std::invalid_argument if the key exceeds kKeyBytes or alpha does
+   * not fit kScalarBytes.
+   */
+  void insert(const std::string& key, const std::vector<uint8_t>& val,
+              const bn_t alpha);
+  void insert(const CompressedPoint& key, const std::vector<uint8_t>& val,
+              const bn_t alpha);
+
+  /**
+   * @brief Initial-load path: sizes the table and arena once for all records
+   * and inserts them without intermediate rehashing.
+   */
+  void bulkBuild(const std::vector<Record>& records);
+
+  /** @brief Single lookup; Entry::found() is false on a miss. */
+  Entry find(const std::string& key) const;
+  Entry find(const CompressedPoint& key) const;
+
+  /**
+   * @brief Looks up every key, prefetching control bytes and slots a few
+   * keys ahead so the misses for a whole stokenList overlap.
+   */
+  std::vector<Entry> findBatch(const std::vector<std::string>& keys) const;
+  std::vector<Entry> findBatch(const std::vector<CompressedPoint>& keys) const;
+  std::vector<Entry> findBatch(const CompressedPoint* keys, size_t count) const;
+
+ private:
+  struct KeyRef {
+    const uint8_t* data;
+    size_t len;
+  };
+  struct Slot {
+    uint8_t key[kKeyBytes];
+    uint8_t key_len;
+    uint8_t alpha[kScalarBytes];
+    uint32_t val_len;
+    uint64_t val_offset;
+  };
+
+  static uint64_t hashKey(const uint8_t* key, size_t len);
+  static uint8_t tagOf(uint64_t hash) {
+    return static_cast<uint8_t>(0x80 | (hash >> 57));
+  }
+
+  size_t locate(const uint8_t* key, size_t len, uint64_t hash) const;
+  void insertHashed(const uint8_t* key, size_t len, uint64_t hash,
+                    const uint8_t* val, size_t val_len, const bn_t alpha);
+  void rehash(size_t new_capacity);
+  void reserveSlots(size_t entries);
+  Entry entryAt(size_t index) const;
+  std::vector<Entry> findRefs(const std::vector<KeyRef>& keys) const;
+
+  std::vector<uint8_t> m_ctrl;  // 0 = empty, otherwise 0x80 | 7-bit tag
+  std::vector<Slot> m_slots;
+  std::vector<uint8_t> m_arena;
+  size_t m_size;
+};
+
+}  // namespace core
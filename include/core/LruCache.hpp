@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace core {
+
+/**
+ * @brief Least-recently-used map bounded by a byte budget.
+ *
+ * Callers report the size of each value on insert() and again through
+ * resize() after growing it in place. Whenever the total exceeds the budget,
+ * the least recently used entries are evicted. An entry that alone exceeds
+ * the budget is not kept. find() and insert() mark an entry as most recently
+ * used. A pointer returned by find() or insert() stays valid until that entry
+ * is evicted, replaced or erased.
+ *
+ * Not thread-safe.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+ public:
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    Stats() : hits(0), misses(0), evictions(0) {}
+  };
+
+  explicit LruCache(size_t max_bytes) : m_max_bytes(max_bytes), m_bytes(0) {}
+
+  /** @brief Returns the cached value (counted as a hit) or nullptr (a miss). */
+  Value* find(const Key& key) {
+    typename Index::iterator it = m_index.find(key);
+    if (it == m_index.end()) {
+      ++m_stats.misses;
+      return nullptr;
+    }
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &it->second->value;
+  }
+
+  /**
+   * @brief Inserts or replaces key -> value costing @p bytes.
+   * @return The stored value, or nullptr if it alone exceeds the budget.
+   */
+  Value* insert(const Key& key, Value value, size_t bytes) {
+    erase(key);
+    if (bytes > m_max_bytes) {
+      return nullptr;
+    }
+    m_entries.push_front(Entry(key, std::move(value), bytes));
+    m_index[key] = m_entries.begin();
+    m_bytes += bytes;
+    evictOver(m_entries.begin());
+    return &m_entries.front().value;
+  }
+
+  /**
+   * @brief Records a new size for an existing entry and evicts others as
+   * needed. Returns false (and drops the entry) if it alone exceeds the
+   * budget.
+   */
+  bool resize(const Key& key, size_t bytes) {
+    typename Index::iterator it = m_index.find(key);
+    if (it == m_index.end()) {
+      return false;
+    }
+    if (bytes > m_max_bytes) {
+      erase(key);
+      ++m_stats.evictions;
+      return false;
+    }
+    m_bytes = m_bytes - it->second->bytes + bytes;
+    it->second->bytes = bytes;
+    evictOver(it->second);
+    return true;
+  }
+
+  void erase(const Key& key) {
+    typename Index::iterator it = m_index.find(key);
+    if (it == m_index.end()) {
+      return;
+    }
+    m_bytes -= it->second->bytes;
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+
+  void clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+  }
+
+  size_t size() const { return m_entries.size(); }
+  size_t bytes() const { return m_bytes; }
+  size_t maxBytes() const { return m_max_bytes; }
+  const Stats& stats() const { return m_stats; }
+
+ private:
+  struct Entry {
+    Key key;
+    Value value;
+    size_t bytes;
+
+    Entry(const Key& key_in, Value value_in, size_t bytes_in)
+        : key(key_in), value(std::move(value_in)), bytes(bytes_in) {}
+  };
+
+  typedef std::list<Entry> Entries;
+  typedef std::unordered_map<Key, typename Entries::iterator, Hash> Index;
+
+  // Evicts from the cold end until within budget, never touching @p keep.
+  void evictOver(typename Entries::iterator keep) {
+    while (m_bytes > m_max_bytes && !m_entries.empty()) {
+      typename Entries::iterator victim = --m_entries.end();
+      if (victim == keep) {
+        break;
+      }
+      m_bytes -= victim->bytes;
+      m_index.erase(victim->key);
+      m_entries.erase(victim);
+      ++m_stats.evictions;
+    }
+  }
+
+  Entries m_entries;  // most recently used first
+  Index m_index;
+  size_t m_max_bytes;
+  size_t m_bytes;
+  Stats m_stats;
+};
+
+}  // namespace core
@@ -2,19 +2,47 @@
 
 #include <gmpxx.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include "core/CompressedPoint.hpp"
+
 extern "C" {
+#include <openssl/evp.h>
 #include <relic/relic.h>
 };
 
+namespace core {
+class WorkerPool;
+}  // namespace core
+
 // Naming convention:
 // - Hash_*: unkeyed hash / hash-to-curve / hash-to-field helpers.
 // - F: string-valued PRF implemented as HMAC-SHA256.
 // - F_p: scalar-valued PRF implemented as HMAC-SHA256 followed by Hash_Zn.
 // - OPRF: historical protocol path, not used in the current experimental build.
 
+// Curve backends. No scheme uses a pairing, so the plain prime-order curves
+// are drop-in replacements for the pairing-friendly default. Every role reads
+// the curve from its thread's RELIC context (and WorkerPool copies it), so one
+// UseCurve() call configures gatekeeper, client and server alike.
+enum class Curve { Pairing, Secp256k1, P256 };
+
+// Accepts "pairing", "secp256k1" and "p256"; throws std::invalid_argument.
+Curve ParseCurve(const std::string& name);
+const char* CurveName(Curve curve);
+
+// Loads the curve into the calling thread's RELIC context and records it as
+// DefaultCurve(). Throws std::runtime_error if this RELIC build lacks it
+// (secp256k1 and P-256 need FP_PRIME=256).
+void UseCurve(Curve curve);
+Curve DefaultCurve();
+
+// Serialization sizes of the active curve: compressed point and scalar.
+size_t PointBytes();
+size_t ScalarBytes();
+
 // Unkeyed hash-to-curve helpers used by Nomos and related experiments.
 void Hash_H1(ep_t out, const std::string& in);
 void Hash_H2(ep_t out, const std::string& in);
@@ -22,6 +50,13 @@ void Hash_G1(ep_t out, const std::string& in);
 void Hash_G2(ep_t out, const std::string& in);
 void Hash_G2(ep2_t out, const std::string& in);
 
+// Batch form of Hash_H1 over the counter-indexed inputs "keyword|j|domain"
+// for j = first, ..., first + count - 1, written to out[0..count). Inputs are
+// formatted in place in a reused buffer (no stringstream), and the hashing is
+// split across pool when one is given. Equal to calling Hash_H1 on each input.
+void Hash_H1_Batch(ep_t* out, const std::string& keyword, int first,
+                   size_t count, int domain, core::WorkerPool* pool = nullptr);
+
 // Unkeyed hash-to-field helper.
 void Hash_Zn(bn_t out, const std::string& in);
 
@@ -32,6 +67,19 @@ std::string SerializeBn(const bn_t in);
 std::string SerializePoint(const ep_t point);
 void DeserializePoint(ep_t point, const std::string& data);
 
+// Fixed-size forms: write into a caller-provided CompressedPoint instead of a
+// heap string. Throw std::runtime_error if the active curve does not compress
+// to CompressedPoint::kBytes.
+void SerializePoint(const ep_t point, core::CompressedPoint* out);
+core::CompressedPoint CompressPoint(const ep_t point);
+void DeserializePoint(ep_t point, const core::CompressedPoint& in);
+
+// Encodes points[0..count) into out[0..count). Points still in projective
+// form (e.g. ep_add results) are normalized together with one shared field
+// inversion (ep_norm_sim) instead of one inversion each; the points are
+// normalized in place.
+void SerializePoints(ep_t* points, size_t count, core::CompressedPoint* out);
+
 // Low-level HMAC helper shared by F and F_p.
 std::string HmacSha256(const std::string& key, const std::string& in);
 
@@ -42,3 +90,78 @@ std::string F(const bn_t key, const std::string& in);
 // Scalar-valued PRF used for F_p in the paper.
 void F_p(bn_t out, const std::string& key, const std::string& in);
 void F_p(bn_t out, const bn_t key, const std::string& in);
+
+// F / F_p under one fixed key. The HMAC-SHA256 key schedule runs once: the
+// SHA-256 states after absorbing key^ipad and key^opad are kept and cloned for
+// every input, and the curve order used by F_p's Hash_Zn step is cached.
+// Outputs equal F(key, in) and F_p(key, in). The order is read at
+// construction, so rebuild the object after UseCurve(). Const methods may be
+// called concurrently.
+class KeyedPrf {
+ public:
+  explicit KeyedPrf(const std::string& key);
+  explicit KeyedPrf(const bn_t key);
+  ~KeyedPrf();
+
+  KeyedPrf(const KeyedPrf&) = delete;
+  KeyedPrf& operator=(const KeyedPrf&) = delete;
+
+  std::string F(const std::string& in) const;
+  void F_p(bn_t out, const std::string& in) const;
+
+  // out[i] = F_p(key, inputs[i]); reuses one digest context for the batch.
+  void F_p_Batch(bn_t* out, const std::vector<std::string>& inputs) const;
+
+ private:
+  void init(const std::string& key);
+  void mac(EVP_MD_CTX* scratch, const std::string& in,
+           unsigned char* out) const;
+  void toScalar(bn_t out, const unsigned char* mac) const;
+
+  EVP_MD_CTX* m_inner;
+  EVP_MD_CTX* m_outer;
+  bn_t m_order;
+};
+
+// Owning array of RELIC points (ep_new on construction, ep_free on
+// destruction), for per-batch temporaries passed to SerializePoints.
+class PointBuffer {
+ public:
+  explicit PointBuffer(size_t count);
+  ~PointBuffer();
+
+  PointBuffer(const PointBuffer&) = delete;
+  PointBuffer& operator=(const PointBuffer&) = delete;
+
+  size_t size() const { return m_count; }
+  ep_t* data() { return m_points; }
+  ep_st* operator[](size_t i) { return m_points[i]; }
+  const ep_st* operator[](size_t i) const { return m_points[i]; }
+
+ private:
+  ep_t* m_points;
+  size_t m_count;
+};
+
+// Fixed-base scalar multiplication for a point raised to many scalars.
+// Precomputes RELIC's ep_mul_pre table once so each mul() uses ep_mul_fix
+// instead of a full variable-base ep_mul. mul() only reads the table, so one
+// instance may be shared by threads that each own a RELIC context.
+class FixedBasePoint {
+ public:
+  explicit FixedBasePoint(const ep_t base);
+  explicit FixedBasePoint(const std::string& serialized_base);
+  explicit FixedBasePoint(const core::CompressedPoint& base);
+  ~FixedBasePoint();
+
+  FixedBasePoint(const FixedBasePoint&) = delete;
+  FixedBasePoint& operator=(const FixedBasePoint&) = delete;
+
+  // out = base^k
+  void mul(ep_t out, const bn_t k) const;
+
+ private:
+  void precompute(const ep_t base);
+
+  ep_t* m_table;
+};
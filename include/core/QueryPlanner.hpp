@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+/** @brief Order of the x-terms (query positions 1..n-1) in a token request */
+enum class XTermOrder {
+  kInput,           // as given by the caller
+  kAscendingCount,  // fewest updates first, so failing slots exit early
+};
+
+/**
+ * @brief Reorders a conjunctive query in place before genToken.
+ *
+ * The keyword with the fewest updates (the first one on ties) is swapped to
+ * position 0 as the s-term. The remaining x-terms are then arranged per
+ * @p order, keeping input order among equal counts. A keyword missing from
+ * @p counts has 0 updates. Conjunction is order-independent, so only the
+ * cost of a search changes.
+ */
+void PlanQuery(std::vector<std::string>* keywords,
+               const std::unordered_map<std::string, int>& counts,
+               XTermOrder order);
+
+}  // namespace core
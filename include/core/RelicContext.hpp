@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+namespace core {
+
+/**
+ * @brief Reports whether this RELIC build keeps one core context per thread.
+ *
+ * RELIC only supports concurrent use when it was built with MULTI=PTHREAD (or
+ * OPENMP). With MULTI=NONE every thread shares one global context, so the
+ * worker pool falls back to running everything on the calling thread. The
+ * probe runs once per process; the caller must already own a context.
+ */
+bool RelicHasThreadLocalContext();
+
+/**
+ * @brief Loads curve parameters into the calling thread's context.
+ *
+ * No-op when the context already uses @p ep_param. Throws std::runtime_error
+ * if RELIC rejects the parameter set.
+ */
+void EnsureRelicParams(int ep_param);
+
+/**
+ * @brief RAII owner of the calling thread's RELIC context.
+ *
+ * Initializes a context if this thread has none and loads @p ep_param into
+ * it. The context is released on destruction only if this object created it,
+ * so the guard is safe to nest on threads that already own a context.
+ */
+class ScopedRelicContext {
+ public:
+  explicit ScopedRelicContext(int ep_param);
+  ~ScopedRelicContext();
+
+  ScopedRelicContext(const ScopedRelicContext&) = delete;
+  ScopedRelicContext& operator=(const ScopedRelicContext&) = delete;
+
+  bool ownsContext() const { return m_owned; }
+
+ private:
+  bool m_owned;
+};
+
+/**
+ * @brief Fixed-size pool whose threads each own a RELIC context.
+ *
+ * The calling thread takes part in every parallelFor, so a pool of N threads
+ * spawns N-1 workers. Before running a task each worker loads the caller's
+ * curve parameters (ep_param_get()) into its own context, so any RELIC call
+ * made inside the body sees the same curve as the caller.
+ *
+ * Work is split into one contiguous range per participant. A participant
+ * takes grain-sized chunks from the front of its own range and, once that is
+ * empty, steals the back half of another participant's range, so uneven
+ * per-item cost (e.g. TSet misses next to full cross-filter checks) evens out.
+ *
+ * Nested parallelFor calls from inside a body run inline. Calls from
+ * different external threads are serialized.
+ */
+class WorkerPool {
+ public:
+  using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+  /**
+   * @param num_threads Total participants including the caller. 0 selects
+   * std::thread::hardware_concurrency().
+   */
+  explicit WorkerPool(size_t num_threads = 1);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /** @brief Number of threads that execute work, including the caller. */
+  size_t concurrency() const { return m_workers.size() + 1; }
+
+  /**
+   * @brief Runs @p body over [0, count) in chunks of at most @p grain items.
+   *
+   * Blocks until every chunk has finished. The first exception thrown by a
+   * body is rethrown on the calling thread after all chunks have stopped.
+   */
+  void parallelFor(size_t count, size_t grain, const RangeFn& body);
+
+ private:
+  // Remaining [begin, end) of one participant. Owners pop from the front,
+  // thieves split off the back half.
+  struct WorkRange {
+    std::mutex mutex;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Job {
+    const RangeFn* body;
+    size_t grain;
+    int ep_param;
+    std::unique_ptr<WorkRange[]> ranges;
+    size_t num_ranges;
+    std::atomic<bool> cancelled;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+  };
+
+  void workerLoop(size_t participant);
+  void runChunks(Job& job, size_t participant);
+  static bool takeChunk(Job& job, size_t participant, size_t* begin,
+                        size_t* end);
+  static void recordError(Job& job);
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_submit_mutex;
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+  Job* m_job;
+  size_t m_generation;
+  size_t m_active;
+  bool m_stop;
+};
+
+}  // namespace core
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+namespace core {
+
+/**
+ * @brief Owning array of RELIC scalars (bn_new on construction, bn_free on
+ * destruction), for per-batch temporaries.
+ */
+class ScalarBuffer {
+ public:
+  explicit ScalarBuffer(size_t count);
+  ~ScalarBuffer();
+
+  ScalarBuffer(const ScalarBuffer&) = delete;
+  ScalarBuffer& operator=(const ScalarBuffer&) = delete;
+
+  size_t size() const { return m_count; }
+  bn_t* data() { return m_values; }
+  bn_st* operator[](size_t i) { return m_values[i]; }
+  const bn_st* operator[](size_t i) const { return m_values[i]; }
+
+ private:
+  bn_t* m_values;
+  size_t m_count;
+};
+
+/**
+ * @brief Arithmetic modulo the group order of the active curve.
+ *
+ * The order is read once at construction, so the object must be rebuilt if
+ * the curve changes. All methods are const and safe to call concurrently.
+ */
+class ScalarField {
+ public:
+  ScalarField();
+  ~ScalarField();
+
+  ScalarField(const ScalarField&) = delete;
+  ScalarField& operator=(const ScalarField&) = delete;
+
+  const bn_st* order() const { return m_order; }
+
+  /** @brief out = a * b mod order; out may alias a or b. */
+  void mul(bn_t out, const bn_t a, const bn_t b) const;
+
+  /** @brief out = a^{-1} mod order; throws std::invalid_argument if a = 0. */
+  void inv(bn_t out, const bn_t a) const;
+
+  /**
+   * @brief Replaces each values[i] by its inverse using Montgomery's trick:
+   * one modular inversion plus 3(count - 1) multiplications.
+   * Throws std::invalid_argument (leaving values unchanged) if any value is
+   * zero modulo the order.
+   */
+  void batchInvert(bn_t* values, size_t count) const;
+
+ private:
+  bn_t m_order;
+};
+
+}  // namespace core
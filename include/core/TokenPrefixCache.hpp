@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/CompressedPoint.hpp"
+#include "core/LruCache.hpp"
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+namespace core {
+
+/**
+ * @brief Gatekeeper-side cache of bstag_j = H(w||j||0)^Kt and
+ * delta_j = H(w||j||1)^Kt prefixes, keyed by keyword.
+ *
+ * Each entry also keeps the client points it was derived from, and only the
+ * leading positions whose points match the request are reused. The rest are
+ * exponentiated and appended. Entries depend on Kt, so owners must clear()
+ * the cache whenever their keys change. Not thread-safe.
+ */
+class TokenPrefixCache {
+ public:
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t reused_positions;    // j values served from the cache
+    uint64_t computed_positions;  // j values exponentiated
+    size_t bytes;
+
+    Stats()
+        : hits(0),
+          misses(0),
+          evictions(0),
+          reused_positions(0),
+          computed_positions(0),
+          bytes(0) {}
+  };
+
+  TokenPrefixCache();
+
+  /** @brief Bounds the cache to max_bytes; 0 (default) disables it. */
+  void setBudget(size_t max_bytes);
+
+  /** @brief Drops every entry, keeping the budget and counters. */
+  void clear();
+
+  /**
+   * @brief Sets bstag / delta to hw_0 / hw_1 raised to kt, reusing the
+   * cached prefix for keyword. The inputs hold positions j = offset+1, ...;
+   * a request that starts inside or right after the cached prefix extends
+   * it. Throws std::invalid_argument if hw_0 and hw_1 differ in length.
+   */
+  void derive(const std::string& keyword, const bn_t kt,
+              const std::vector<CompressedPoint>& hw_0,
+              const std::vector<CompressedPoint>& hw_1,
+              std::vector<CompressedPoint>* bstag,
+              std::vector<CompressedPoint>* delta, size_t offset = 0);
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::vector<CompressedPoint> hw_0;
+    std::vector<CompressedPoint> hw_1;
+    std::vector<CompressedPoint> bstag;
+    std::vector<CompressedPoint> delta;
+
+    size_t memoryBytes(const std::string& keyword) const;
+  };
+
+  std::unique_ptr<LruCache<std::string, Entry>> m_cache;
+  uint64_t m_reused_positions;
+  uint64_t m_computed_positions;
+};
+
+}  // namespace core
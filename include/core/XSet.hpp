@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/CompressedPoint.hpp"
+
+namespace core {
+
+/**
+ * @brief Compact XSet membership structure.
+ *
+ * Each xtag is reduced to a 128-bit fingerprint (SHA-256 prefix) and kept in
+ * an open-addressing table of 16-byte slots sized for a load of up to 7/8.
+ * An optional cuckoo filter (4-way buckets of 16-bit tags, about 2 bytes per
+ * xtag) sits in front, so most negative probes are answered without touching
+ * the exact table. The filter is rebuilt from the exact table when an insert
+ * cannot be placed.
+ *
+ * A false positive requires a 128-bit fingerprint collision, which is
+ * negligible at the XSet sizes used here.
+ */
+class XSet {
+ public:
+  struct Fingerprint {
+    uint64_t hi;
+    uint64_t lo;
+  };
+
+  static Fingerprint FingerprintOf(const uint8_t* xtag, size_t len);
+  static Fingerprint FingerprintOf(const std::string& xtag) {
+    return FingerprintOf(reinterpret_cast<const uint8_t*>(xtag.data()),
+                         xtag.size());
+  }
+  static Fingerprint FingerprintOf(const CompressedPoint& xtag) {
+    return FingerprintOf(xtag.data(), CompressedPoint::kBytes);
+  }
+
+  /**
+   * @brief Parses the output of serialize(); throws std::runtime_error on a
+   * malformed buffer.
+   */
+  static XSet Deserialize(const std::string& bytes, bool use_filter = true);
+
+  explicit XSet(bool use_filter = true);
+
+  void insert(const std::string& xtag) { insert(FingerprintOf(xtag)); }
+  void insert(const CompressedPoint& xtag) { insert(FingerprintOf(xtag)); }
+  void insert(const Fingerprint& fp);
+
+  bool contains(const std::string& xtag) const {
+    return contains(FingerprintOf(xtag));
+  }
+  bool contains(const CompressedPoint& xtag) const {
+    return contains(FingerprintOf(xtag));
+  }
+  bool contains(const Fingerprint& fp) const;
+
+  /** @brief Presizes the table (and filter) for @p entries xtags. */
+  void reserve(size_t entries);
+
+  size_t size() const { return m_size; }
+  bool hasFilter() const { return m_use_filter; }
+
+  /** @brief Bytes held by the exact table plus the filter. */
+  size_t memoryBytes() const;
+
+  /**
+   * @brief Binary form: "NXS1", u64 count, then count x 16-byte fingerprints,
+   * all big-endian. The filter is not stored; it is rebuilt on load.
+   */
+  std::string serialize() const;
+
+ private:
+  size_t homeSlot(const Fingerprint& fp) const;
+  bool placeExact(const Fingerprint& fp);
+  void rehashExact(size_t new_capacity);
+
+  bool filterMayContain(const Fingerprint& fp) const;
+  bool filterInsert(const Fingerprint& fp);
+  void rebuildFilter(size_t entries);
+
+  std::vector<Fingerprint> m_slots;  // {0, 0} marks an empty slot
+  size_t m_size;
+
+  bool m_use_filter;
+  std::vector<uint16_t> m_filter;  // kFilterWays tags per bucket, 0 = empty
+  size_t m_filter_mask;            // bucket count - 1 (power of two)
+  uint64_t m_kick_state;
+};
+
+}  // namespace core
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "core/QueryPlanner.hpp"
+#include "core/RelicContext.hpp"
 #include "mc-odxt/McOdxtTypes.hpp"
 
 namespace mcodxt {
@@ -15,13 +18,27 @@ class McOdxtClient {
 
   int setup();
 
+  /**
+   * @brief Spread genToken's 2m hash-to-curve calls over num_threads threads
+   * 1 (default) hashes on the calling thread only; 0 uses every hardware
+   * thread.
+   */
+  void setHashThreads(size_t num_threads);
+
+  /**
+   * @brief How genToken orders the x-terms (see core::PlanQuery)
+   * kAscendingCount (default) probes the x-term with the fewest updates
+   * first; kInput keeps the caller's order.
+   */
+  void setXTermOrder(core::XTermOrder order) { m_xterm_order = order; }
+
   TokenRequest genToken(const std::vector<std::string>& query_keywords,
                         const std::unordered_map<std::string, int>& updateCnt);
 
   struct SearchRequest {
     int num_keywords;
-    std::vector<std::string> stokenList;
-    std::vector<std::vector<std::vector<std::string>>> xtokenList;
+    std::vector<core::CompressedPoint> stokenList;
+    std::vector<std::vector<std::vector<core::CompressedPoint>>> xtokenList;
 
     SearchRequest() : num_keywords(0) {}
   };
@@ -31,6 +48,11 @@ class McOdxtClient {
 
   std::vector<std::string> decryptResults(
       const std::vector<SearchResultEntry>& results, const SearchToken& token);
+
+ private:
+  // Pool for batched hashing in genToken; null when hashing sequentially
+  std::unique_ptr<core::WorkerPool> m_pool;
+  core::XTermOrder m_xterm_order;
 };
 
 }  // namespace mcodxt
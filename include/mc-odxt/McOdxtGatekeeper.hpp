@@ -1,9 +1,13 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "core/Primitive.hpp"
+#include "core/ScalarField.hpp"
+#include "core/TokenPrefixCache.hpp"
 #include "mc-odxt/McOdxtTypes.hpp"
 
 namespace mcodxt {
@@ -37,6 +41,19 @@ class McOdxtGatekeeper {
    */
   SearchToken genToken(const TokenRequest& req);
 
+  /**
+   * @brief Cache bstag/delta prefixes per keyword within max_bytes
+   * Repeat genToken calls for w1 exponentiate only the j past the cached
+   * prefix. 0 (default) disables the cache; setup() empties it.
+   */
+  void setTokenCacheBudget(size_t max_bytes) {
+    m_token_cache.setBudget(max_bytes);
+  }
+
+  core::TokenPrefixCache::Stats tokenCacheStats() const {
+    return m_token_cache.stats();
+  }
+
  private:
   bn_t m_Ks;
   bn_t* m_Kt;
@@ -45,6 +62,9 @@ class McOdxtGatekeeper {
   std::vector<uint8_t> m_Km;
   std::unordered_map<std::string, int> m_updateCnt;
   int m_d;
+  std::unique_ptr<core::ScalarField> m_field;  // group order cached at setup
+  std::unique_ptr<KeyedPrf> m_ky_prf;  // F_p(Ky, .), HMAC state precomputed
+  core::TokenPrefixCache m_token_cache;  // emptied whenever the keys change
 
   int indexFunction(const std::string& keyword) const;
   std::string computeKz(const std::string& keyword);
@@ -1,9 +1,12 @@
 #pragma once
 
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "core/FlatTSet.hpp"
+#include "core/RelicContext.hpp"
+#include "core/XSet.hpp"
 #include "mc-odxt/McOdxtClient.hpp"
 #include "mc-odxt/McOdxtTypes.hpp"
 
@@ -16,16 +19,24 @@ class McOdxtServer {
 
   void setup(const std::vector<uint8_t>& Km);
   void update(const UpdateMetadata& meta);
+  // Bulk form of update(); sizes the TSet once for the whole batch.
+  void updateBatch(const std::vector<UpdateMetadata>& metas);
   std::vector<SearchResultEntry> search(const McOdxtClient::SearchRequest& req);
 
+  // Evaluate stoken slots on up to num_threads threads (1 = sequential,
+  // 0 = all hardware threads).
+  void setSearchThreads(size_t num_threads);
+
   size_t getTSetSize() const { return m_TSet.size(); }
   size_t getXSetSize() const { return m_XSet.size(); }
 
  private:
-  std::map<std::string, TSetEntry> m_TSet;
-  std::map<std::string, bool> m_XSet;
+  core::FlatTSet m_TSet;
+  core::XSet m_XSet;
+  std::unique_ptr<core::WorkerPool> m_pool;
 
-  std::string serializePoint(const ep_t point) const;
+  bool matchSlot(const McOdxtClient::SearchRequest& req, int j,
+                 const core::FlatTSet::Entry& entry, int* match_count) const;
 };
 
 }  // namespace mcodxt
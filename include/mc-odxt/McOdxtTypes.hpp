@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "core/CompressedPoint.hpp"
+
 extern "C" {
 #include <relic/relic.h>
 }
@@ -16,15 +18,15 @@ struct UpdateMetadata {
   ep_t addr;
   std::vector<uint8_t> val;
   bn_t alpha;
-  std::string xtag;
+  core::CompressedPoint xtag;
 
-  UpdateMetadata() {
+  UpdateMetadata() : xtag() {
     ep_null(addr);
     bn_null(alpha);
   }
 
   UpdateMetadata(UpdateMetadata&& other) noexcept
-      : val(std::move(other.val)), xtag(std::move(other.xtag)) {
+      : val(std::move(other.val)), xtag(other.xtag) {
     std::memcpy(addr, other.addr, sizeof(ep_t));
     std::memcpy(alpha, other.alpha, sizeof(bn_t));
     ep_null(other.addr);
@@ -36,7 +38,7 @@ struct UpdateMetadata {
       ep_free(addr);
       bn_free(alpha);
       val = std::move(other.val);
-      xtag = std::move(other.xtag);
+      xtag = other.xtag;
       std::memcpy(addr, other.addr, sizeof(ep_t));
       std::memcpy(alpha, other.alpha, sizeof(bn_t));
       ep_null(other.addr);
@@ -56,9 +58,9 @@ struct UpdateMetadata {
 
 struct SearchToken {
   ep_t strap;
-  std::vector<std::string> bstag;
-  std::vector<std::string> delta;
-  std::vector<std::vector<std::string>> bxtrap;
+  std::vector<core::CompressedPoint> bstag;
+  std::vector<core::CompressedPoint> delta;
+  std::vector<std::vector<core::CompressedPoint>> bxtrap;
 
   SearchToken() { ep_null(strap); }
 
@@ -92,9 +94,9 @@ struct SearchToken {
 // that the gatekeeper transforms with Ks, Kt and Kx.
 struct TokenRequest {
   std::vector<std::string> query_keywords;
-  std::vector<std::string> hashed_keywords;
-  std::vector<std::string> hw1_j_0;
-  std::vector<std::string> hw1_j_1;
+  std::vector<core::CompressedPoint> hashed_keywords;
+  std::vector<core::CompressedPoint> hw1_j_0;
+  std::vector<core::CompressedPoint> hw1_j_1;
 };
 
 struct SearchResultEntry {
@@ -103,31 +105,4 @@ struct SearchResultEntry {
   int cnt;
 };
 
-struct TSetEntry {
-  std::vector<uint8_t> val;
-  bn_t alpha;
-
-  TSetEntry() { bn_null(alpha); }
-
-  TSetEntry(TSetEntry&& other) noexcept : val(std::move(other.val)) {
-    std::memcpy(alpha, other.alpha, sizeof(bn_t));
-    bn_null(other.alpha);
-  }
-
-  TSetEntry& operator=(TSetEntry&& other) noexcept {
-    if (this != &other) {
-      bn_free(alpha);
-      val = std::move(other.val);
-      std::memcpy(alpha, other.alpha, sizeof(bn_t));
-      bn_null(other.alpha);
-    }
-    return *this;
-  }
-
-  ~TSetEntry() { bn_free(alpha); }
-
-  TSetEntry(const TSetEntry&) = delete;
-  TSetEntry& operator=(const TSetEntry&) = delete;
-};
-
 }  // namespace mcodxt
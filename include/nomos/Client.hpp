@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "core/LruCache.hpp"
+#include "core/QueryPlanner.hpp"
+#include "core/RelicContext.hpp"
 #include "types.hpp"
 
 extern "C" {
@@ -12,6 +17,37 @@ extern "C" {
 
 namespace nomos {
 
+/**
+ * @brief Incremental form of Client::decryptResults
+ * Decrypts results one at a time as they arrive (e.g. from
+ * Server::searchStream) and keeps only the net ADD/DEL count per id. The
+ * token must outlive the decryptor.
+ */
+class ResultDecryptor {
+ public:
+  explicit ResultDecryptor(const SearchToken& token);
+
+  /** @brief Tallies one result; false if it is out of range or malformed. */
+  bool add(const SearchResultEntry& result);
+  bool add(const SearchResultRef& result);
+
+  /** @brief Ids whose net count so far is positive */
+  std::vector<std::string> ids() const;
+
+  const std::unordered_map<std::string, int>& netCounts() const {
+    return m_net_count;
+  }
+
+  static std::vector<std::string> LiveIds(
+      const std::unordered_map<std::string, int>& net_count);
+
+ private:
+  bool add(int result_j, const uint8_t* sval, size_t sval_len);
+
+  const SearchToken& m_token;
+  std::unordered_map<std::string, int> m_net_count;
+};
+
 /**
  * @brief Nomos Client implementation for the simplified experimental path
  */
@@ -22,6 +58,51 @@ class Client {
 
   int setup();
 
+  /**
+   * @brief Spread genToken's 2m hash-to-curve calls over num_threads threads
+   * 1 (default) hashes on the calling thread only; 0 uses every hardware
+   * thread.
+   */
+  void setHashThreads(size_t num_threads);
+
+  /**
+   * @brief How genToken orders the x-terms (see core::PlanQuery)
+   * kAscendingCount (default) probes the x-term with the fewest updates
+   * first; kInput keeps the caller's order.
+   */
+  void setXTermOrder(core::XTermOrder order) { m_xterm_order = order; }
+
+  /**
+   * @brief Cache per-keyword query values within max_bytes
+   * The cache holds H(w), H(w||j||0), H(w||j||1) and e_j = F_p(Kz, w||j).
+   * Repeat queries on a keyword reuse the cached j = 1..m' and compute only
+   * the j beyond it. The least recently used keywords are evicted first.
+   * 0 (default) disables the cache.
+   */
+  void setCacheBudget(size_t max_bytes);
+
+  // A keyword counts once per genToken / genPageToken / genIncrementalToken
+  // or prepareSearch (w1 only) call: a hit if the call served any cached
+  // value for it, a miss otherwise.
+  struct CacheStats {
+    uint64_t keyword_hits;
+    uint64_t keyword_misses;
+    uint64_t evictions;
+    uint64_t reused_positions;    // j values served from the cache
+    uint64_t computed_positions;  // j values computed and added to it
+    size_t bytes;
+
+    CacheStats()
+        : keyword_hits(0),
+          keyword_misses(0),
+          evictions(0),
+          reused_positions(0),
+          computed_positions(0),
+          bytes(0) {}
+  };
+
+  CacheStats cacheStats() const;
+
   /**
    * @brief Generate the client-side Nomos GenToken request for experiments
    *
@@ -35,16 +116,32 @@ class Client {
   TokenRequest genToken(const std::vector<std::string>& query_keywords,
                         const std::unordered_map<std::string, int>& updateCnt);
 
+  /**
+   * @brief genToken restricted to one page of w1's slots
+   * Covers j = first_slot+1 .. min(first_slot+max_slots, m) of the reordered
+   * w1, so the gatekeeper, prepareSearch and the server only handle that
+   * range. Resume with first_slot = SearchPage::next_slot. Throws
+   * std::invalid_argument if first_slot < 0 or max_slots <= 0.
+   * A page holds both ADD and DEL entries, and the page limit counts both.
+   * An id deleted on a later page is still live in this page's results,
+   * so only the net count over every page is final.
+   */
+  TokenRequest genPageToken(
+      const std::vector<std::string>& query_keywords,
+      const std::unordered_map<std::string, int>& updateCnt, int first_slot,
+      int max_slots);
+
   /**
    * @brief Search - Algorithm 4 (Client side)
    * Derive search request values from the token.
    */
   struct SearchRequest {
     int num_keywords;
-    std::vector<std::string> stokenList;
-    std::vector<std::vector<std::vector<std::string>>> xtokenList;
+    int slot_offset;  // stokenList[0] is slot j = slot_offset+1
+    std::vector<core::CompressedPoint> stokenList;
+    std::vector<std::vector<std::vector<core::CompressedPoint>>> xtokenList;
 
-    SearchRequest() : num_keywords(0) {}
+    SearchRequest() : num_keywords(0), slot_offset(0) {}
     ~SearchRequest() {}
   };
 
@@ -53,9 +150,83 @@ class Client {
 
   /**
    * @brief Decrypt search results
+   * Ids are live by the net ADD/DEL count over results alone. For one page
+   * of a paged search, that can include ids deleted on a later page.
    */
   std::vector<std::string> decryptResults(
       const std::vector<SearchResultEntry>& results, const SearchToken& token);
+
+  /**
+   * @brief Incremental single-keyword search, step 1
+   * Requests only the slots added since this client's result snapshot for
+   * keyword (all slots if there is none). The request flows through
+   * Gatekeeper::genToken, prepareSearch and Server::search unchanged; a
+   * request with no new slots can skip them.
+   */
+  TokenRequest genIncrementalToken(
+      const std::string& keyword,
+      const std::unordered_map<std::string, int>& updateCnt);
+
+  /**
+   * @brief Incremental single-keyword search, step 2
+   * Merges the new slots' ADD/DEL counts into the snapshot and returns the
+   * live ids over the keyword's whole history. Throws std::invalid_argument
+   * if token_request does not continue the current snapshot.
+   */
+  std::vector<std::string> applyIncrementalResults(
+      const TokenRequest& token_request, const SearchToken& token,
+      const std::vector<SearchResultEntry>& results);
+
+  /** @brief Update count covered by keyword's snapshot (0 if none) */
+  int snapshotUpdateCount(const std::string& keyword) const;
+
+  void dropSnapshot(const std::string& keyword);
+
+ private:
+  // Pool for batched hashing in genToken; null when hashing sequentially
+  std::unique_ptr<core::WorkerPool> m_pool;
+  core::XTermOrder m_xterm_order;
+
+  // Cached values for one keyword w, each for a prefix j = 1..size()
+  struct CachedKeyword {
+    bool has_hw;
+    core::CompressedPoint hw;                  // H(w)
+    std::vector<core::CompressedPoint> hw_0;  // H(w||j||0)
+    std::vector<core::CompressedPoint> hw_1;  // H(w||j||1)
+    std::string kz;                            // Kz the e_j belong to
+    std::vector<uint8_t> e;                    // e_j, fixed-width big-endian
+
+    CachedKeyword() : has_hw(false) {}
+    size_t memoryBytes(const std::string& keyword) const;
+  };
+
+  // Cache entry for keyword (inserted empty if absent); null when disabled.
+  // The pointer is valid until the next cache call.
+  CachedKeyword* cacheEntry(const std::string& keyword);
+  void cacheResized(const std::string& keyword, const CachedKeyword& entry);
+  void countKeyword(bool served);
+  // The helpers below take the keyword's cacheEntry (null: uncached) and
+  // return true if they served a cached value.
+  bool keywordPoint(const std::string& keyword, CachedKeyword* entry,
+                    core::CompressedPoint* out);
+  bool slotPoints(const std::string& w1, CachedKeyword* entry, size_t begin,
+                  size_t end, TokenRequest* req);
+
+  // Decrypted net ADD/DEL counts for slots 1..update_count of one keyword
+  struct ResultSnapshot {
+    int update_count;
+    std::unordered_map<std::string, int> net_count;
+
+    ResultSnapshot() : update_count(0) {}
+  };
+
+  std::unique_ptr<core::LruCache<std::string, CachedKeyword>> m_cache;
+  uint64_t m_keyword_hits;
+  uint64_t m_keyword_misses;
+  uint64_t m_reused_positions;
+  uint64_t m_computed_positions;
+
+  std::unordered_map<std::string, ResultSnapshot> m_snapshots;
 };
 
 }  // namespace nomos
@@ -5,6 +5,10 @@
 #include <unordered_map>
 #include <vector>
 
+#include "core/Primitive.hpp"
+#include "core/RelicContext.hpp"
+#include "core/ScalarField.hpp"
+#include "core/TokenPrefixCache.hpp"
 #include "types.hpp"
 
 extern "C" {
@@ -24,8 +28,14 @@ class Gatekeeper {
   /**
    * @brief Setup - Algorithm 1
    * Initialize keys: Ks, Kt[1..d], Kx[1..d], Ky, Km
+   * @param d Number of key array elements
+   * @param ell ℓ, xtags stored per update (1..255)
+   * @param k Cross-tags sampled per x-term at query time (1..ell)
    */
-  int setup(int d = 10);  // d = number of key array elements
+  int setup(int d = 10, int ell = 3, int k = 2);
+
+  int getEll() const { return m_ell; }
+  int getK() const { return m_k; }
 
   /**
    * @brief Update - Algorithm 2
@@ -37,6 +47,25 @@ class Gatekeeper {
   UpdateMetadata update(OP op, const std::string& id,
                         const std::string& keyword);
 
+  /**
+   * @brief Batched Update - Algorithm 2 over many (op, id, keyword) entries
+   *
+   * Counters are assigned in input order, exactly as repeated update() calls
+   * would. Kz, H(w) and I(w) are derived once per distinct keyword, all
+   * F_p(Kz, w||cnt) values share one batched inversion, and the per-entry
+   * work is spread over the update pool (see setUpdateThreads).
+   *
+   * @return UpdateMetadata in input order
+   */
+  std::vector<UpdateMetadata> updateBatch(
+      const std::vector<UpdateRequest>& requests);
+
+  /**
+   * @brief Threads used by updateBatch; 1 (default) keeps it on the calling
+   * thread only; 0 uses every hardware thread.
+   */
+  void setUpdateThreads(size_t num_threads);
+
   /**
    * @brief Get update count for a keyword
    */
@@ -71,6 +100,19 @@ class Gatekeeper {
    */
   SearchToken genToken(const TokenRequest& req);
 
+  /**
+   * @brief Cache bstag/delta prefixes per keyword within max_bytes
+   * Repeat genToken calls for w1 exponentiate only the j past the cached
+   * prefix. 0 (default) disables the cache; setup() empties it.
+   */
+  void setTokenCacheBudget(size_t max_bytes) {
+    m_token_cache.setBudget(max_bytes);
+  }
+
+  core::TokenPrefixCache::Stats tokenCacheStats() const {
+    return m_token_cache.stats();
+  }
+
  private:
   // Keys
   bn_t m_Ks;   // Base secret exponent
@@ -82,15 +124,45 @@ class Gatekeeper {
   // State
   std::unordered_map<std::string, int> m_updateCnt;  // UpdateCnt[w]
   int m_d;                                           // Key array size
+  int m_ell;                                         // ℓ
+  int m_k;                                           // k
+
+  // Group order cached at setup
+  std::unique_ptr<core::ScalarField> m_field;
+
+  // F_p(Ky, .) with the HMAC key schedule done once at setup
+  std::unique_ptr<KeyedPrf> m_ky_prf;
+
+  // bstag/delta prefixes for genToken; emptied whenever the keys change
+  core::TokenPrefixCache m_token_cache;
+
+  // Pool for updateBatch; null when updating sequentially
+  std::unique_ptr<core::WorkerPool> m_pool;
+
+  // Per-keyword values shared by every update of that keyword
+  struct KeywordState {
+    std::string kz;  // Kz = F(serialize(H(w)^Ks), "1")
+    std::unique_ptr<KeyedPrf> kz_prf;  // F_p(Kz, .)
+    int idx;         // I(w)
+    ep_t hw;         // H(w)
+
+    KeywordState();
+    ~KeywordState();
+    KeywordState(const KeywordState&) = delete;
+    KeywordState& operator=(const KeywordState&) = delete;
+  };
 
   // Helper functions
+  void initKeywordState(KeywordState* state, const std::string& keyword);
+  void runUpdateRange(size_t count, const core::WorkerPool::RangeFn& body);
+  void computeFpKz(bn_t result, const std::string& keyword, int cnt,
+                   const KeywordState& state) const;  // F_p(Kz, w||cnt)
+  void buildMetadata(UpdateMetadata* meta, OP op, const std::string& id,
+                     const std::string& keyword, int cnt,
+                     const KeywordState& state, const bn_t fp_kz_inv) const;
   int indexFunction(const std::string& keyword) const;  // I(w)
   std::string computeKz(
       const std::string& keyword);  // Kz = F(serialize(H(w)^Ks), "1")
-  void computeF_p(bn_t result, const bn_t key,
-                  const std::string& input);  // F_p(key, input)
-  void computeF_p(bn_t result, const std::string& key,
-                  const std::string& input);  // F_p(key, input)
 };
 
 }  // namespace nomos
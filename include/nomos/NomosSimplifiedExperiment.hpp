@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "core/Experiment.hpp"
+#include "core/Primitive.hpp"
 #include "nomos/Gatekeeper.hpp"
 #include "nomos/Client.hpp"
 #include "nomos/Server.hpp"
@@ -37,9 +38,12 @@ public:
             return -1;
         }
 
-        // Set elliptic curve
-        if (ep_param_set_any_pairf() != RLC_OK) {
-            std::cerr << "Failed to set elliptic curve" << std::endl;
+        // Set elliptic curve (selected with --curve, pairing by default)
+        try {
+            UseCurve(DefaultCurve());
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to set elliptic curve: " << e.what()
+                      << std::endl;
             return -1;
         }
 
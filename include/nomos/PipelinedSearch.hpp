@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Client.hpp"
+#include "Gatekeeper.hpp"
+#include "Server.hpp"
+
+namespace nomos {
+
+/**
+ * @brief Runs one query as a pipeline of slot chunks over the three parties
+ *
+ * The query's w1 slots are split into chunks (Client::genPageToken). Each
+ * chunk passes through five stages, each on its own thread and connected by
+ * bounded queues: client genToken, gatekeeper genToken, client
+ * prepareSearch, server search and client decryption. Later chunks are still
+ * being derived while earlier ones are searched. The returned ids equal a
+ * sequential search.
+ *
+ * The two client stages share the Client under a mutex, so its caches need
+ * no extra locking. The gatekeeper and server are only used by their own
+ * stage. None of the three may be used elsewhere while run() is active. When
+ * RELIC has no per-thread context (MULTI=NONE), the chunks run
+ * stage-by-stage on the calling thread.
+ */
+class PipelinedSearch {
+ public:
+  enum Stage {
+    kClientToken = 0,
+    kGatekeeperToken,
+    kClientPrepare,
+    kServerSearch,
+    kClientDecrypt,
+    kStageCount
+  };
+
+  struct Stats {
+    size_t chunks;
+    double latency_ms;       // run() start to last chunk decrypted
+    double first_chunk_ms;   // run() start to first chunk decrypted
+    double busy_ms[kStageCount];  // time each stage spent on chunks
+
+    Stats();
+
+    /** @brief Fraction of the end-to-end latency the stage was busy */
+    double occupancy(Stage stage) const;
+  };
+
+  PipelinedSearch(Client* client, Gatekeeper* gatekeeper, Server* server);
+
+  /** @brief w1 slots per chunk (default 64); throws if 0 */
+  void setChunkSlots(size_t chunk_slots);
+
+  /** @brief Chunks buffered between two stages (default 2); throws if 0 */
+  void setQueueDepth(size_t queue_depth);
+
+  /**
+   * @brief Searches query with the gatekeeper's update counts
+   * @param stats Optional latency and per-stage occupancy for this run
+   * @return Live ids, as Client::decryptResults would return them
+   */
+  std::vector<std::string> run(const std::vector<std::string>& query,
+                               Stats* stats = nullptr);
+
+  static const char* StageName(Stage stage);
+
+ private:
+  Client* m_client;
+  Gatekeeper* m_gatekeeper;
+  Server* m_server;
+  size_t m_chunk_slots;
+  size_t m_queue_depth;
+};
+
+}  // namespace nomos
@@ -1,9 +1,12 @@
 #pragma once
 
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "core/FlatTSet.hpp"
+#include "core/RelicContext.hpp"
+#include "core/XSet.hpp"
 #include "types.hpp"
 #include "Client.hpp"
 
@@ -32,6 +35,11 @@ public:
      */
     void update(const UpdateMetadata& meta);
 
+    /**
+     * @brief Bulk form of update(); sizes the TSet once for the whole batch
+     */
+    void updateBatch(const std::vector<UpdateMetadata>& metas);
+
     /**
      * @brief Search - Algorithm 4 (Server side)
      * @param req Search request from client
@@ -39,6 +47,31 @@ public:
      */
     std::vector<SearchResultEntry> search(const Client::SearchRequest& req);
 
+    /**
+     * @brief Search that stops once limit slots have matched
+     * Slots are scanned in j order, a block at a time, so at most one block
+     * is evaluated past the limit-th match. limit counts matching TSet
+     * entries (ADD or DEL), not live ids; 0 means no limit.
+     */
+    SearchPage searchPage(const Client::SearchRequest& req, size_t limit);
+
+    /**
+     * @brief Search that hands each match to sink as soon as its block is
+     * evaluated, in j order, without copying val out of the TSet
+     * Stops early if sink returns false. sink runs on the calling thread
+     * and must not update this server.
+     * @return Number of matches delivered
+     */
+    size_t searchStream(const Client::SearchRequest& req,
+                        const SearchResultSink& sink);
+
+    /**
+     * @brief Evaluate stoken slots on up to num_threads threads
+     * Results keep the sequential j order. 1 (default) searches on the
+     * calling thread only; 0 uses every hardware thread.
+     */
+    void setSearchThreads(size_t num_threads);
+
     /**
      * @brief Get TSet size (for testing)
      */
@@ -50,14 +83,23 @@ public:
     size_t getXSetSize() const { return m_XSet.size(); }
 
 private:
-    // TSet: ep_t (addr) -> TSetEntry (val, alpha)
-    std::map<std::string, TSetEntry> m_TSet;
+    // TSet: ep_t (addr) -> (val, alpha), flat open-addressing table
+    core::FlatTSet m_TSet;
+
+    // XSet: fingerprints of compressed xtags
+    core::XSet m_XSet;
+
+    // Pool for parallel search; null when searching sequentially
+    std::unique_ptr<core::WorkerPool> m_pool;
 
-    // XSet: ep_t (xtag) -> bool
-    std::map<std::string, bool> m_XSet;
+    // Helper: whether TSet entry for slot j passes cross-filtering
+    bool matchSlot(const Client::SearchRequest& req, int j,
+                   const core::FlatTSet::Entry& entry, int* match_count) const;
 
-    // Helper: serialize ep_t to string for map key
-    std::string serializePoint(const ep_t point) const;
+    // Helper: passes the matches among request slots [begin, end) to sink in
+    // j order; returns false once sink does
+    bool scanSlots(const Client::SearchRequest& req, size_t begin, size_t end,
+                   const SearchResultSink& sink);
 };
 
 }  // namespace nomos
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "core/CompressedPoint.hpp"
+
 extern "C" {
 #include <relic/relic.h>
 }
@@ -13,12 +16,25 @@ namespace nomos {
 // Operation type
 enum OP { OP_ADD = 0, OP_DEL = 1 };
 
+// One (op, id, keyword) entry of a Gatekeeper::updateBatch call
+struct UpdateRequest {
+  OP op;
+  std::string id;
+  std::string keyword;
+
+  UpdateRequest() : op(OP_ADD) {}
+  UpdateRequest(OP op_in, const std::string& id_in,
+                const std::string& keyword_in)
+      : op(op_in), id(id_in), keyword(keyword_in) {}
+};
+
 // Update metadata sent from Gatekeeper to Server
 struct UpdateMetadata {
-  ep_t addr;                       // TSet address (elliptic curve point)
-  std::vector<uint8_t> val;        // Encrypted (id||op)
-  bn_t alpha;                      // Alpha value for cross-filtering
-  std::vector<std::string> xtags;  // ℓ xtags (serialized elliptic curve points)
+  ep_t addr;                 // TSet address (elliptic curve point)
+  std::vector<uint8_t> val;  // Encrypted (id||op)
+  bn_t alpha;                // Alpha value for cross-filtering
+  // ℓ xtags (compressed points)
+  std::vector<core::CompressedPoint> xtags;
 
   UpdateMetadata() {
     ep_null(addr);
@@ -56,19 +72,23 @@ struct UpdateMetadata {
   UpdateMetadata& operator=(const UpdateMetadata&) = delete;
 };
 
-// Token structure for search.
+// Token structure for search. bstag / delta cover slots
+// j = slot_offset+1 .. slot_offset+bstag.size().
 struct SearchToken {
-  ep_t strap;                                    // H(w1)^{K_S}
-  std::vector<std::string> bstag;                // bstag_j (serialized)
-  std::vector<std::string> delta;                // delta_j (serialized)
-  std::vector<std::vector<std::string>> bxtrap;  // bxtrap_j[t] (serialized)
+  ep_t strap;                                // H(w1)^{K_S}
+  std::vector<core::CompressedPoint> bstag;  // bstag_j, compressed
+  std::vector<core::CompressedPoint> delta;  // delta_j, compressed
+  // bxtrap_j[t], compressed
+  std::vector<std::vector<core::CompressedPoint>> bxtrap;
+  int slot_offset;
 
-  SearchToken() { ep_null(strap); }
+  SearchToken() : slot_offset(0) { ep_null(strap); }
 
   SearchToken(SearchToken&& other) noexcept
       : bstag(std::move(other.bstag)),
         delta(std::move(other.delta)),
-        bxtrap(std::move(other.bxtrap)) {
+        bxtrap(std::move(other.bxtrap)),
+        slot_offset(other.slot_offset) {
     std::memcpy(strap, other.strap, sizeof(ep_t));
     ep_null(other.strap);
   }
@@ -79,6 +99,7 @@ struct SearchToken {
       bstag = std::move(other.bstag);
       delta = std::move(other.delta);
       bxtrap = std::move(other.bxtrap);
+      slot_offset = other.slot_offset;
       std::memcpy(strap, other.strap, sizeof(ep_t));
       ep_null(other.strap);
     }
@@ -92,12 +113,16 @@ struct SearchToken {
 };
 
 // Client-side GenToken output: reordered query plus pre-hashed group elements
-// that the gatekeeper transforms with Ks, Kt and Kx.
+// that the gatekeeper transforms with Ks, Kt and Kx. hw1_j_0 / hw1_j_1 cover
+// slots j = slot_offset+1 ..; slot_offset is 0 except for incremental search.
 struct TokenRequest {
   std::vector<std::string> query_keywords;
-  std::vector<std::string> hashed_keywords;
-  std::vector<std::string> hw1_j_0;
-  std::vector<std::string> hw1_j_1;
+  std::vector<core::CompressedPoint> hashed_keywords;
+  std::vector<core::CompressedPoint> hw1_j_0;
+  std::vector<core::CompressedPoint> hw1_j_1;
+  int slot_offset;
+
+  TokenRequest() : slot_offset(0) {}
 };
 
 // Search result entry
@@ -107,32 +132,26 @@ struct SearchResultEntry {
   int cnt;                    // Match count
 };
 
-// TSet entry
-struct TSetEntry {
-  std::vector<uint8_t> val;  // Encrypted (id||op)
-  bn_t alpha;                // Alpha value
-
-  TSetEntry() { bn_null(alpha); }
-
-  TSetEntry(TSetEntry&& other) noexcept : val(std::move(other.val)) {
-    std::memcpy(alpha, other.alpha, sizeof(bn_t));
-    bn_null(other.alpha);
-  }
+// Matched slot handed to a Server::searchStream consumer. sval points into the
+// server's TSet and is only valid during the callback.
+struct SearchResultRef {
+  int j;                // Index (absolute, 1-indexed)
+  const uint8_t* sval;  // Encrypted value
+  size_t sval_len;      // Bytes at sval
+  int cnt;              // Match count
+};
 
-  TSetEntry& operator=(TSetEntry&& other) noexcept {
-    if (this != &other) {
-      bn_free(alpha);
-      val = std::move(other.val);
-      std::memcpy(alpha, other.alpha, sizeof(bn_t));
-      bn_null(other.alpha);
-    }
-    return *this;
-  }
+// searchStream consumer; returning false stops the search.
+typedef std::function<bool(const SearchResultRef&)> SearchResultSink;
 
-  ~TSetEntry() { bn_free(alpha); }
+// One page of Server::searchPage output
+struct SearchPage {
+  // At most the requested limit
+  std::vector<SearchResultEntry> results;
+  int next_slot;   // slots 1..next_slot are scanned; resume after it
+  bool exhausted;  // every slot of the request was scanned
 
-  TSetEntry(const TSetEntry&) = delete;
-  TSetEntry& operator=(const TSetEntry&) = delete;
+  SearchPage() : next_slot(0), exhausted(true) {}
 };
 
 }  // namespace nomos
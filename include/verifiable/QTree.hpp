@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "core/RelicContext.hpp"
+#include "verifiable/QTreeBase.hpp"
+
 extern "C" {
 #include <relic/relic.h>
 }
@@ -16,83 +20,56 @@ namespace verifiable {
  *
  * Implements the QTree structure from Chapter 2 (bf.tex)
  * Provides bit value authenticity for qualification verification
+ *
+ * All levels live in one contiguous array of 32-byte digests laid out as an
+ * implicit binary heap, and the leaf bits in a packed bitset, so building
+ * the tree allocates twice and a path is a walk over array indices.
+ *
+ * A leaf digest depends only on its bit, so every all-zero subtree of a
+ * level has the same digest. These are precomputed per level, and a slot
+ * that was never written (all zero bytes) stands for them. An empty tree of
+ * any capacity is therefore built with depth hashes, and initialize() only
+ * hashes the ancestors of set bits.
  */
-class QTree {
+class QTree : public QTreeBase {
  public:
   QTree(size_t capacity);
-  ~QTree();
-
-  /**
-   * @brief Initialize the tree with given bit array
-   * @param bit_array The XSet bit array B^(t)
-   */
-  void initialize(const std::vector<bool>& bit_array);
-
-  /**
-   * @brief Update a single bit and advance the version once
-   * @param address The address to update
-   * @param value The new bit value
-   */
-  void updateBit(const std::string& address, bool value);
+  ~QTree() override;
 
-  /**
-   * @brief Update a batch of addresses and advance the version once
-   * @param addresses The addresses to update
-   * @param value The new bit value
-   */
-  void updateBits(const std::vector<std::string>& addresses, bool value);
+  /** @brief Throws std::runtime_error if bit_array exceeds the capacity */
+  void initialize(const std::vector<bool>& bit_array) override;
 
   /**
-   * @brief Read the current bit value at an address
-   * @param address The address to inspect
-   * @return Current bit stored at the corresponding QTree leaf
+   * Sets every leaf first, then rehashes each dirty node once, a level at a
+   * time, so addresses sharing ancestors share those hashes.
    */
-  bool getBit(const std::string& address) const;
+  void updateBits(const std::vector<std::string>& addresses,
+                  bool value) override;
 
-  /**
-   * @brief Generate authentication path for a single address
-   * @param address The address to prove
-   * @return Authentication path (sibling hashes from leaf to root)
-   */
-  std::vector<std::string> generateProof(const std::string& address) const;
+  bool getBit(const std::string& address) const override;
 
-  /**
-   * @brief Generate Positive proof (k authentication paths)
-   * @param addresses List of k addresses that should all be 1
-   * @return Proof structure containing k paths
-   */
-  std::string generatePositiveProof(
-      const std::vector<std::string>& addresses) const;
+  /** @brief log2(capacity) sibling hashes, root first */
+  std::vector<std::string> generateProof(
+      const std::string& address) const override;
 
-  /**
-   * @brief Generate Negative proof (1 authentication path for a 0 bit)
-   * @param address The address with bit value 0
-   * @return Proof structure containing 1 path
-   */
-  std::string generateNegativeProof(const std::string& address) const;
+  std::string getRootHash() const override;
 
-  /**
-   * @brief Get current root hash (commitment)
-   * @return Root hash R_X^(t)
-   */
-  std::string getRootHash() const;
+  bool verifyPath(const std::string& address, bool bit_value,
+                  const std::vector<std::string>& proof,
+                  const std::string& root_hash) const override;
 
   /**
-   * @brief Get current version number
+   * @brief u32be sibling count || 32-byte siblings
+   * Siblings are listed leaves first, ascending node id within a level, and
+   * only where the other child is not itself on a covered path.
    */
-  uint64_t getVersion() const { return m_version; }
+  std::string generateMultiProof(
+      const std::vector<std::string>& addresses) const override;
 
-  /**
-   * @brief Verify an authentication path
-   * @param address The address being verified
-   * @param bit_value The claimed bit value
-   * @param proof The authentication path
-   * @param root_hash The expected root hash
-   * @return true if verification passes
-   */
-  bool verifyPath(const std::string& address, bool bit_value,
-                  const std::vector<std::string>& proof,
-                  const std::string& root_hash) const;
+  bool verifyMultiProof(const std::vector<std::string>& addresses,
+                        const std::vector<bool>& bit_values,
+                        const std::string& proof,
+                        const std::string& root_hash) const override;
 
   /**
    * @brief Deterministically map an address to its physical QTree leaf index
@@ -101,25 +78,40 @@ class QTree {
 
   size_t getCapacity() const { return m_capacity; }
 
+  void setHashThreads(size_t num_threads) override;
+
  private:
-  struct Node {
-    std::string hash;
-    std::unique_ptr<Node> left;
-    std::unique_ptr<Node> right;
-    bool is_leaf;
-    bool bit_value;
+  struct FreeDeleter {
+    void operator()(uint8_t* p) const;
   };
 
-  void buildTree(const std::vector<bool>& bit_array);
-  std::string hashLeaf(size_t address, bool bit_value) const;
-  std::string hashInternal(const std::string& left_hash,
-                           const std::string& right_hash) const;
-  void updatePath(size_t leaf_index);
+  // Rehashes the leaves in dirty (ascending node ids) and every ancestor
+  // once, a level at a time. dirty is consumed.
+  void rehashUpward(std::vector<size_t>* dirty);
+  // Rehashes nodes that share one level: leaves from their bit, internal
+  // nodes from their children.
+  void hashNodes(const std::vector<size_t>& nodes, size_t level);
+
+  bool testBit(size_t index) const {
+    return (m_bits[index / 64] >> (index % 64)) & 1;
+  }
+  void assignBit(size_t index, bool value);
+
+  // Digest of node at level (0 = leaves), resolving unwritten slots to the
+  // all-zero subtree digest.
+  const uint8_t* nodeDigest(size_t node, size_t level) const;
 
-  std::unique_ptr<Node> m_root;
   size_t m_capacity;
-  uint64_t m_version;
-  std::vector<bool> m_bit_array;
+  size_t m_depth;  // levels above the leaves; proof length
+  // Implicit heap of digests: node 1 is the root, node i has children 2i and
+  // 2i+1, and leaf l is node m_capacity + l. Slot 0 is unused. Allocated
+  // zeroed (calloc, so untouched pages are never faulted in) by initialize().
+  std::unique_ptr<uint8_t[], FreeDeleter> m_digests;
+  // All-zero subtree digest per level
+  std::vector<uint8_t> m_zero;
+  uint8_t m_one_leaf[kDigestBytes];          // leaf digest of a set bit
+  std::vector<uint64_t> m_bits;              // leaf bits, 64 per word
+  std::unique_ptr<core::WorkerPool> m_pool;  // null: hash sequentially
 };
 
 }  // namespace verifiable
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace verifiable {
+
+/**
+ * @brief Interface shared by the QTree variants
+ *
+ * A QTree authenticates one bit per address under a single root hash.
+ * QTree folds addresses into a fixed power-of-two capacity; SparseQTree
+ * keys them by SHA-256 over the full 256-bit space.
+ */
+class QTreeBase {
+ public:
+  QTreeBase() : m_version(0) {}
+  virtual ~QTreeBase() {}
+
+  /**
+   * @brief Initialize the tree with given bit array
+   * @param bit_array The XSet bit array B^(t)
+   */
+  virtual void initialize(const std::vector<bool>& bit_array) = 0;
+
+  /**
+   * @brief Update a single bit and advance the version once
+   * @param address The address to update
+   * @param value The new bit value
+   */
+  void updateBit(const std::string& address, bool value) {
+    updateBits(std::vector<std::string>(1, address), value);
+  }
+
+  /**
+   * @brief Update a batch of addresses and advance the version once
+   * @param addresses The addresses to update
+   * @param value The new bit value
+   */
+  virtual void updateBits(const std::vector<std::string>& addresses,
+                          bool value) = 0;
+
+  /**
+   * @brief Read the current bit value at an address
+   * @param address The address to inspect
+   * @return Current bit stored for the address
+   */
+  virtual bool getBit(const std::string& address) const = 0;
+
+  /**
+   * @brief Generate authentication path for a single address
+   * @param address The address to prove
+   * @return Authentication path, checked by verifyPath
+   */
+  virtual std::vector<std::string> generateProof(
+      const std::string& address) const = 0;
+
+  /**
+   * @brief Generate Positive proof (k authentication paths)
+   * @param addresses List of k addresses that should all be 1
+   * @return Proof structure containing k paths
+   */
+  std::string generatePositiveProof(
+      const std::vector<std::string>& addresses) const;
+
+  /**
+   * @brief Generate Negative proof (1 authentication path for a 0 bit)
+   * @param address The address with bit value 0
+   * @return Proof structure containing 1 path
+   */
+  std::string generateNegativeProof(const std::string& address) const;
+
+  /**
+   * @brief Get current root hash (commitment)
+   * @return Root hash R_X^(t)
+   */
+  virtual std::string getRootHash() const = 0;
+
+  /**
+   * @brief Get current version number
+   */
+  uint64_t getVersion() const { return m_version; }
+
+  /**
+   * @brief Verify an authentication path
+   * @param address The address being verified
+   * @param bit_value The claimed bit value
+   * @param proof The authentication path
+   * @param root_hash The expected root hash
+   * @return true if verification passes
+   */
+  virtual bool verifyPath(const std::string& address, bool bit_value,
+                          const std::vector<std::string>& proof,
+                          const std::string& root_hash) const = 0;
+
+  /**
+   * @brief One proof covering every address, each needed digest sent once
+   * Paths to nearby addresses share their upper siblings, so this is
+   * smaller than one generateProof per address. The binary layout is
+   * tree-specific and starts with a big-endian u32 count.
+   */
+  virtual std::string generateMultiProof(
+      const std::vector<std::string>& addresses) const = 0;
+
+  /**
+   * @brief Check a generateMultiProof proof, hashing shared ancestors once
+   * @param bit_values The claimed bit of each address, in the same order
+   */
+  virtual bool verifyMultiProof(const std::vector<std::string>& addresses,
+                                const std::vector<bool>& bit_values,
+                                const std::string& proof,
+                                const std::string& root_hash) const = 0;
+
+  /**
+   * @brief Rehash large batches on num_threads threads; 1 (default) hashes
+   * on the calling thread only, 0 uses every hardware thread.
+   */
+  virtual void setHashThreads(size_t num_threads) = 0;
+
+ protected:
+  static const size_t kDigestBytes = 32;  // SHA-256
+
+  /** @brief SHA-256 through a reused per-thread EVP context */
+  static void Sha256(const uint8_t* in, size_t len, uint8_t* out);
+
+  /** @brief SHA-256(0x01 || left || right); out may alias either input */
+  static void HashChildren(const uint8_t* left_hash, const uint8_t* right_hash,
+                           uint8_t* out);
+
+  static void AppendU32(uint32_t value, std::string* out);
+  /** @brief Reads at *pos and advances it; false past the end */
+  static bool ReadU32(const std::string& in, size_t* pos, uint32_t* value);
+
+  uint64_t m_version;
+};
+
+}  // namespace verifiable
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/RelicContext.hpp"
+#include "verifiable/QTreeBase.hpp"
+
+namespace verifiable {
+
+/**
+ * @brief Sparse Merkle tree over the full 256-bit address space
+ *
+ * An address maps to the leaf at SHA-256(address), so distinct addresses do
+ * not collide and the tree never needs resizing. Only set bits are stored.
+ * A subtree holding a single set key is replaced by that key's leaf,
+ * SHA-256(0x00 || key), and an empty subtree has the all-zero digest. An
+ * internal node is SHA-256(0x01 || left || right) and always has at least
+ * two keys below it. Memory is proportional to the number of set bits, and
+ * a path is about log2(set bits) levels deep.
+ *
+ * generateProof returns {terminal, bitmap, siblings...}:
+ *  - terminal: 0x00 (empty subtree), 0x01 (the address's own leaf) or
+ *    0x02 || key (another key's leaf, proving the address unset);
+ *  - bitmap: u16be depth D || ceil(D/8) bytes, bit d set when the sibling
+ *    at depth d is non-empty;
+ *  - the non-empty siblings, root first. Empty siblings are omitted.
+ *
+ * generateMultiProof returns u32be record count || records, the subtree
+ * spanned by the addresses' paths in pre-order. A record is a tag byte:
+ * 0x00 empty subtree; 0x01 || key, a leaf; 0x02, a node with addresses on
+ * both sides (left then right follow); 0x03 || right digest, a node with
+ * addresses only on the left (the left follows); 0x04 || left digest, the
+ * mirror case.
+ */
+class SparseQTree : public QTreeBase {
+ public:
+  SparseQTree();
+  ~SparseQTree() override;
+
+  /**
+   * @brief Resets to an empty tree. Addresses are hashed, so bit_array may
+   * not contain set bits (std::invalid_argument).
+   */
+  void initialize(const std::vector<bool>& bit_array) override;
+
+  /** Applies every key first, then rehashes each dirty node once. */
+  void updateBits(const std::vector<std::string>& addresses,
+                  bool value) override;
+
+  bool getBit(const std::string& address) const override;
+
+  std::vector<std::string> generateProof(
+      const std::string& address) const override;
+
+  std::string getRootHash() const override;
+
+  bool verifyPath(const std::string& address, bool bit_value,
+                  const std::vector<std::string>& proof,
+                  const std::string& root_hash) const override;
+
+  std::string generateMultiProof(
+      const std::vector<std::string>& addresses) const override;
+
+  bool verifyMultiProof(const std::vector<std::string>& addresses,
+                        const std::vector<bool>& bit_values,
+                        const std::string& proof,
+                        const std::string& root_hash) const override;
+
+  void setHashThreads(size_t num_threads) override;
+
+  /** @brief Number of set bits */
+  size_t size() const { return m_size; }
+
+  /** @brief Bytes held by the node arena */
+  size_t memoryBytes() const;
+
+ private:
+  static const uint32_t kNone = 0xffffffffu;
+  static const size_t kKeyBits = 256;
+
+  struct Key {
+    uint8_t bytes[32];  // SHA-256(address)
+    bool bit(size_t depth) const {
+      return (bytes[depth / 8] >> (7 - depth % 8)) & 1;
+    }
+  };
+
+  struct Node {
+    uint8_t digest[32];  // leaf or internal digest
+    Key key;             // leaf only
+    uint32_t child[2];   // internal only
+    bool leaf;           // false: internal
+    bool dirty;          // internal digest needs recomputing
+  };
+
+  struct Claim {
+    Key key;
+    bool bit;
+  };
+
+  static Key KeyOf(const std::string& address);
+  static void LeafDigest(const Key& key, uint8_t* out);
+
+  uint32_t newLeaf(const Key& key);
+  uint32_t newInternal();
+  void freeNode(uint32_t index);
+  const uint8_t* digestOf(uint32_t index) const;
+
+  // Recursive edits below *slot at depth; true if anything changed. Changed
+  // internal nodes are marked dirty rather than rehashed.
+  bool insert(uint32_t* slot, const Key& key, size_t depth);
+  bool remove(uint32_t* slot, const Key& key, size_t depth);
+  // Rehashes dirty internal nodes, deepest first, one depth at a time.
+  void rehashDirty();
+  void collectDirty(uint32_t index, size_t depth,
+                    std::vector<std::vector<uint32_t>>* by_depth) const;
+
+  // Multiproof records for the sorted keys [first, last) below index.
+  void appendMultiProof(uint32_t index, const Key* first, const Key* last,
+                        size_t depth, std::string* out,
+                        uint32_t* records) const;
+  // Digest of the subtree holding the sorted claims [first, last) at depth,
+  // read from the records at *pos; false if a record is malformed or
+  // contradicts a claim.
+  static bool FoldMultiProof(const Claim* first, const Claim* last,
+                             size_t depth, const std::string& proof,
+                             size_t* pos, uint32_t* records, uint8_t* out);
+
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_free;
+  uint32_t m_root;
+  size_t m_size;
+  bool m_initialized;
+  std::unique_ptr<core::WorkerPool> m_pool;  // null: hash sequentially
+};
+
+}  // namespace verifiable
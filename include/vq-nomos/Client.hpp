@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "core/QueryPlanner.hpp"
+#include "core/RelicContext.hpp"
 #include "vq-nomos/types.hpp"
 
 namespace vqnomos {
@@ -13,9 +16,24 @@ class Client {
   Client();
   ~Client();
 
+  /** @brief qtree_capacity must match the gatekeeper's (0 = sparse) */
   int setup(const std::string& public_key_pem, const Anchor& initial_anchor,
             size_t qtree_capacity = 1024, int bucket_count = 10);
 
+  /**
+   * @brief Spread genToken's 2m hash-to-curve calls over num_threads threads
+   * 1 (default) hashes on the calling thread only; 0 uses every hardware
+   * thread.
+   */
+  void setHashThreads(size_t num_threads);
+
+  /**
+   * @brief How genToken orders the x-terms (see core::PlanQuery)
+   * kAscendingCount (default) probes the x-term with the fewest updates
+   * first; kInput keeps the caller's order.
+   */
+  void setXTermOrder(core::XTermOrder order) { m_xterm_order = order; }
+
   TokenRequest genToken(
       const std::vector<std::string>& query_keywords,
       const std::unordered_map<std::string, int>& update_count);
@@ -40,6 +58,8 @@ class Client {
   Anchor m_local_anchor;
   size_t m_qtree_capacity;
   int m_bucket_count;
+  std::unique_ptr<core::WorkerPool> m_pool;  // null: hash sequentially
+  core::XTermOrder m_xterm_order;
 };
 
 }  // namespace vqnomos
@@ -5,6 +5,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "core/Primitive.hpp"
+#include "core/ScalarField.hpp"
+#include "core/TokenPrefixCache.hpp"
 #include "vq-nomos/QTree.hpp"
 #include "vq-nomos/types.hpp"
 
@@ -19,11 +22,35 @@ class Gatekeeper {
   Gatekeeper();
   ~Gatekeeper();
 
-  int setup(int d = 10, size_t qtree_capacity = 1024);
+  /**
+   * @param qtree_capacity QTree leaves; 0 selects the sparse QTree
+   * @param ell ℓ, xtags stored per update (1..255)
+   * @param k Cross-tags sampled per x-term at query time (1..ell)
+   */
+  int setup(int d = 10, size_t qtree_capacity = 1024, int ell = 3, int k = 2);
+
+  int getEll() const { return m_ell; }
+  int getK() const { return m_k; }
 
   UpdateMetadata update(OP op, const std::string& id,
                         const std::string& keyword);
 
+  /**
+   * @brief Bulk form of update()
+   * All xtags go through one QTree::updateBits, so the QTree version
+   * advances once and every returned metadata carries the same final
+   * anchor. Apply the result with Server::updateBatch.
+   * @return UpdateMetadata in input order
+   */
+  std::vector<UpdateMetadata> updateBatch(
+      const std::vector<UpdateRequest>& requests);
+
+  /**
+   * @brief Threads for rehashing the QTree on update; 1 (default) keeps it
+   * on the calling thread only, 0 uses every hardware thread.
+   */
+  void setUpdateThreads(size_t num_threads);
+
   int getUpdateCount(const std::string& keyword) const;
 
   const std::unordered_map<std::string, int>& getUpdateCounts() const {
@@ -36,6 +63,19 @@ class Gatekeeper {
 
   SearchToken genToken(const TokenRequest& request);
 
+  /**
+   * @brief Cache bstag/delta prefixes per keyword within max_bytes
+   * Repeat genToken calls for w1 exponentiate only the j past the cached
+   * prefix. 0 (default) disables the cache; setup() empties it.
+   */
+  void setTokenCacheBudget(size_t max_bytes) {
+    m_token_cache.setBudget(max_bytes);
+  }
+
+  core::TokenPrefixCache::Stats tokenCacheStats() const {
+    return m_token_cache.stats();
+  }
+
   Anchor getCurrentAnchor() const;
   std::string getPublicKeyPem() const;
 
@@ -45,6 +85,10 @@ class Gatekeeper {
   std::string signMerkleRoot(const std::string& keyword,
                              const std::string& root_hash) const;
   Anchor buildAnchor() const;
+  // update() up to the QTree step; appends the xtag keys it will set.
+  UpdateMetadata buildUpdate(OP op, const std::string& id,
+                             const std::string& keyword,
+                             std::vector<std::string>* xtag_keys);
 
   bn_t m_Ks;
   bn_t* m_Kt;
@@ -54,8 +98,14 @@ class Gatekeeper {
 
   std::unordered_map<std::string, int> m_updateCnt;
   int m_d;
-
-  std::unique_ptr<QTree> m_qtree;
+  int m_ell;
+  int m_k;
+  std::unique_ptr<core::ScalarField> m_field;  // group order cached at setup
+  std::unique_ptr<KeyedPrf> m_ky_prf;  // F_p(Ky, .), HMAC state precomputed
+  core::TokenPrefixCache m_token_cache;  // emptied whenever the keys change
+
+  std::unique_ptr<QTreeBase> m_qtree;
+  size_t m_update_threads;
   EVP_PKEY* m_signing_key;
 };
 
@@ -1,9 +1,27 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+
 #include "verifiable/QTree.hpp"
+#include "verifiable/SparseQTree.hpp"
 
 namespace vqnomos {
 
+using QTreeBase = verifiable::QTreeBase;
 using QTree = verifiable::QTree;
+using SparseQTree = verifiable::SparseQTree;
+
+/**
+ * @brief QTree for a setup() qtree_capacity
+ * 0 selects the sparse tree over the full address space; any other value a
+ * dense QTree rounded up to a power of two.
+ */
+inline std::unique_ptr<QTreeBase> MakeQTree(size_t capacity) {
+  if (capacity == 0) {
+    return std::unique_ptr<QTreeBase>(new SparseQTree());
+  }
+  return std::unique_ptr<QTreeBase>(new QTree(capacity));
+}
 
 }  // namespace vqnomos
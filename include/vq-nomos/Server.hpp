@@ -4,6 +4,9 @@
 #include <memory>
 #include <string>
 
+#include "core/FlatTSet.hpp"
+#include "core/RelicContext.hpp"
+#include "core/XSet.hpp"
 #include "vq-nomos/MerkleOpen.hpp"
 #include "vq-nomos/QTree.hpp"
 #include "vq-nomos/types.hpp"
@@ -15,13 +18,28 @@ class Server {
   Server();
   ~Server();
 
+  /** @brief qtree_capacity must match the gatekeeper's (0 = sparse) */
   void setup(const std::vector<uint8_t>& Km, const Anchor& initial_anchor,
              size_t qtree_capacity = 1024);
 
   void update(const UpdateMetadata& metadata);
 
+  /**
+   * @brief Bulk form of update() for Gatekeeper::updateBatch output
+   * Rehashes the QTree once for all xtags and adopts the last anchor.
+   */
+  void updateBatch(const std::vector<UpdateMetadata>& metas);
+
+  // Rehash the QTree on update with up to num_threads threads (1 =
+  // sequential, 0 = all hardware threads).
+  void setUpdateThreads(size_t num_threads);
+
   SearchResponse search(const SearchRequest& request, const SearchToken& token);
 
+  // Prove stoken slots on up to num_threads threads (1 = sequential,
+  // 0 = all hardware threads).
+  void setSearchThreads(size_t num_threads);
+
   size_t getTSetSize() const { return m_TSet.size(); }
   size_t getXSetSize() const { return m_XSet.size(); }
 
@@ -34,14 +52,32 @@ class Server {
     MerklePosition() : leaf_index(0) {}
   };
 
-  std::string serializePoint(const ep_t point) const;
+  // Search-Prove' output for one stoken slot, merged into the response in
+  // slot order.
+  struct SlotProof {
+    bool found;
+    bool all_match;
+    CandidateEntry candidate;
+    std::vector<RelationProof> relation_proofs;
+
+    SlotProof() : found(false), all_match(false) {}
+  };
+
+  // update() up to the QTree step; appends the xtag keys it will set.
+  void storeUpdate(const UpdateMetadata& metadata,
+                   std::vector<std::string>* xtag_keys);
+
+  void proveSlot(const SearchRequest& request, const SearchToken& token, int j,
+                 const core::FlatTSet::Entry& entry, SlotProof* out) const;
 
-  std::map<std::string, TSetEntry> m_TSet;
-  std::map<std::string, bool> m_XSet;
+  core::FlatTSet m_TSet;
+  core::XSet m_XSet;
   std::map<std::string, MerklePosition> m_MPos;
   std::map<std::string, std::shared_ptr<MerkleOpenTree>> m_MTree;
-  std::unique_ptr<QTree> m_qtree;
+  std::unique_ptr<QTreeBase> m_qtree;
   Anchor m_current_anchor;
+  std::unique_ptr<core::WorkerPool> m_pool;
+  size_t m_update_threads;
 };
 
 }  // namespace vqnomos
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "core/Experiment.hpp"
+#include "core/Primitive.hpp"
 #include "vq-nomos/Client.hpp"
 #include "vq-nomos/Gatekeeper.hpp"
 #include "vq-nomos/Server.hpp"
@@ -23,8 +24,11 @@ class VQNomosExperiment : public core::Experiment {
       std::cerr << "Failed to initialize RELIC" << std::endl;
       return -1;
     }
-    if (pc_param_set_any() != RLC_OK) {
-      std::cerr << "Failed to set RELIC parameters" << std::endl;
+    try {
+      UseCurve(DefaultCurve());
+    } catch (const std::exception& e) {
+      std::cerr << "Failed to set RELIC parameters: " << e.what()
+                << std::endl;
       return -1;
     }
 
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include "core/CompressedPoint.hpp"
+
 extern "C" {
 #include <relic/relic.h>
 }
@@ -37,6 +39,7 @@ struct MerkleOpening {
 struct QTreeWitness {
   std::string address;
   bool bit_value;
+  // Empty for set bits, which SearchResponse::qtree_multiproof covers.
   std::vector<std::string> path;
 
   QTreeWitness() : bit_value(false) {}
@@ -72,13 +75,26 @@ struct SearchResponse {
   std::vector<int> result_slots;
   Anchor anchor;
   std::vector<RelationProof> relation_proofs;
+  // QTree multiproof for every bit_value = true witness in relation_proofs
+  std::string qtree_multiproof;
+};
+
+struct UpdateRequest {
+  OP op;
+  std::string id;
+  std::string keyword;
+
+  UpdateRequest() : op(OP_ADD) {}
+  UpdateRequest(OP op_in, const std::string& id_in,
+                const std::string& keyword_in)
+      : op(op_in), id(id_in), keyword(keyword_in) {}
 };
 
 struct UpdateMetadata {
   ep_t addr;
   std::vector<uint8_t> val;
   bn_t alpha;
-  std::vector<std::string> xtags;
+  std::vector<core::CompressedPoint> xtags;
   std::string keyword;
   std::string merkle_root;
   std::string merkle_signature;
@@ -131,19 +147,21 @@ struct UpdateMetadata {
 
 struct SearchToken {
   ep_t strap;
-  std::vector<std::string> bstag;
-  std::vector<std::string> delta;
-  std::vector<std::vector<std::string>> bxtrap;
+  std::vector<core::CompressedPoint> bstag;
+  std::vector<core::CompressedPoint> delta;
+  std::vector<std::vector<core::CompressedPoint>> bxtrap;
   std::vector<int> beta_indices;
+  int ell;  // ℓ: leaves per update Merkle tree, for path verification
   Anchor anchor;
 
-  SearchToken() { ep_null(strap); }
+  SearchToken() : ell(0) { ep_null(strap); }
 
   SearchToken(SearchToken&& other) noexcept
       : bstag(std::move(other.bstag)),
         delta(std::move(other.delta)),
         bxtrap(std::move(other.bxtrap)),
         beta_indices(std::move(other.beta_indices)),
+        ell(other.ell),
         anchor(std::move(other.anchor)) {
     std::memcpy(strap, other.strap, sizeof(ep_t));
     ep_null(other.strap);
@@ -156,6 +174,7 @@ struct SearchToken {
       delta = std::move(other.delta);
       bxtrap = std::move(other.bxtrap);
       beta_indices = std::move(other.beta_indices);
+      ell = other.ell;
       anchor = std::move(other.anchor);
       std::memcpy(strap, other.strap, sizeof(ep_t));
       ep_null(other.strap);
@@ -171,45 +190,30 @@ struct SearchToken {
 
 struct TokenRequest {
   std::vector<std::string> query_keywords;
-  std::vector<std::string> hashed_keywords;
-  std::vector<std::string> hw1_j_0;
-  std::vector<std::string> hw1_j_1;
+  std::vector<core::CompressedPoint> hashed_keywords;
+  std::vector<core::CompressedPoint> hw1_j_0;
+  std::vector<core::CompressedPoint> hw1_j_1;
 };
 
 struct SearchRequest {
   int num_keywords;
-  std::vector<std::string> stokenList;
-  std::vector<std::vector<std::vector<std::string>>> xtokenList;
+  std::vector<core::CompressedPoint> stokenList;
+  std::vector<std::vector<std::vector<core::CompressedPoint>>> xtokenList;
 
   SearchRequest() : num_keywords(0) {}
 };
 
-struct TSetEntry {
-  std::vector<uint8_t> val;
-  bn_t alpha;
-
-  TSetEntry() { bn_null(alpha); }
-
-  TSetEntry(TSetEntry&& other) noexcept : val(std::move(other.val)) {
-    std::memcpy(alpha, other.alpha, sizeof(bn_t));
-    bn_null(other.alpha);
-  }
-
-  TSetEntry& operator=(TSetEntry&& other) noexcept {
-    if (this != &other) {
-      bn_free(alpha);
-      val = std::move(other.val);
-      std::memcpy(alpha, other.alpha, sizeof(bn_t));
-      bn_null(other.alpha);
-    }
-    return *this;
+// MerkleOpenTree and QTree are shared with the verifiable scheme and address
+// leaves by byte string.
+inline std::vector<std::string> XtagStrings(
+    const std::vector<core::CompressedPoint>& xtags) {
+  std::vector<std::string> out;
+  out.reserve(xtags.size());
+  for (size_t i = 0; i < xtags.size(); ++i) {
+    out.push_back(xtags[i].str());
   }
-
-  ~TSetEntry() { bn_free(alpha); }
-
-  TSetEntry(const TSetEntry&) = delete;
-  TSetEntry& operator=(const TSetEntry&) = delete;
-};
+  return out;
+}
 
 struct VerificationResult {
   bool accepted;
@@ -6,7 +6,14 @@ set -euo pipefail
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 NOMOS_ROOT="$(cd "${SCRIPT_DIR}/.." && pwd)"
 NOMOS_BIN="${NOMOS_ROOT}/build/Nomos"
-OUTPUT_DIR="${NOMOS_ROOT}/results/ch4/"
+# CURVE=secp256k1|p256 writes to results/ch4-<curve>/ for side-by-side
+# comparison with the default pairing-curve results.
+CURVE="${CURVE:-pairing}"
+if [ "${CURVE}" = "pairing" ]; then
+    OUTPUT_DIR="${NOMOS_ROOT}/results/ch4/"
+else
+    OUTPUT_DIR="${NOMOS_ROOT}/results/ch4-${CURVE}/"
+fi
 LOG_DIR="${OUTPUT_DIR}/logs-fixed-w2"
 
 mkdir -p "${OUTPUT_DIR}/client_search_time_fixed_w2"
@@ -25,6 +32,7 @@ for dataset in Crime Enron Wiki; do
     "${NOMOS_BIN}" chapter4-client-search-fixed-w2 \
         --dataset "${dataset}" \
         --output-dir "${OUTPUT_DIR}" \
+        --curve "${CURVE}" \
         > "${LOG_DIR}/${dataset}.log" 2>&1
 done
 
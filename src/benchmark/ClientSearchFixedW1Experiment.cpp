@@ -3,6 +3,7 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -32,13 +33,19 @@ ClientSearchFixedW1Experiment::ClientSearchFixedW1Experiment()
     : dataset_(DatasetLoader::Dataset::None),
       run_all_datasets_(true),
       output_dir_("results/ch4/"),
-      scheme_filter_("all") {}
+      scheme_filter_("all"),
+      server_threads_(1),
+      client_threads_(1),
+      pipeline_chunk_(0) {}
 
 int ClientSearchFixedW1Experiment::setup() {
   std::cout << "[ClientSearchFixedW1] Setting up..." << std::endl;
   ensureDirectory(joinPath(output_dir_, "client_search_time_fixed_w1"));
   ensureDirectory(joinPath(output_dir_, "server_search_time_fixed_w1"));
   ensureDirectory(joinPath(output_dir_, "gatekeeper_search_time_fixed_w1"));
+  if (pipeline_chunk_ > 0) {
+    ensureDirectory(joinPath(output_dir_, "pipelined_search_time_fixed_w1"));
+  }
   return 0;
 }
 
@@ -96,6 +103,18 @@ void ClientSearchFixedW1Experiment::setSchemeFilter(
   scheme_filter_ = normalizeSchemeFilter(scheme_filter);
 }
 
+void ClientSearchFixedW1Experiment::setServerThreads(size_t server_threads) {
+  server_threads_ = server_threads;
+}
+
+void ClientSearchFixedW1Experiment::setClientThreads(size_t client_threads) {
+  client_threads_ = client_threads;
+}
+
+void ClientSearchFixedW1Experiment::setPipelineChunk(size_t chunk_slots) {
+  pipeline_chunk_ = chunk_slots;
+}
+
 std::vector<DatasetLoader::Dataset>
 ClientSearchFixedW1Experiment::getDatasetsToRun() const {
   if (!run_all_datasets_ && dataset_ != DatasetLoader::Dataset::None) {
@@ -250,6 +269,46 @@ void ClientSearchFixedW1Experiment::runDataset(const DatasetSpec& spec) const {
     writeSchemeCsv(outputs[d].first, "VQNomos", vqnomos_rows,
                    outputs[d].second);
   }
+  writePipelineCsv(nomos_rows, nomos_times.pipeline_stats);
+}
+
+void ClientSearchFixedW1Experiment::writePipelineCsv(
+    const std::vector<ClientSearchRow>& rows,
+    const std::vector<PipelinedSearch::Stats>& pipeline_stats) const {
+  if (rows.empty() || rows.size() != pipeline_stats.size()) {
+    return;
+  }
+
+  const std::string filename =
+      joinPath(joinPath(output_dir_, "pipelined_search_time_fixed_w1"),
+               "Nomos_" + rows.front().dataset + ".csv");
+  std::ofstream file(filename.c_str());
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open output file: " + filename);
+  }
+
+  file << "dataset,scheme,upd_w1,upd_w2,chunk_slots,chunks,sequential_ms,"
+          "latency_ms,first_chunk_ms";
+  for (int stage = 0; stage < PipelinedSearch::kStageCount; ++stage) {
+    file << ","
+         << PipelinedSearch::StageName(
+                static_cast<PipelinedSearch::Stage>(stage))
+         << "_occupancy";
+  }
+  file << "\n";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const ClientSearchRow& row = rows[i];
+    const PipelinedSearch::Stats& stats = pipeline_stats[i];
+    file << row.dataset << "," << row.scheme << "," << row.upd_w1 << ","
+         << row.upd_w2 << "," << pipeline_chunk_ << "," << stats.chunks << ","
+         << (row.client_time_ms + row.gatekeeper_time_ms + row.server_time_ms)
+         << "," << stats.latency_ms << "," << stats.first_chunk_ms;
+    for (int stage = 0; stage < PipelinedSearch::kStageCount; ++stage) {
+      file << ","
+           << stats.occupancy(static_cast<PipelinedSearch::Stage>(stage));
+    }
+    file << "\n";
+  }
 }
 
 void ClientSearchFixedW1Experiment::writeSchemeCsv(
@@ -295,8 +354,13 @@ ClientSearchFixedW1Experiment::runNomosSweep(const DatasetSpec& spec) const {
 
   gatekeeper.setup(10);
   client.setup();
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm());
+  server.setSearchThreads(server_threads_);
+  // Ingestion is not timed, so it reuses the server thread budget.
+  gatekeeper.setUpdateThreads(server_threads_);
 
+  std::vector<UpdateRequest> ingest;
   for (size_t point = 0; point < spec.upd_w2_values.size(); ++point) {
     const size_t target_w2_count = spec.upd_w2_values[point].first;
     const std::string w2_keyword = spec.upd_w2_values[point].second;
@@ -304,10 +368,16 @@ ClientSearchFixedW1Experiment::runNomosSweep(const DatasetSpec& spec) const {
 
     for (size_t next = 0; next < target_w2_count; ++next) {
       const std::string doc_id = "doc_" + std::to_string(next + 1);
-      const UpdateMetadata meta = gatekeeper.update(OP_ADD, doc_id, w2_keyword);
-      server.update(meta);
+      ingest.push_back(UpdateRequest(OP_ADD, doc_id, w2_keyword));
     }
   }
+  server.updateBatch(gatekeeper.updateBatch(ingest));
+
+  std::unique_ptr<PipelinedSearch> pipeline;
+  if (pipeline_chunk_ > 0) {
+    pipeline.reset(new PipelinedSearch(&client, &gatekeeper, &server));
+    pipeline->setChunkSlots(pipeline_chunk_);
+  }
 
   // 执行search操作
   for (size_t point = 0; point < spec.upd_w2_values.size(); ++point) {
@@ -355,6 +425,13 @@ ClientSearchFixedW1Experiment::runNomosSweep(const DatasetSpec& spec) const {
         durationToMilliseconds(gatekeeper_end - gatekeeper_start);
     result.server_times[point] =
         durationToMilliseconds(server_end - server_start);
+
+    // Same query again, as a chunked pipeline over the three parties.
+    if (pipeline) {
+      PipelinedSearch::Stats stats;
+      pipeline->run(query, &stats);
+      result.pipeline_stats.push_back(stats);
+    }
   }
 
   return result;
@@ -373,7 +450,9 @@ ClientSearchFixedW1Experiment::runMcOdxtSweep(const DatasetSpec& spec) const {
 
   gatekeeper.setup(10);
   client.setup();
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm());
+  server.setSearchThreads(server_threads_);
 
   for (size_t point = 0; point < spec.upd_w2_values.size(); ++point) {
     const size_t target_w2_count = spec.upd_w2_values[point].first;
@@ -453,7 +532,9 @@ ClientSearchFixedW1Experiment::runVQNomosSweep(const DatasetSpec& spec) const {
   const vqnomos::Anchor initial_anchor = gatekeeper.getCurrentAnchor();
   client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, kQTreeCapacity,
                10);
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm(), initial_anchor, kQTreeCapacity);
+  server.setSearchThreads(server_threads_);
 
   for (size_t point = 0; point < spec.upd_w2_values.size(); ++point) {
     const size_t target_w2_count = spec.upd_w2_values[point].first;
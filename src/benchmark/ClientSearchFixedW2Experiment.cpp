@@ -3,6 +3,7 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -32,13 +33,19 @@ ClientSearchFixedW2Experiment::ClientSearchFixedW2Experiment()
     : dataset_(DatasetLoader::Dataset::None),
       run_all_datasets_(true),
       output_dir_("results/ch4/"),
-      scheme_filter_("all") {}
+      scheme_filter_("all"),
+      server_threads_(1),
+      client_threads_(1),
+      pipeline_chunk_(0) {}
 
 int ClientSearchFixedW2Experiment::setup() {
   std::cout << "[ClientSearchFixedW2] Setting up..." << std::endl;
   ensureDirectory(joinPath(output_dir_, "client_search_time_fixed_w2"));
   ensureDirectory(joinPath(output_dir_, "server_search_time_fixed_w2"));
   ensureDirectory(joinPath(output_dir_, "gatekeeper_search_time_fixed_w2"));
+  if (pipeline_chunk_ > 0) {
+    ensureDirectory(joinPath(output_dir_, "pipelined_search_time_fixed_w2"));
+  }
   return 0;
 }
 
@@ -89,6 +96,18 @@ void ClientSearchFixedW2Experiment::setSchemeFilter(
   scheme_filter_ = normalizeSchemeFilter(scheme_filter);
 }
 
+void ClientSearchFixedW2Experiment::setServerThreads(size_t server_threads) {
+  server_threads_ = server_threads;
+}
+
+void ClientSearchFixedW2Experiment::setClientThreads(size_t client_threads) {
+  client_threads_ = client_threads;
+}
+
+void ClientSearchFixedW2Experiment::setPipelineChunk(size_t chunk_slots) {
+  pipeline_chunk_ = chunk_slots;
+}
+
 std::vector<DatasetLoader::Dataset>
 ClientSearchFixedW2Experiment::getDatasetsToRun() const {
   if (!run_all_datasets_ && dataset_ != DatasetLoader::Dataset::None) {
@@ -240,6 +259,46 @@ void ClientSearchFixedW2Experiment::runDataset(const DatasetSpec& spec) const {
     writeSchemeCsv(output.first, "VQNomos", vqnomos_rows,
                    output.second);
   }
+  writePipelineCsv(nomos_rows, nomos_times.pipeline_stats);
+}
+
+void ClientSearchFixedW2Experiment::writePipelineCsv(
+    const std::vector<ClientSearchRow>& rows,
+    const std::vector<PipelinedSearch::Stats>& pipeline_stats) const {
+  if (rows.empty() || rows.size() != pipeline_stats.size()) {
+    return;
+  }
+
+  const std::string filename =
+      joinPath(joinPath(output_dir_, "pipelined_search_time_fixed_w2"),
+               "Nomos_" + rows.front().dataset + ".csv");
+  std::ofstream file(filename.c_str());
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open output file: " + filename);
+  }
+
+  file << "dataset,scheme,upd_w1,upd_w2,chunk_slots,chunks,sequential_ms,"
+          "latency_ms,first_chunk_ms";
+  for (int stage = 0; stage < PipelinedSearch::kStageCount; ++stage) {
+    file << ","
+         << PipelinedSearch::StageName(
+                static_cast<PipelinedSearch::Stage>(stage))
+         << "_occupancy";
+  }
+  file << "\n";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const ClientSearchRow& row = rows[i];
+    const PipelinedSearch::Stats& stats = pipeline_stats[i];
+    file << row.dataset << "," << row.scheme << "," << row.upd_w1 << ","
+         << row.upd_w2 << "," << pipeline_chunk_ << "," << stats.chunks << ","
+         << (row.client_time_ms + row.gatekeeper_time_ms + row.server_time_ms)
+         << "," << stats.latency_ms << "," << stats.first_chunk_ms;
+    for (int stage = 0; stage < PipelinedSearch::kStageCount; ++stage) {
+      file << ","
+           << stats.occupancy(static_cast<PipelinedSearch::Stage>(stage));
+    }
+    file << "\n";
+  }
 }
 
 void ClientSearchFixedW2Experiment::writeSchemeCsv(
@@ -285,18 +344,29 @@ ClientSearchFixedW2Experiment::runNomosSweep(const DatasetSpec& spec) const {
 
   gatekeeper.setup(10);
   client.setup();
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm());
+  server.setSearchThreads(server_threads_);
+  // Ingestion is not timed, so it reuses the server thread budget.
+  gatekeeper.setUpdateThreads(server_threads_);
 
+  std::vector<UpdateRequest> ingest;
   for (size_t point = 0; point < spec.upd_w1_values.size(); ++point) {
     const size_t target_w1_count = spec.upd_w1_values[point].first;
     const std::string w1_keyword = spec.upd_w1_values[point].second;
 
     for (size_t next = 0; next < target_w1_count; ++next) {
       const std::string doc_id = "doc_" + std::to_string(next + 1);
-      const UpdateMetadata meta = gatekeeper.update(OP_ADD, doc_id, w1_keyword);
-      server.update(meta);
+      ingest.push_back(UpdateRequest(OP_ADD, doc_id, w1_keyword));
     }
   }
+  server.updateBatch(gatekeeper.updateBatch(ingest));
+
+  std::unique_ptr<PipelinedSearch> pipeline;
+  if (pipeline_chunk_ > 0) {
+    pipeline.reset(new PipelinedSearch(&client, &gatekeeper, &server));
+    pipeline->setChunkSlots(pipeline_chunk_);
+  }
 
   for (size_t point = 0; point < spec.upd_w1_values.size(); ++point) {
     const std::string w1_keyword = spec.upd_w1_values[point].second;
@@ -341,6 +411,13 @@ ClientSearchFixedW2Experiment::runNomosSweep(const DatasetSpec& spec) const {
         durationToMilliseconds(gatekeeper_end - gatekeeper_start);
     result.server_times[point] =
         durationToMilliseconds(server_end - server_start);
+
+    // Same query again, as a chunked pipeline over the three parties.
+    if (pipeline) {
+      PipelinedSearch::Stats stats;
+      pipeline->run({w1_keyword, spec.w2_keyword}, &stats);
+      result.pipeline_stats.push_back(stats);
+    }
   }
   return result;
 }
@@ -358,7 +435,9 @@ ClientSearchFixedW2Experiment::runMcOdxtSweep(const DatasetSpec& spec) const {
 
   gatekeeper.setup(10);
   client.setup();
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm());
+  server.setSearchThreads(server_threads_);
 
   for (size_t point = 0; point < spec.upd_w1_values.size(); ++point) {
     const size_t target_w1_count = spec.upd_w1_values[point].first;
@@ -435,7 +514,9 @@ ClientSearchFixedW2Experiment::runVQNomosSweep(const DatasetSpec& spec) const {
   const vqnomos::Anchor initial_anchor = gatekeeper.getCurrentAnchor();
   client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, kQTreeCapacity,
                10);
+  client.setHashThreads(client_threads_);
   server.setup(gatekeeper.getKm(), initial_anchor, kQTreeCapacity);
+  server.setSearchThreads(server_threads_);
 
   for (size_t point = 0; point < spec.upd_w1_values.size(); ++point) {
     const size_t target_w1_count = spec.upd_w1_values[point].first;
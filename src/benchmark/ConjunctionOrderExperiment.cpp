@@ -0,0 +1,175 @@
+#include "benchmark/ConjunctionOrderExperiment.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmark/BenchmarkUtils.hpp"
+#include "nomos/Client.hpp"
+#include "nomos/Gatekeeper.hpp"
+#include "nomos/Server.hpp"
+
+namespace nomos {
+namespace benchmark {
+namespace {
+
+const size_t kMinKeywords = 3;
+const size_t kMaxKeywords = 8;
+const int kRepeats = 5;
+
+std::string keywordName(size_t index) {
+  return "w" + std::to_string(index + 1);
+}
+
+const char* orderName(core::XTermOrder order) {
+  return order == core::XTermOrder::kInput ? "input" : "ascending_count";
+}
+
+}  // namespace
+
+ConjunctionOrderExperiment::ConjunctionOrderExperiment()
+    : output_dir_("results/ch4/"), server_threads_(1), s_term_updates_(256) {}
+
+int ConjunctionOrderExperiment::setup() {
+  std::cout << "[ConjunctionOrder] Setting up..." << std::endl;
+  if (s_term_updates_ >> (kMaxKeywords - 1) == 0) {
+    std::cerr << "[ConjunctionOrder] s-term needs at least "
+              << (1u << (kMaxKeywords - 1)) << " updates" << std::endl;
+    return 1;
+  }
+  ensureDirectory(joinPath(output_dir_, "conjunction_order"));
+  return 0;
+}
+
+void ConjunctionOrderExperiment::run() {
+  std::cout << "[ConjunctionOrder] |Upd(s-term)| = " << s_term_updates_
+            << ", n = " << kMinKeywords << ".." << kMaxKeywords << std::endl;
+
+  std::vector<OrderRow> rows;
+  for (size_t n = kMinKeywords; n <= kMaxKeywords; ++n) {
+    const OrderRow input = measure(n, core::XTermOrder::kInput);
+    const OrderRow planned = measure(n, core::XTermOrder::kAscendingCount);
+    if (input.results != planned.results) {
+      throw std::runtime_error("x-term order changed the result count for n=" +
+                               std::to_string(n));
+    }
+    std::cout << "  n=" << n << ": input " << input.server_time_ms
+              << " ms, ascending_count " << planned.server_time_ms << " ms ("
+              << planned.results << " results)" << std::endl;
+    rows.push_back(input);
+    rows.push_back(planned);
+  }
+  writeCsv(rows);
+}
+
+void ConjunctionOrderExperiment::teardown() {
+  std::cout << "[ConjunctionOrder] Tearing down..." << std::endl;
+}
+
+std::string ConjunctionOrderExperiment::getName() const {
+  return "chapter4-conjunction-order";
+}
+
+void ConjunctionOrderExperiment::setOutputDir(const std::string& output_dir) {
+  if (!output_dir.empty()) {
+    output_dir_ = output_dir;
+  }
+}
+
+void ConjunctionOrderExperiment::setServerThreads(size_t server_threads) {
+  server_threads_ = server_threads;
+}
+
+void ConjunctionOrderExperiment::setSTermUpdates(size_t s_term_updates) {
+  s_term_updates_ = s_term_updates;
+}
+
+ConjunctionOrderExperiment::OrderRow ConjunctionOrderExperiment::measure(
+    size_t num_keywords, core::XTermOrder order) const {
+  Gatekeeper gatekeeper;
+  Client client;
+  Server server;
+
+  gatekeeper.setup(10);
+  client.setup();
+  client.setXTermOrder(order);
+  server.setup(gatekeeper.getKm());
+  server.setSearchThreads(server_threads_);
+  gatekeeper.setUpdateThreads(server_threads_);
+
+  // w1 is the s-term; x-term w(k+1) shares s_term_updates_ >> k of its
+  // documents and has s_term_updates_ + (s_term_updates_ >> k) updates.
+  std::vector<UpdateRequest> ingest;
+  for (size_t d = 0; d < s_term_updates_; ++d) {
+    ingest.push_back(
+        UpdateRequest(OP_ADD, "doc_" + std::to_string(d + 1), keywordName(0)));
+  }
+  for (size_t k = 1; k < num_keywords; ++k) {
+    const size_t shared = s_term_updates_ >> k;
+    for (size_t d = 0; d < shared; ++d) {
+      ingest.push_back(UpdateRequest(OP_ADD, "doc_" + std::to_string(d + 1),
+                                     keywordName(k)));
+    }
+    for (size_t d = 0; d < s_term_updates_; ++d) {
+      ingest.push_back(UpdateRequest(
+          OP_ADD, "pad_" + std::to_string(k) + "_" + std::to_string(d + 1),
+          keywordName(k)));
+    }
+  }
+  server.updateBatch(gatekeeper.updateBatch(ingest));
+
+  // Broadest x-term first: the order kAscendingCount has to undo.
+  std::vector<std::string> query;
+  for (size_t k = 0; k < num_keywords; ++k) {
+    query.push_back(keywordName(k));
+  }
+
+  OrderRow row;
+  row.num_keywords = num_keywords;
+  row.order = orderName(order);
+  row.server_time_ms = 0.0;
+  row.results = 0;
+  for (int repeat = 0; repeat < kRepeats; ++repeat) {
+    const TokenRequest token_request =
+        client.genToken(query, gatekeeper.getUpdateCounts());
+    const SearchToken search_token = gatekeeper.genToken(token_request);
+    const Client::SearchRequest request =
+        client.prepareSearch(search_token, token_request);
+
+    const std::chrono::high_resolution_clock::time_point server_start =
+        std::chrono::high_resolution_clock::now();
+    const std::vector<SearchResultEntry> encrypted_results =
+        server.search(request);
+    const std::chrono::high_resolution_clock::time_point server_end =
+        std::chrono::high_resolution_clock::now();
+
+    row.server_time_ms += durationToMilliseconds(server_end - server_start);
+    row.results = client.decryptResults(encrypted_results, search_token).size();
+  }
+  row.server_time_ms /= kRepeats;
+  return row;
+}
+
+void ConjunctionOrderExperiment::writeCsv(
+    const std::vector<OrderRow>& rows) const {
+  const std::string filename = joinPath(
+      joinPath(output_dir_, "conjunction_order"), "Nomos_synthetic.csv");
+  std::ofstream file(filename.c_str());
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open output file: " + filename);
+  }
+
+  file << "scheme,upd_s_term,num_keywords,xterm_order,server_time_ms,results\n";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const OrderRow& row = rows[i];
+    file << "Nomos," << s_term_updates_ << "," << row.num_keywords << ","
+         << row.order << "," << row.server_time_ms << "," << row.results
+         << "\n";
+  }
+}
+
+}  // namespace benchmark
+}  // namespace nomos
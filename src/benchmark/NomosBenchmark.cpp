@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include "core/Primitive.hpp"
+
 namespace nomos {
 namespace benchmark {
 
@@ -17,8 +19,7 @@ NomosBenchmark::NomosBenchmark()
 NomosBenchmark::~NomosBenchmark() {
   // RELIC resource cleanup:
   // - Gatekeeper destructor frees bn_t keys (m_Ks, m_Ky, m_Kt[], m_Kx[])
-  // - Server destructor clears m_TSet (TSetEntry destructor frees bn_t
-  // alpha)
+  // - Server stores alpha inline in its flat TSet, so it holds no bn_t
   // - Client has no RELIC resources to clean up
   // - unique_ptr automatically calls destructors in reverse order
 }
@@ -66,7 +67,8 @@ double NomosBenchmark::setupPhase(const BenchmarkConfig& config) {
   // Setup with parameters
   // d = key array size (default 10 is fine for benchmarking)
   // Note: RELIC must be initialized before calling setup()
-  int ret = gatekeeper_->setup(10);
+  int ret = gatekeeper_->setup(10, static_cast<int>(config.cross_tags_l),
+                               static_cast<int>(config.cross_tags_k));
   if (ret != 0) {
     throw std::runtime_error("Gatekeeper setup failed with code " +
                              std::to_string(ret));
@@ -145,8 +147,10 @@ void NomosBenchmark::measureStorage(BenchmarkResult& result) {
   // TSet entry: ep_t addr (33 bytes compressed) + encrypted(id||op) (~48 bytes
   // AES) + bn_t alpha (32 bytes) = 113 bytes XSet entry: ep_t xtag (33 bytes
   // compressed)
-  const size_t TSET_ENTRY_SIZE = 113;  // ep_t(33) + AES(48) + bn_t(32)
-  const size_t XSET_ENTRY_SIZE = 33;   // ep_t(33) compressed
+  // Point and scalar sizes follow the active curve (33 / 32 for all of the
+  // supported curves).
+  const size_t TSET_ENTRY_SIZE = PointBytes() + 48 + ScalarBytes();
+  const size_t XSET_ENTRY_SIZE = PointBytes();
 
   result.tset_size_bytes = server_->getTSetSize() * TSET_ENTRY_SIZE;
   result.xset_size_bytes = server_->getXSetSize() * XSET_ENTRY_SIZE;
@@ -158,7 +162,7 @@ void NomosBenchmark::measureCommunication(BenchmarkResult& result) {
   // - stag: 1 ep_t = 33 bytes (compressed elliptic curve point)
   // - xtokens: k * ℓ * ep_t = k * ℓ * 33 bytes
   // - env: AES-128 encrypted data = 48 bytes (typical for id||op)
-  const size_t EP_T_SIZE = 33;  // Compressed elliptic curve point
+  const size_t EP_T_SIZE = PointBytes();  // Compressed elliptic curve point
   const size_t ENV_SIZE = 48;   // AES-128 encrypted payload
 
   size_t stag_size = EP_T_SIZE;
@@ -0,0 +1,276 @@
+#include "core/FlatTSet.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace core {
+
+namespace {
+
+const size_t kMinCapacity = 16;
+
+// Number of keys findBatch prefetches ahead of the one being probed.
+const size_t kPrefetchDistance = 8;
+
+inline void prefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(addr);
+#else
+  (void)addr;
+#endif
+}
+
+// Keep the load factor at or below 3/4.
+size_t capacityFor(size_t entries) {
+  size_t capacity = kMinCapacity;
+  while (capacity - capacity / 4 < entries) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+void writeScalar(uint8_t* out, const bn_t alpha) {
+  const int len = bn_size_bin(alpha);
+  if (len > static_cast<int>(FlatTSet::kScalarBytes)) {
+    throw std::invalid_argument("FlatTSet: alpha exceeds 32 bytes");
+  }
+  std::memset(out, 0, FlatTSet::kScalarBytes);
+  if (len > 0) {
+    bn_write_bin(out + FlatTSet::kScalarBytes - len, len, alpha);
+  }
+}
+
+}  // namespace
+
+const size_t FlatTSet::kKeyBytes;
+const size_t FlatTSet::kScalarBytes;
+
+FlatTSet::FlatTSet() : m_size(0) {}
+
+size_t FlatTSet::memoryBytes() const {
+  return m_ctrl.capacity() + m_slots.capacity() * sizeof(Slot) +
+         m_arena.capacity();
+}
+
+uint64_t FlatTSet::hashKey(const uint8_t* key, size_t len) {
+  // FNV-1a followed by a murmur3 finalizer so both the slot index (low bits)
+  // and the control tag (high bits) are well mixed.
+  uint64_t h = 1469598103934665603ULL;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= key[i];
+    h *= 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+size_t FlatTSet::locate(const uint8_t* key, size_t len, uint64_t hash) const {
+  const size_t mask = m_ctrl.size() - 1;
+  const uint8_t tag = tagOf(hash);
+  for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+    const uint8_t ctrl = m_ctrl[i];
+    if (ctrl == 0) {
+      return i;
+    }
+    if (ctrl == tag) {
+      const Slot& slot = m_slots[i];
+      if (slot.key_len == len && std::memcmp(slot.key, key, len) == 0) {
+        return i;
+      }
+    }
+  }
+}
+
+void FlatTSet::insertHashed(const uint8_t* key, size_t len, uint64_t hash,
+                            const uint8_t* val, size_t val_len,
+                            const bn_t alpha) {
+  uint8_t alpha_bytes[kScalarBytes];
+  writeScalar(alpha_bytes, alpha);
+
+  const size_t index = locate(key, len, hash);
+  Slot& slot = m_slots[index];
+
+  if (m_ctrl[index] == 0) {
+    m_ctrl[index] = tagOf(hash);
+    std::memcpy(slot.key, key, len);
+    slot.key_len = static_cast<uint8_t>(len);
+    slot.val_len = 0;
+    slot.val_offset = m_arena.size();
+    ++m_size;
+  }
+
+  // Overwrites reuse the old val bytes when the new value fits.
+  if (val_len > slot.val_len) {
+    slot.val_offset = m_arena.size();
+    m_arena.insert(m_arena.end(), val, val + val_len);
+  } else if (val_len > 0) {
+    std::memcpy(&m_arena[slot.val_offset], val, val_len);
+  }
+  slot.val_len = static_cast<uint32_t>(val_len);
+  std::memcpy(slot.alpha, alpha_bytes, kScalarBytes);
+}
+
+void FlatTSet::rehash(size_t new_capacity) {
+  std::vector<uint8_t> old_ctrl;
+  std::vector<Slot> old_slots;
+  old_ctrl.swap(m_ctrl);
+  old_slots.swap(m_slots);
+
+  m_ctrl.assign(new_capacity, 0);
+  m_slots.resize(new_capacity);
+
+  const size_t mask = new_capacity - 1;
+  for (size_t i = 0; i < old_ctrl.size(); ++i) {
+    if (old_ctrl[i] == 0) {
+      continue;
+    }
+    const Slot& slot = old_slots[i];
+    const uint64_t hash = hashKey(slot.key, slot.key_len);
+    size_t j = static_cast<size_t>(hash) & mask;
+    while (m_ctrl[j] != 0) {
+      j = (j + 1) & mask;
+    }
+    m_ctrl[j] = old_ctrl[i];
+    m_slots[j] = slot;
+  }
+}
+
+void FlatTSet::reserveSlots(size_t entries) {
+  const size_t needed = capacityFor(entries);
+  if (needed > m_ctrl.size()) {
+    rehash(needed);
+  }
+}
+
+void FlatTSet::insert(const std::string& key, const std::vector<uint8_t>& val,
+                      const bn_t alpha) {
+  if (key.size() > kKeyBytes) {
+    throw std::invalid_argument("FlatTSet: key exceeds 33 bytes");
+  }
+  reserveSlots(m_size + 1);
+  const uint8_t* key_bytes = reinterpret_cast<const uint8_t*>(key.data());
+  insertHashed(key_bytes, key.size(), hashKey(key_bytes, key.size()),
+               val.data(), val.size(), alpha);
+}
+
+void FlatTSet::insert(const CompressedPoint& key,
+                      const std::vector<uint8_t>& val, const bn_t alpha) {
+  reserveSlots(m_size + 1);
+  insertHashed(key.data(), CompressedPoint::kBytes,
+               hashKey(key.data(), CompressedPoint::kBytes), val.data(),
+               val.size(), alpha);
+}
+
+void FlatTSet::bulkBuild(const std::vector<Record>& records) {
+  size_t val_bytes = 0;
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (records[i].key_len > kKeyBytes) {
+      throw std::invalid_argument("FlatTSet: key exceeds 33 bytes");
+    }
+    val_bytes += records[i].val->size();
+  }
+
+  reserveSlots(m_size + records.size());
+  m_arena.reserve(m_arena.size() + val_bytes);
+
+  for (size_t i = 0; i < records.size(); ++i) {
+    const Record& record = records[i];
+    insertHashed(record.key, record.key_len,
+                 hashKey(record.key, record.key_len), record.val->data(),
+                 record.val->size(), record.alpha);
+  }
+}
+
+FlatTSet::Entry FlatTSet::entryAt(size_t index) const {
+  Entry entry;
+  if (m_ctrl[index] == 0) {
+    return entry;
+  }
+  const Slot& slot = m_slots[index];
+  entry.val = m_arena.data() + slot.val_offset;
+  entry.val_len = slot.val_len;
+  entry.alpha = slot.alpha;
+  return entry;
+}
+
+FlatTSet::Entry FlatTSet::find(const std::string& key) const {
+  if (m_size == 0 || key.size() > kKeyBytes) {
+    return Entry();
+  }
+  const uint8_t* key_bytes = reinterpret_cast<const uint8_t*>(key.data());
+  return entryAt(
+      locate(key_bytes, key.size(), hashKey(key_bytes, key.size())));
+}
+
+FlatTSet::Entry FlatTSet::find(const CompressedPoint& key) const {
+  if (m_size == 0) {
+    return Entry();
+  }
+  return entryAt(locate(key.data(), CompressedPoint::kBytes,
+                        hashKey(key.data(), CompressedPoint::kBytes)));
+}
+
+std::vector<FlatTSet::Entry> FlatTSet::findBatch(
+    const std::vector<std::string>& keys) const {
+  std::vector<KeyRef> refs(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    refs[i].data = reinterpret_cast<const uint8_t*>(keys[i].data());
+    refs[i].len = keys[i].size();
+  }
+  return findRefs(refs);
+}
+
+std::vector<FlatTSet::Entry> FlatTSet::findBatch(
+    const std::vector<CompressedPoint>& keys) const {
+  return findBatch(keys.data(), keys.size());
+}
+
+std::vector<FlatTSet::Entry> FlatTSet::findBatch(const CompressedPoint* keys,
+                                                 size_t count) const {
+  std::vector<KeyRef> refs(count);
+  for (size_t i = 0; i < count; ++i) {
+    refs[i].data = keys[i].data();
+    refs[i].len = CompressedPoint::kBytes;
+  }
+  return findRefs(refs);
+}
+
+std::vector<FlatTSet::Entry> FlatTSet::findRefs(
+    const std::vector<KeyRef>& keys) const {
+  std::vector<Entry> entries(keys.size());
+  if (m_size == 0 || keys.empty()) {
+    return entries;
+  }
+
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    hashes[i] = hashKey(keys[i].data, keys[i].len);
+  }
+
+  const size_t mask = m_ctrl.size() - 1;
+  for (size_t i = 0; i < keys.size() && i < kPrefetchDistance; ++i) {
+    const size_t home = static_cast<size_t>(hashes[i]) & mask;
+    prefetch(&m_ctrl[home]);
+    prefetch(&m_slots[home]);
+  }
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const size_t ahead = i + kPrefetchDistance;
+    if (ahead < keys.size()) {
+      const size_t home = static_cast<size_t>(hashes[ahead]) & mask;
+      prefetch(&m_ctrl[home]);
+      prefetch(&m_slots[home]);
+    }
+    if (keys[i].len > kKeyBytes) {
+      continue;
+    }
+    entries[i] = entryAt(locate(keys[i].data, keys[i].len, hashes[i]));
+  }
+  return entries;
+}
+
+}  // namespace core
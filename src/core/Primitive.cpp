@@ -4,11 +4,15 @@
 #include <unistd.h>
 
 #include <cassert>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "core/RelicContext.hpp"
+
 extern "C" {
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
@@ -18,6 +22,78 @@ extern "C" {
 #include <sys/socket.h>
 }
 
+namespace {
+
+Curve g_default_curve = Curve::Pairing;
+
+// Inputs handed to a Hash_H1_Batch worker at a time; each costs one ep_map.
+const size_t kHashGrain = 32;
+
+}  // namespace
+
+Curve ParseCurve(const std::string& name) {
+  if (name == "pairing") return Curve::Pairing;
+  if (name == "secp256k1") return Curve::Secp256k1;
+  if (name == "p256") return Curve::P256;
+  throw std::invalid_argument("Unsupported curve: " + name +
+                              ". Supported values are: pairing, secp256k1, "
+                              "p256.");
+}
+
+const char* CurveName(Curve curve) {
+  switch (curve) {
+    case Curve::Pairing:
+      return "pairing";
+    case Curve::Secp256k1:
+      return "secp256k1";
+    case Curve::P256:
+      return "p256";
+  }
+  return "unknown";
+}
+
+void UseCurve(Curve curve) {
+  if (core_get() == NULL) {
+    throw std::runtime_error("UseCurve: RELIC is not initialized");
+  }
+  if (curve == Curve::Pairing) {
+    if (pc_param_set_any() != RLC_OK) {
+      throw std::runtime_error("UseCurve: no pairing-friendly curve available");
+    }
+  } else {
+    const int param = (curve == Curve::Secp256k1) ? SECG_K256 : NIST_P256;
+    ep_param_set(param);
+    if (ep_param_get() != param) {
+      throw std::runtime_error(std::string("UseCurve: ") + CurveName(curve) +
+                               " is not available in this RELIC build "
+                               "(requires FP_PRIME=256)");
+    }
+  }
+  g_default_curve = curve;
+}
+
+Curve DefaultCurve() { return g_default_curve; }
+
+size_t PointBytes() {
+  ep_t g;
+  ep_null(g);
+  ep_new(g);
+  ep_curve_get_gen(g);
+  const int len = ep_size_bin(g, 1);
+  ep_free(g);
+  return static_cast<size_t>(len);
+}
+
+size_t ScalarBytes() {
+  bn_t order;
+  bn_null(order);
+  bn_new(order);
+  ep_curve_get_ord(order);
+  const int len = bn_size_bin(order);
+  bn_free(order);
+  return static_cast<size_t>(len);
+}
+
 void Hash_H1(ep_t out, const std::string& in) {
   // Hash-to-curve helper for G1.
   unsigned char buf[64];
@@ -26,6 +102,33 @@ void Hash_H1(ep_t out, const std::string& in) {
   ep_map(out, buf, 32);
 }
 
+void Hash_H1_Batch(ep_t* out, const std::string& keyword, int first,
+                   size_t count, int domain, core::WorkerPool* pool) {
+  auto hash = [&](size_t begin, size_t end) {
+    // keyword| is written once; only the "j|domain" suffix changes per input.
+    std::vector<char> buf(keyword.size() + 32);
+    std::memcpy(buf.data(), keyword.data(), keyword.size());
+    buf[keyword.size()] = '|';
+    char* suffix = buf.data() + keyword.size() + 1;
+    const size_t suffix_room = buf.size() - keyword.size() - 1;
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    for (size_t i = begin; i < end; ++i) {
+      const int suffix_len =
+          std::snprintf(suffix, suffix_room, "%d|%d",
+                        first + static_cast<int>(i), domain);
+      SHA256(reinterpret_cast<const unsigned char*>(buf.data()),
+             keyword.size() + 1 + static_cast<size_t>(suffix_len), digest);
+      ep_map(out[i], digest, SHA256_DIGEST_LENGTH);
+    }
+  };
+  if (pool != nullptr) {
+    pool->parallelFor(count, kHashGrain, hash);
+  } else {
+    hash(0, count);
+  }
+}
+
 void Hash_H2(ep_t out, const std::string& in) {
   // Alternate hash-to-curve helper for G1 with a different digest domain.
   unsigned char buf[64];
@@ -96,6 +199,69 @@ void DeserializePoint(ep_t point, const std::string& data) {
               static_cast<int>(data.length()));
 }
 
+void SerializePoint(const ep_t point, core::CompressedPoint* out) {
+  if (ep_is_infty(point)) {
+    std::memset(out->bytes, 0, core::CompressedPoint::kBytes);
+    return;
+  }
+  const int len = ep_size_bin(point, 1);
+  if (len != static_cast<int>(core::CompressedPoint::kBytes)) {
+    throw std::runtime_error(
+        "SerializePoint: compressed point size does not match "
+        "CompressedPoint::kBytes");
+  }
+  ep_write_bin(out->bytes, len, point, 1);
+}
+
+core::CompressedPoint CompressPoint(const ep_t point) {
+  core::CompressedPoint out;
+  SerializePoint(point, &out);
+  return out;
+}
+
+void DeserializePoint(ep_t point, const core::CompressedPoint& in) {
+  if (in.bytes[0] == 0) {
+    ep_set_infty(point);
+    return;
+  }
+  ep_read_bin(point, in.bytes, static_cast<int>(core::CompressedPoint::kBytes));
+}
+
+void SerializePoints(ep_t* points, size_t count, core::CompressedPoint* out) {
+  size_t projective = 0;
+  bool has_infinity = false;
+  for (size_t i = 0; i < count; ++i) {
+    if (ep_is_infty(points[i])) {
+      has_infinity = true;
+    } else if (points[i]->coord != BASIC) {
+      ++projective;
+    }
+  }
+  // ep_norm_sim inverts all z coordinates at once, so an infinity (z = 0)
+  // would spoil the whole batch; that case keeps the per-point path.
+  if (projective > 1 && !has_infinity) {
+    ep_norm_sim(points, points, static_cast<int>(count));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    SerializePoint(points[i], &out[i]);
+  }
+}
+
+PointBuffer::PointBuffer(size_t count)
+    : m_points(new ep_t[count]), m_count(count) {
+  for (size_t i = 0; i < m_count; ++i) {
+    ep_null(m_points[i]);
+    ep_new(m_points[i]);
+  }
+}
+
+PointBuffer::~PointBuffer() {
+  for (size_t i = 0; i < m_count; ++i) {
+    ep_free(m_points[i]);
+  }
+  delete[] m_points;
+}
+
 std::string HmacSha256(const std::string& key, const std::string& in) {
   unsigned char mac[EVP_MAX_MD_SIZE];
   unsigned int mac_len = 0;
@@ -124,3 +290,153 @@ void F_p(bn_t out, const std::string& key, const std::string& in) {
 void F_p(bn_t out, const bn_t key, const std::string& in) {
   F_p(out, SerializeBn(key), in);
 }
+
+KeyedPrf::KeyedPrf(const std::string& key)
+    : m_inner(nullptr), m_outer(nullptr) {
+  bn_null(m_order);
+  init(key);
+}
+
+KeyedPrf::KeyedPrf(const bn_t key) : m_inner(nullptr), m_outer(nullptr) {
+  bn_null(m_order);
+  init(SerializeBn(key));
+}
+
+KeyedPrf::~KeyedPrf() {
+  EVP_MD_CTX_free(m_inner);
+  EVP_MD_CTX_free(m_outer);
+  bn_free(m_order);
+}
+
+void KeyedPrf::init(const std::string& key) {
+  // RFC 2104: keys longer than the block are hashed first, then zero-padded.
+  unsigned char block[SHA256_CBLOCK];
+  std::memset(block, 0, sizeof(block));
+  if (key.size() > sizeof(block)) {
+    SHA256(reinterpret_cast<const unsigned char*>(key.data()), key.size(),
+           block);
+  } else if (!key.empty()) {
+    std::memcpy(block, key.data(), key.size());
+  }
+
+  unsigned char ipad[SHA256_CBLOCK];
+  unsigned char opad[SHA256_CBLOCK];
+  for (size_t i = 0; i < sizeof(block); ++i) {
+    ipad[i] = block[i] ^ 0x36;
+    opad[i] = block[i] ^ 0x5c;
+  }
+
+  m_inner = EVP_MD_CTX_new();
+  m_outer = EVP_MD_CTX_new();
+  if (m_inner == nullptr || m_outer == nullptr ||
+      EVP_DigestInit_ex(m_inner, EVP_sha256(), nullptr) != 1 ||
+      EVP_DigestUpdate(m_inner, ipad, sizeof(ipad)) != 1 ||
+      EVP_DigestInit_ex(m_outer, EVP_sha256(), nullptr) != 1 ||
+      EVP_DigestUpdate(m_outer, opad, sizeof(opad)) != 1) {
+    EVP_MD_CTX_free(m_inner);
+    EVP_MD_CTX_free(m_outer);
+    throw std::runtime_error("KeyedPrf: failed to initialize HMAC state");
+  }
+
+  bn_new(m_order);
+  ep_curve_get_ord(m_order);
+}
+
+void KeyedPrf::mac(EVP_MD_CTX* scratch, const std::string& in,
+                   unsigned char* out) const {
+  unsigned char inner[SHA256_DIGEST_LENGTH];
+  if (EVP_MD_CTX_copy_ex(scratch, m_inner) != 1 ||
+      EVP_DigestUpdate(scratch, in.data(), in.size()) != 1 ||
+      EVP_DigestFinal_ex(scratch, inner, nullptr) != 1 ||
+      EVP_MD_CTX_copy_ex(scratch, m_outer) != 1 ||
+      EVP_DigestUpdate(scratch, inner, sizeof(inner)) != 1 ||
+      EVP_DigestFinal_ex(scratch, out, nullptr) != 1) {
+    throw std::runtime_error("KeyedPrf: HMAC evaluation failed");
+  }
+}
+
+void KeyedPrf::toScalar(bn_t out, const unsigned char* mac) const {
+  // Same reduction as Hash_Zn(out, F(key, in)), with the order cached.
+  unsigned char wide[SHA512_DIGEST_LENGTH];
+  SHA512(mac, SHA256_DIGEST_LENGTH, wide);
+  bn_read_bin(out, wide, SHA512_DIGEST_LENGTH);
+  bn_mod(out, out, m_order);
+}
+
+std::string KeyedPrf::F(const std::string& in) const {
+  unsigned char out[SHA256_DIGEST_LENGTH];
+  EVP_MD_CTX* scratch = EVP_MD_CTX_new();
+  try {
+    mac(scratch, in, out);
+  } catch (...) {
+    EVP_MD_CTX_free(scratch);
+    throw;
+  }
+  EVP_MD_CTX_free(scratch);
+  return std::string(reinterpret_cast<const char*>(out), sizeof(out));
+}
+
+void KeyedPrf::F_p(bn_t out, const std::string& in) const {
+  const std::string mac_out = F(in);
+  toScalar(out, reinterpret_cast<const unsigned char*>(mac_out.data()));
+}
+
+void KeyedPrf::F_p_Batch(bn_t* out,
+                         const std::vector<std::string>& inputs) const {
+  unsigned char mac_out[SHA256_DIGEST_LENGTH];
+  EVP_MD_CTX* scratch = EVP_MD_CTX_new();
+  try {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      mac(scratch, inputs[i], mac_out);
+      toScalar(out[i], mac_out);
+    }
+  } catch (...) {
+    EVP_MD_CTX_free(scratch);
+    throw;
+  }
+  EVP_MD_CTX_free(scratch);
+}
+
+FixedBasePoint::FixedBasePoint(const ep_t base) : m_table(nullptr) {
+  precompute(base);
+}
+
+FixedBasePoint::FixedBasePoint(const std::string& serialized_base)
+    : m_table(nullptr) {
+  ep_t base;
+  ep_null(base);
+  ep_new(base);
+  DeserializePoint(base, serialized_base);
+  precompute(base);
+  ep_free(base);
+}
+
+FixedBasePoint::FixedBasePoint(const core::CompressedPoint& base)
+    : m_table(nullptr) {
+  ep_t point;
+  ep_null(point);
+  ep_new(point);
+  DeserializePoint(point, base);
+  precompute(point);
+  ep_free(point);
+}
+
+FixedBasePoint::~FixedBasePoint() {
+  for (int i = 0; i < RLC_EP_TABLE; ++i) {
+    ep_free(m_table[i]);
+  }
+  delete[] m_table;
+}
+
+void FixedBasePoint::precompute(const ep_t base) {
+  m_table = new ep_t[RLC_EP_TABLE];
+  for (int i = 0; i < RLC_EP_TABLE; ++i) {
+    ep_null(m_table[i]);
+    ep_new(m_table[i]);
+  }
+  ep_mul_pre(m_table, base);
+}
+
+void FixedBasePoint::mul(ep_t out, const bn_t k) const {
+  ep_mul_fix(out, m_table, k);
+}
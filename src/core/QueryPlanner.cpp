@@ -0,0 +1,56 @@
+#include "core/QueryPlanner.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace core {
+
+namespace {
+
+int countOf(const std::unordered_map<std::string, int>& counts,
+            const std::string& keyword) {
+  std::unordered_map<std::string, int>::const_iterator it =
+      counts.find(keyword);
+  return it == counts.end() ? 0 : it->second;
+}
+
+}  // namespace
+
+void PlanQuery(std::vector<std::string>* keywords,
+               const std::unordered_map<std::string, int>& counts,
+               XTermOrder order) {
+  const size_t n = keywords->size();
+  if (n < 2) {
+    return;
+  }
+
+  // Each keyword's count is looked up once.
+  std::vector<std::pair<int, std::string>> terms(n);
+  for (size_t i = 0; i < n; ++i) {
+    terms[i] = std::make_pair(countOf(counts, (*keywords)[i]), (*keywords)[i]);
+  }
+
+  size_t min_index = 0;
+  for (size_t i = 1; i < n; ++i) {
+    if (terms[i].first < terms[min_index].first) {
+      min_index = i;
+    }
+  }
+  if (min_index != 0) {
+    std::swap(terms[0], terms[min_index]);
+  }
+
+  if (order == XTermOrder::kAscendingCount) {
+    std::stable_sort(terms.begin() + 1, terms.end(),
+                     [](const std::pair<int, std::string>& a,
+                        const std::pair<int, std::string>& b) {
+                       return a.first < b.first;
+                     });
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    (*keywords)[i].swap(terms[i].second);
+  }
+}
+
+}  // namespace core
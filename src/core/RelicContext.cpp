@@ -0,0 +1,261 @@
+#include "core/RelicContext.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace core {
+
+namespace {
+
+// Set while a thread is executing a parallelFor body; nested calls then run
+// inline instead of waiting on workers that may already be busy.
+thread_local bool t_insideParallelBody = false;
+
+class ParallelBodyScope {
+ public:
+  ParallelBodyScope() : m_previous(t_insideParallelBody) {
+    t_insideParallelBody = true;
+  }
+  ~ParallelBodyScope() { t_insideParallelBody = m_previous; }
+
+ private:
+  bool m_previous;
+};
+
+}  // namespace
+
+bool RelicHasThreadLocalContext() {
+  static std::once_flag once;
+  static bool thread_local_ctx = false;
+
+  if (core_get() == NULL) {
+    throw std::runtime_error(
+        "RelicHasThreadLocalContext: calling thread has no RELIC context");
+  }
+
+  std::call_once(once, []() {
+    // With MULTI=NONE the new thread sees the caller's context; with
+    // MULTI=PTHREAD it starts with none of its own.
+    ctx_t* seen = core_get();
+    std::thread probe([&seen]() { seen = core_get(); });
+    probe.join();
+    thread_local_ctx = (seen == NULL);
+  });
+  return thread_local_ctx;
+}
+
+void EnsureRelicParams(int ep_param) {
+  if (core_get() == NULL) {
+    throw std::runtime_error(
+        "EnsureRelicParams: calling thread has no RELIC context");
+  }
+  if (ep_param_get() == ep_param) {
+    return;
+  }
+  ep_param_set(ep_param);
+  if (ep_param_get() != ep_param) {
+    throw std::runtime_error("EnsureRelicParams: RELIC rejected curve id " +
+                             std::to_string(ep_param));
+  }
+}
+
+ScopedRelicContext::ScopedRelicContext(int ep_param) : m_owned(false) {
+  if (core_get() == NULL) {
+    if (core_init() != RLC_OK) {
+      core_clean();
+      throw std::runtime_error("ScopedRelicContext: core_init failed");
+    }
+    m_owned = true;
+  }
+  try {
+    EnsureRelicParams(ep_param);
+  } catch (...) {
+    if (m_owned) {
+      core_clean();
+    }
+    throw;
+  }
+}
+
+ScopedRelicContext::~ScopedRelicContext() {
+  if (m_owned) {
+    core_clean();
+  }
+}
+
+WorkerPool::WorkerPool(size_t num_threads)
+    : m_job(nullptr), m_generation(0), m_active(0), m_stop(false) {
+  if (num_threads == 0) {
+    num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  if (num_threads <= 1 || !RelicHasThreadLocalContext()) {
+    return;
+  }
+
+  m_workers.reserve(num_threads - 1);
+  for (size_t i = 0; i + 1 < num_threads; ++i) {
+    m_workers.emplace_back(&WorkerPool::workerLoop, this, i + 1);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const RangeFn& body) {
+  if (count == 0) {
+    return;
+  }
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  if (m_workers.empty() || t_insideParallelBody || count <= grain) {
+    for (size_t begin = 0; begin < count; begin += grain) {
+      body(begin, std::min(begin + grain, count));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> submit(m_submit_mutex);
+
+  Job job;
+  job.body = &body;
+  job.grain = grain;
+  job.ep_param = ep_param_get();
+  job.num_ranges = concurrency();
+  job.ranges.reset(new WorkRange[job.num_ranges]);
+  job.cancelled.store(false);
+  for (size_t p = 0; p < job.num_ranges; ++p) {
+    job.ranges[p].begin = count * p / job.num_ranges;
+    job.ranges[p].end = count * (p + 1) / job.num_ranges;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &job;
+    m_active = m_workers.size();
+    ++m_generation;
+  }
+  m_work_cv.notify_all();
+
+  runChunks(job, 0);
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]() { return m_active == 0; });
+    m_job = nullptr;
+  }
+
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+bool WorkerPool::takeChunk(Job& job, size_t participant, size_t* begin,
+                           size_t* end) {
+  WorkRange& own = job.ranges[participant];
+  {
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin < own.end) {
+      *begin = own.begin;
+      *end = std::min(own.begin + job.grain, own.end);
+      own.begin = *end;
+      return true;
+    }
+  }
+
+  for (size_t step = 1; step < job.num_ranges; ++step) {
+    WorkRange& victim = job.ranges[(participant + step) % job.num_ranges];
+    size_t stolen_begin = 0;
+    size_t stolen_end = 0;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.begin >= victim.end) {
+        continue;
+      }
+      const size_t remaining = victim.end - victim.begin;
+      stolen_end = victim.end;
+      stolen_begin =
+          remaining <= job.grain ? victim.begin : victim.end - remaining / 2;
+      victim.end = stolen_begin;
+    }
+
+    *begin = stolen_begin;
+    *end = std::min(stolen_begin + job.grain, stolen_end);
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = *end;
+    own.end = stolen_end;
+    return true;
+  }
+  return false;
+}
+
+void WorkerPool::recordError(Job& job) {
+  std::lock_guard<std::mutex> lock(job.error_mutex);
+  if (!job.error) {
+    job.error = std::current_exception();
+  }
+  job.cancelled.store(true);
+}
+
+void WorkerPool::runChunks(Job& job, size_t participant) {
+  ParallelBodyScope scope;
+  size_t begin = 0;
+  size_t end = 0;
+  while (!job.cancelled.load() && takeChunk(job, participant, &begin, &end)) {
+    try {
+      (*job.body)(begin, end);
+    } catch (...) {
+      recordError(job);
+    }
+  }
+}
+
+void WorkerPool::workerLoop(size_t participant) {
+  const bool owns_context = (core_get() == NULL && core_init() == RLC_OK);
+  size_t seen_generation = 0;
+
+  while (true) {
+    Job* job = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_work_cv.wait(lock, [this, seen_generation]() {
+        return m_stop || m_generation != seen_generation;
+      });
+      if (m_stop) {
+        break;
+      }
+      seen_generation = m_generation;
+      job = m_job;
+    }
+
+    try {
+      EnsureRelicParams(job->ep_param);
+      runChunks(*job, participant);
+    } catch (...) {
+      recordError(*job);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_active == 0) {
+        m_done_cv.notify_all();
+      }
+    }
+  }
+
+  if (owns_context) {
+    core_clean();
+  }
+}
+
+}  // namespace core
@@ -0,0 +1,86 @@
+#include "core/ScalarField.hpp"
+
+#include <stdexcept>
+
+namespace core {
+
+ScalarBuffer::ScalarBuffer(size_t count)
+    : m_values(new bn_t[count]), m_count(count) {
+  for (size_t i = 0; i < m_count; ++i) {
+    bn_null(m_values[i]);
+    bn_new(m_values[i]);
+  }
+}
+
+ScalarBuffer::~ScalarBuffer() {
+  for (size_t i = 0; i < m_count; ++i) {
+    bn_free(m_values[i]);
+  }
+  delete[] m_values;
+}
+
+ScalarField::ScalarField() {
+  bn_null(m_order);
+  bn_new(m_order);
+  ep_curve_get_ord(m_order);
+}
+
+ScalarField::~ScalarField() { bn_free(m_order); }
+
+void ScalarField::mul(bn_t out, const bn_t a, const bn_t b) const {
+  bn_mul(out, a, b);
+  bn_mod(out, out, m_order);
+}
+
+void ScalarField::inv(bn_t out, const bn_t a) const {
+  bn_t reduced;
+  bn_null(reduced);
+  bn_new(reduced);
+  bn_mod(reduced, a, m_order);
+  if (bn_is_zero(reduced)) {
+    bn_free(reduced);
+    throw std::invalid_argument("ScalarField: cannot invert zero");
+  }
+  bn_mod_inv(out, reduced, m_order);
+  bn_free(reduced);
+}
+
+void ScalarField::batchInvert(bn_t* values, size_t count) const {
+  if (count == 0) {
+    return;
+  }
+
+  // prefix[i] = values[0] * ... * values[i]
+  ScalarBuffer prefix(count);
+  bn_mod(prefix[0], values[0], m_order);
+  if (bn_is_zero(prefix[0])) {
+    throw std::invalid_argument("ScalarField: cannot invert zero");
+  }
+  for (size_t i = 1; i < count; ++i) {
+    mul(prefix[i], prefix[i - 1], values[i]);
+    if (bn_is_zero(prefix[i])) {
+      throw std::invalid_argument("ScalarField: cannot invert zero");
+    }
+  }
+
+  // acc = (values[0] * ... * values[i])^{-1}, walking i downwards.
+  bn_t acc;
+  bn_null(acc);
+  bn_new(acc);
+  bn_mod_inv(acc, prefix[count - 1], m_order);
+
+  bn_t inverse;
+  bn_null(inverse);
+  bn_new(inverse);
+  for (size_t i = count - 1; i > 0; --i) {
+    mul(inverse, acc, prefix[i - 1]);
+    mul(acc, acc, values[i]);
+    bn_copy(values[i], inverse);
+  }
+  bn_copy(values[0], acc);
+
+  bn_free(inverse);
+  bn_free(acc);
+}
+
+}  // namespace core
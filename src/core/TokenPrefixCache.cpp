@@ -0,0 +1,128 @@
+#include "core/TokenPrefixCache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/Primitive.hpp"
+
+namespace core {
+
+TokenPrefixCache::TokenPrefixCache()
+    : m_reused_positions(0), m_computed_positions(0) {}
+
+void TokenPrefixCache::setBudget(size_t max_bytes) {
+  m_cache.reset(max_bytes == 0 ? nullptr
+                               : new LruCache<std::string, Entry>(max_bytes));
+  m_reused_positions = 0;
+  m_computed_positions = 0;
+}
+
+void TokenPrefixCache::clear() {
+  if (m_cache) {
+    m_cache->clear();
+  }
+}
+
+size_t TokenPrefixCache::Entry::memoryBytes(const std::string& keyword) const {
+  return sizeof(Entry) + keyword.size() +
+         (hw_0.capacity() + hw_1.capacity() + bstag.capacity() +
+          delta.capacity()) *
+             sizeof(CompressedPoint);
+}
+
+void TokenPrefixCache::derive(const std::string& keyword, const bn_t kt,
+                              const std::vector<CompressedPoint>& hw_0,
+                              const std::vector<CompressedPoint>& hw_1,
+                              std::vector<CompressedPoint>* bstag,
+                              std::vector<CompressedPoint>* delta,
+                              size_t offset) {
+  if (hw_0.size() != hw_1.size()) {
+    throw std::invalid_argument("TokenPrefixCache stag/delta count mismatch");
+  }
+  const size_t count = hw_0.size();
+
+  // Reuse the leading positions whose client points match the cached ones.
+  Entry* entry = m_cache ? m_cache->find(keyword) : nullptr;
+  size_t cached = 0;
+  if (entry != nullptr) {
+    const size_t have = entry->hw_0.size();
+    const size_t limit = have > offset ? std::min(have - offset, count) : 0;
+    while (cached < limit && entry->hw_0[offset + cached] == hw_0[cached] &&
+           entry->hw_1[offset + cached] == hw_1[cached]) {
+      ++cached;
+    }
+  }
+  if (cached > 0) {
+    bstag->assign(entry->bstag.begin() + offset,
+                  entry->bstag.begin() + offset + cached);
+    delta->assign(entry->delta.begin() + offset,
+                  entry->delta.begin() + offset + cached);
+  } else {
+    bstag->clear();
+    delta->clear();
+  }
+
+  // The remaining positions are exponentiated and encoded as one batch.
+  const size_t fresh = count - cached;
+  if (fresh > 0) {
+    PointBuffer points(2 * fresh);
+    for (size_t j = 0; j < fresh; ++j) {
+      DeserializePoint(points[j], hw_0[cached + j]);
+      ep_mul(points[j], points[j], kt);
+      DeserializePoint(points[fresh + j], hw_1[cached + j]);
+      ep_mul(points[fresh + j], points[fresh + j], kt);
+    }
+    std::vector<CompressedPoint> encoded(points.size());
+    SerializePoints(points.data(), points.size(), encoded.data());
+    bstag->insert(bstag->end(), encoded.begin(), encoded.begin() + fresh);
+    delta->insert(delta->end(), encoded.begin() + fresh, encoded.end());
+  }
+
+  if (!m_cache) {
+    return;
+  }
+  m_reused_positions += cached;
+  m_computed_positions += fresh;
+  if (fresh == 0) {
+    return;
+  }
+  if (offset == 0) {
+    // A full request replaces whatever was cached for the keyword.
+    if (entry == nullptr) {
+      entry = m_cache->insert(keyword, Entry(), 0);
+      if (entry == nullptr) {
+        return;
+      }
+    }
+    entry->hw_0 = hw_0;
+    entry->hw_1 = hw_1;
+    entry->bstag = *bstag;
+    entry->delta = *delta;
+  } else if (entry != nullptr && offset + cached == entry->hw_0.size()) {
+    // A later window that continues the cached prefix extends it.
+    entry->hw_0.insert(entry->hw_0.end(), hw_0.begin() + cached, hw_0.end());
+    entry->hw_1.insert(entry->hw_1.end(), hw_1.begin() + cached, hw_1.end());
+    entry->bstag.insert(entry->bstag.end(), bstag->begin() + cached,
+                        bstag->end());
+    entry->delta.insert(entry->delta.end(), delta->begin() + cached,
+                        delta->end());
+  } else {
+    return;
+  }
+  m_cache->resize(keyword, entry->memoryBytes(keyword));
+}
+
+TokenPrefixCache::Stats TokenPrefixCache::stats() const {
+  Stats stats;
+  if (m_cache) {
+    stats.hits = m_cache->stats().hits;
+    stats.misses = m_cache->stats().misses;
+    stats.evictions = m_cache->stats().evictions;
+    stats.bytes = m_cache->bytes();
+  }
+  stats.reused_positions = m_reused_positions;
+  stats.computed_positions = m_computed_positions;
+  return stats;
+}
+
+}  // namespace core
@@ -0,0 +1,281 @@
+#include "core/XSet.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <openssl/sha.h>
+}
+
+namespace core {
+
+namespace {
+
+const size_t kMinSlots = 16;
+const size_t kFilterWays = 4;
+const size_t kMaxKicks = 500;
+const char kMagic[4] = {'N', 'X', 'S', '1'};
+
+uint64_t loadBe64(const unsigned char* in) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) {
+    v = (v << 8) | in[i];
+  }
+  return v;
+}
+
+void storeBe64(uint64_t v, unsigned char* out) {
+  for (int i = 7; i >= 0; --i) {
+    out[i] = static_cast<unsigned char>(v & 0xff);
+    v >>= 8;
+  }
+}
+
+bool isEmpty(const XSet::Fingerprint& fp) { return fp.hi == 0 && fp.lo == 0; }
+
+bool sameFingerprint(const XSet::Fingerprint& a, const XSet::Fingerprint& b) {
+  return a.hi == b.hi && a.lo == b.lo;
+}
+
+// Keep the exact table at or below 7/8 full.
+bool overLoaded(size_t entries, size_t capacity) {
+  return entries * 8 > capacity * 7;
+}
+
+uint16_t filterTag(const XSet::Fingerprint& fp) {
+  const uint16_t tag = static_cast<uint16_t>(fp.lo >> 48);
+  return tag == 0 ? 1 : tag;
+}
+
+size_t altBucket(size_t bucket, uint16_t tag, size_t mask) {
+  return (bucket ^ static_cast<size_t>(tag * 0x5bd1e995ULL)) & mask;
+}
+
+}  // namespace
+
+XSet::Fingerprint XSet::FingerprintOf(const uint8_t* xtag, size_t len) {
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(xtag, len, digest);
+  Fingerprint fp;
+  fp.hi = loadBe64(digest);
+  fp.lo = loadBe64(digest + 8);
+  if (isEmpty(fp)) {
+    fp.lo = 1;  // {0, 0} is reserved for empty slots
+  }
+  return fp;
+}
+
+XSet::XSet(bool use_filter)
+    : m_size(0), m_use_filter(use_filter), m_filter_mask(0),
+      m_kick_state(0x9e3779b97f4a7c15ULL) {}
+
+size_t XSet::homeSlot(const Fingerprint& fp) const {
+  return static_cast<size_t>(fp.hi % m_slots.size());
+}
+
+bool XSet::placeExact(const Fingerprint& fp) {
+  const size_t capacity = m_slots.size();
+  for (size_t i = homeSlot(fp);; i = (i + 1 == capacity) ? 0 : i + 1) {
+    Fingerprint& slot = m_slots[i];
+    if (isEmpty(slot)) {
+      slot = fp;
+      return true;
+    }
+    if (sameFingerprint(slot, fp)) {
+      return false;
+    }
+  }
+}
+
+void XSet::rehashExact(size_t new_capacity) {
+  std::vector<Fingerprint> old_slots;
+  old_slots.swap(m_slots);
+  Fingerprint empty = {0, 0};
+  m_slots.assign(new_capacity, empty);
+  for (size_t i = 0; i < old_slots.size(); ++i) {
+    if (!isEmpty(old_slots[i])) {
+      placeExact(old_slots[i]);
+    }
+  }
+}
+
+void XSet::reserve(size_t entries) {
+  size_t capacity = std::max(kMinSlots, m_slots.size());
+  while (overLoaded(entries, capacity)) {
+    capacity += capacity / 2;
+  }
+  if (capacity > m_slots.size()) {
+    rehashExact(capacity);
+  }
+  if (m_use_filter && entries > (m_filter_mask + 1) * kFilterWays * 9 / 10) {
+    rebuildFilter(entries);
+  }
+}
+
+void XSet::insert(const Fingerprint& fp) {
+  if (m_slots.empty() || overLoaded(m_size + 1, m_slots.size())) {
+    // Grow by 1.5x rather than 2x to keep bytes per xtag close to 16.
+    rehashExact(std::max(kMinSlots, m_slots.size() + m_slots.size() / 2));
+  }
+  if (!placeExact(fp)) {
+    return;
+  }
+  ++m_size;
+
+  if (m_use_filter && !filterInsert(fp)) {
+    rebuildFilter(m_size * 2);
+  }
+}
+
+bool XSet::contains(const Fingerprint& fp) const {
+  if (m_size == 0) {
+    return false;
+  }
+  if (m_use_filter && !filterMayContain(fp)) {
+    return false;
+  }
+  const size_t capacity = m_slots.size();
+  for (size_t i = homeSlot(fp);; i = (i + 1 == capacity) ? 0 : i + 1) {
+    const Fingerprint& slot = m_slots[i];
+    if (isEmpty(slot)) {
+      return false;
+    }
+    if (sameFingerprint(slot, fp)) {
+      return true;
+    }
+  }
+}
+
+size_t XSet::memoryBytes() const {
+  return m_slots.capacity() * sizeof(Fingerprint) +
+         m_filter.capacity() * sizeof(uint16_t);
+}
+
+bool XSet::filterMayContain(const Fingerprint& fp) const {
+  if (m_filter.empty()) {
+    return false;
+  }
+  const uint16_t tag = filterTag(fp);
+  const size_t b1 = static_cast<size_t>(fp.hi) & m_filter_mask;
+  const size_t b2 = altBucket(b1, tag, m_filter_mask);
+  const uint16_t* first = &m_filter[b1 * kFilterWays];
+  const uint16_t* second = &m_filter[b2 * kFilterWays];
+  for (size_t w = 0; w < kFilterWays; ++w) {
+    if (first[w] == tag || second[w] == tag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool XSet::filterInsert(const Fingerprint& fp) {
+  if (m_filter.empty()) {
+    return false;
+  }
+  uint16_t tag = filterTag(fp);
+  size_t bucket = static_cast<size_t>(fp.hi) & m_filter_mask;
+  const size_t alt = altBucket(bucket, tag, m_filter_mask);
+
+  const size_t candidates[2] = {bucket, alt};
+  for (size_t c = 0; c < 2; ++c) {
+    uint16_t* slots = &m_filter[candidates[c] * kFilterWays];
+    for (size_t w = 0; w < kFilterWays; ++w) {
+      if (slots[w] == 0) {
+        slots[w] = tag;
+        return true;
+      }
+    }
+  }
+
+  // Both buckets full: evict a pseudo-random resident to its other bucket.
+  bucket = (m_kick_state & 1) ? alt : bucket;
+  for (size_t kick = 0; kick < kMaxKicks; ++kick) {
+    m_kick_state ^= m_kick_state << 13;
+    m_kick_state ^= m_kick_state >> 7;
+    m_kick_state ^= m_kick_state << 17;
+    const size_t victim = static_cast<size_t>(m_kick_state % kFilterWays);
+    std::swap(tag, m_filter[bucket * kFilterWays + victim]);
+
+    bucket = altBucket(bucket, tag, m_filter_mask);
+    uint16_t* slots = &m_filter[bucket * kFilterWays];
+    for (size_t w = 0; w < kFilterWays; ++w) {
+      if (slots[w] == 0) {
+        slots[w] = tag;
+        return true;
+      }
+    }
+  }
+  // The displaced tag is dropped; the caller rebuilds from the exact table.
+  return false;
+}
+
+void XSet::rebuildFilter(size_t entries) {
+  size_t buckets = 1;
+  while (buckets * kFilterWays * 9 / 10 < entries) {
+    buckets <<= 1;
+  }
+
+  while (true) {
+    m_filter.assign(buckets * kFilterWays, 0);
+    m_filter_mask = buckets - 1;
+    bool ok = true;
+    for (size_t i = 0; i < m_slots.size() && ok; ++i) {
+      if (!isEmpty(m_slots[i])) {
+        ok = filterInsert(m_slots[i]);
+      }
+    }
+    if (ok) {
+      return;
+    }
+    buckets <<= 1;
+  }
+}
+
+std::string XSet::serialize() const {
+  std::string out(sizeof(kMagic) + 8 + m_size * 16, '\0');
+  unsigned char* p = reinterpret_cast<unsigned char*>(&out[0]);
+  std::memcpy(p, kMagic, sizeof(kMagic));
+  p += sizeof(kMagic);
+  storeBe64(static_cast<uint64_t>(m_size), p);
+  p += 8;
+  for (size_t i = 0; i < m_slots.size(); ++i) {
+    if (isEmpty(m_slots[i])) {
+      continue;
+    }
+    storeBe64(m_slots[i].hi, p);
+    storeBe64(m_slots[i].lo, p + 8);
+    p += 16;
+  }
+  return out;
+}
+
+XSet XSet::Deserialize(const std::string& bytes, bool use_filter) {
+  const size_t header = sizeof(kMagic) + 8;
+  if (bytes.size() < header ||
+      std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("XSet::Deserialize: bad header");
+  }
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+  const uint64_t count = loadBe64(p + sizeof(kMagic));
+  if (count > (bytes.size() - header) / 16 ||
+      bytes.size() != header + count * 16) {
+    throw std::runtime_error("XSet::Deserialize: length mismatch");
+  }
+
+  XSet xset(use_filter);
+  xset.reserve(static_cast<size_t>(count));
+  p += header;
+  for (uint64_t i = 0; i < count; ++i, p += 16) {
+    Fingerprint fp;
+    fp.hi = loadBe64(p);
+    fp.lo = loadBe64(p + 8);
+    if (isEmpty(fp)) {
+      throw std::runtime_error("XSet::Deserialize: empty fingerprint");
+    }
+    xset.insert(fp);
+  }
+  return xset;
+}
+
+}  // namespace core
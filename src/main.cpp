@@ -12,8 +12,10 @@ extern "C" {
 #include "benchmark/BenchmarkExperiment.hpp"
 #include "benchmark/ClientSearchFixedW1Experiment.hpp"
 #include "benchmark/ClientSearchFixedW2Experiment.hpp"
+#include "benchmark/ConjunctionOrderExperiment.hpp"
 #include "benchmark/DatasetLoader.hpp"
 #include "core/ExperimentFactory.hpp"
+#include "core/Primitive.hpp"
 #include "mc-odxt/McOdxtExperiment.hpp"
 #include "nomos/NomosSimplifiedExperiment.hpp"
 #include "vq-nomos/VQNomosExperiment.hpp"
@@ -31,6 +33,42 @@ nomos::benchmark::DatasetLoader::Dataset parseCliDatasetOrThrow(
   return dataset;
 }
 
+size_t parseCliCountOrThrow(const std::string& value, const std::string& what) {
+  size_t parsed = 0;
+  try {
+    size_t consumed = 0;
+    const unsigned long raw = std::stoul(value, &consumed);
+    if (consumed != value.size()) {
+      throw std::invalid_argument(value);
+    }
+    parsed = static_cast<size_t>(raw);
+  } catch (const std::exception&) {
+    throw std::invalid_argument("Unsupported " + what + ": " + value +
+                                ". Expected a non-negative integer.");
+  }
+  return parsed;
+}
+
+// 0 selects std::thread::hardware_concurrency().
+size_t parseCliThreadCountOrThrow(const std::string& value) {
+  return parseCliCountOrThrow(value, "thread count");
+}
+
+// 0 disables the pipelined Nomos run.
+size_t parseCliPipelineChunkOrThrow(const std::string& value) {
+  return parseCliCountOrThrow(value, "pipeline chunk size");
+}
+
+// --curve applies to every experiment; pairing keeps the original setup.
+Curve parseCliCurveOrThrow(const std::vector<std::string>& args) {
+  for (size_t i = 0; i + 1 < args.size(); ++i) {
+    if (args[i] == "--curve") {
+      return ParseCurve(args[i + 1]);
+    }
+  }
+  return Curve::Pairing;
+}
+
 }  // namespace
 
 void registerExperiments() {
@@ -63,6 +101,10 @@ void registerExperiments() {
     return std::unique_ptr<nomos::benchmark::ClientSearchFixedW2Experiment>(
         new nomos::benchmark::ClientSearchFixedW2Experiment());
   });
+  factory.registerExperiment("chapter4-conjunction-order", []() {
+    return std::unique_ptr<nomos::benchmark::ConjunctionOrderExperiment>(
+        new nomos::benchmark::ConjunctionOrderExperiment());
+  });
 }
 
 void configureClientSearchFixedW1(
@@ -71,6 +113,9 @@ void configureClientSearchFixedW1(
   std::string dataset_name = "all";
   std::string output_dir = "results/ch4/";
   std::string scheme = "all";
+  size_t server_threads = 1;
+  size_t client_threads = 1;
+  size_t pipeline_chunk = 0;
 
   for (size_t i = 0; i < args.size(); ++i) {
     if (args[i] == "--dataset" && i + 1 < args.size()) {
@@ -79,6 +124,12 @@ void configureClientSearchFixedW1(
       output_dir = args[++i];
     } else if (args[i] == "--scheme" && i + 1 < args.size()) {
       scheme = args[++i];
+    } else if (args[i] == "--server-threads" && i + 1 < args.size()) {
+      server_threads = parseCliThreadCountOrThrow(args[++i]);
+    } else if (args[i] == "--client-threads" && i + 1 < args.size()) {
+      client_threads = parseCliThreadCountOrThrow(args[++i]);
+    } else if (args[i] == "--pipeline-chunk" && i + 1 < args.size()) {
+      pipeline_chunk = parseCliPipelineChunkOrThrow(args[++i]);
     }
   }
 
@@ -90,11 +141,18 @@ void configureClientSearchFixedW1(
   }
   exp->setOutputDir(output_dir);
   exp->setSchemeFilter(scheme);
+  exp->setServerThreads(server_threads);
+  exp->setClientThreads(client_threads);
+  exp->setPipelineChunk(pipeline_chunk);
 
   std::cout << "Configuration:" << std::endl;
   std::cout << "  --dataset: " << dataset_name << std::endl;
   std::cout << "  --output-dir: " << output_dir << std::endl;
   std::cout << "  --scheme: " << scheme << std::endl;
+  std::cout << "  --server-threads: " << server_threads << std::endl;
+  std::cout << "  --client-threads: " << client_threads << std::endl;
+  std::cout << "  --pipeline-chunk: " << pipeline_chunk << std::endl;
+  std::cout << "  --curve: " << CurveName(DefaultCurve()) << std::endl;
 }
 
 void configureClientSearchFixedW2(
@@ -103,6 +161,9 @@ void configureClientSearchFixedW2(
   std::string dataset_name = "all";
   std::string output_dir = "results/ch4/";
   std::string scheme = "all";
+  size_t server_threads = 1;
+  size_t client_threads = 1;
+  size_t pipeline_chunk = 0;
 
   for (size_t i = 0; i < args.size(); ++i) {
     if (args[i] == "--dataset" && i + 1 < args.size()) {
@@ -111,6 +172,12 @@ void configureClientSearchFixedW2(
       output_dir = args[++i];
     } else if (args[i] == "--scheme" && i + 1 < args.size()) {
       scheme = args[++i];
+    } else if (args[i] == "--server-threads" && i + 1 < args.size()) {
+      server_threads = parseCliThreadCountOrThrow(args[++i]);
+    } else if (args[i] == "--client-threads" && i + 1 < args.size()) {
+      client_threads = parseCliThreadCountOrThrow(args[++i]);
+    } else if (args[i] == "--pipeline-chunk" && i + 1 < args.size()) {
+      pipeline_chunk = parseCliPipelineChunkOrThrow(args[++i]);
     }
   }
 
@@ -122,11 +189,46 @@ void configureClientSearchFixedW2(
   }
   exp->setOutputDir(output_dir);
   exp->setSchemeFilter(scheme);
+  exp->setServerThreads(server_threads);
+  exp->setClientThreads(client_threads);
+  exp->setPipelineChunk(pipeline_chunk);
 
   std::cout << "Configuration:" << std::endl;
   std::cout << "  --dataset: " << dataset_name << std::endl;
   std::cout << "  --output-dir: " << output_dir << std::endl;
   std::cout << "  --scheme: " << scheme << std::endl;
+  std::cout << "  --server-threads: " << server_threads << std::endl;
+  std::cout << "  --client-threads: " << client_threads << std::endl;
+  std::cout << "  --pipeline-chunk: " << pipeline_chunk << std::endl;
+  std::cout << "  --curve: " << CurveName(DefaultCurve()) << std::endl;
+}
+
+void configureConjunctionOrder(
+    nomos::benchmark::ConjunctionOrderExperiment* exp,
+    const std::vector<std::string>& args) {
+  std::string output_dir = "results/ch4/";
+  size_t server_threads = 1;
+  size_t s_term_updates = 256;
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "--output-dir" && i + 1 < args.size()) {
+      output_dir = args[++i];
+    } else if (args[i] == "--server-threads" && i + 1 < args.size()) {
+      server_threads = parseCliThreadCountOrThrow(args[++i]);
+    } else if (args[i] == "--s-term-updates" && i + 1 < args.size()) {
+      s_term_updates = parseCliCountOrThrow(args[++i], "s-term update count");
+    }
+  }
+
+  exp->setOutputDir(output_dir);
+  exp->setServerThreads(server_threads);
+  exp->setSTermUpdates(s_term_updates);
+
+  std::cout << "Configuration:" << std::endl;
+  std::cout << "  --output-dir: " << output_dir << std::endl;
+  std::cout << "  --server-threads: " << server_threads << std::endl;
+  std::cout << "  --s-term-updates: " << s_term_updates << std::endl;
+  std::cout << "  --curve: " << CurveName(DefaultCurve()) << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -134,10 +236,6 @@ int main(int argc, char* argv[]) {
     core_clean();
     return 1;
   }
-  if (pc_param_set_any() != 0) {
-    core_clean();
-    return 1;
-  }
 
   registerExperiments();
 
@@ -154,6 +252,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
+    UseCurve(parseCliCurveOrThrow(args));
     auto experiment =
         core::ExperimentFactory::instance().createExperiment(experimentName);
     std::cout << "Starting experiment: " << experiment->getName() << std::endl;
@@ -172,6 +271,13 @@ int main(int argc, char* argv[]) {
       if (ch4_exp) {
         configureClientSearchFixedW2(ch4_exp, args);
       }
+    } else if (experimentName == "chapter4-conjunction-order") {
+      auto* ch4_exp =
+          dynamic_cast<nomos::benchmark::ConjunctionOrderExperiment*>(
+              experiment.get());
+      if (ch4_exp) {
+        configureConjunctionOrder(ch4_exp, args);
+      }
     }
 
     if (experiment->setup() != 0) {
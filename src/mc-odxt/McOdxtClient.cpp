@@ -1,11 +1,13 @@
 #include "mc-odxt/McOdxtClient.hpp"
 
 #include <algorithm>
-#include <sstream>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "core/Primitive.hpp"
+#include "core/QueryPlanner.hpp"
 
 namespace mcodxt {
 
@@ -23,12 +25,17 @@ int getUpdateCount(const std::unordered_map<std::string, int>& updateCnt,
 
 }  // namespace
 
-McOdxtClient::McOdxtClient() {}
+McOdxtClient::McOdxtClient()
+    : m_xterm_order(core::XTermOrder::kAscendingCount) {}
 
 McOdxtClient::~McOdxtClient() {}
 
 int McOdxtClient::setup() { return 0; }
 
+void McOdxtClient::setHashThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
 TokenRequest McOdxtClient::genToken(
     const std::vector<std::string>& query_keywords,
     const std::unordered_map<std::string, int>& updateCnt) {
@@ -44,19 +51,7 @@ TokenRequest McOdxtClient::genToken(
 
   req.query_keywords = query_keywords;
 
-  int min_update_count = getUpdateCount(updateCnt, req.query_keywords[0]);
-  int min_index = 0;
-  for (int i = 1; i < n; ++i) {
-    const int current_count = getUpdateCount(updateCnt, req.query_keywords[i]);
-    if (current_count < min_update_count) {
-      min_update_count = current_count;
-      min_index = i;
-    }
-  }
-
-  if (min_index != 0) {
-    std::swap(req.query_keywords[0], req.query_keywords[min_index]);
-  }
+  core::PlanQuery(&req.query_keywords, updateCnt, m_xterm_order);
 
   const std::string& w1 = req.query_keywords[0];
   const int m = getUpdateCount(updateCnt, w1);
@@ -68,27 +63,19 @@ TokenRequest McOdxtClient::genToken(
     ep_t hw;
     ep_new(hw);
     Hash_H1(hw, req.query_keywords[i]);
-    req.hashed_keywords.push_back(SerializePoint(hw));
+    req.hashed_keywords.push_back(CompressPoint(hw));
     ep_free(hw);
   }
 
-  for (int j = 1; j <= m; ++j) {
-    std::stringstream ss_b, ss_c;
-    ss_b << w1 << "|" << j << "|0";
-    ss_c << w1 << "|" << j << "|1";
-
-    ep_t b, c;
-    ep_new(b);
-    ep_new(c);
-    Hash_H1(b, ss_b.str());
-    Hash_H1(c, ss_c.str());
-
-    req.hw1_j_0.push_back(SerializePoint(b));
-    req.hw1_j_1.push_back(SerializePoint(c));
-
-    ep_free(b);
-    ep_free(c);
-  }
+  // H(w1||j||0) and H(w1||j||1) for j=1..m, hashed as one batch each.
+  const size_t count = static_cast<size_t>(m);
+  PointBuffer points(2 * count);
+  Hash_H1_Batch(points.data(), w1, 1, count, 0, m_pool.get());
+  Hash_H1_Batch(points.data() + count, w1, 1, count, 1, m_pool.get());
+  std::vector<core::CompressedPoint> encoded(points.size());
+  SerializePoints(points.data(), points.size(), encoded.data());
+  req.hw1_j_0.assign(encoded.begin(), encoded.begin() + m);
+  req.hw1_j_1.assign(encoded.begin() + m, encoded.end());
 
   return req;
 }
@@ -115,44 +102,58 @@ McOdxtClient::SearchRequest McOdxtClient::prepareSearch(
   const std::string& w1 = token_request.query_keywords[0];
   const std::string kz = F(SerializePoint(token.strap), "1");
 
+  // e_j = F_p(Kz, w1||j) for j=1..m under one precomputed HMAC state.
+  std::vector<std::string> e_inputs(static_cast<size_t>(m));
   bn_t* e = new bn_t[m];
   for (int j = 1; j <= m; ++j) {
     bn_new(e[j - 1]);
-    std::stringstream ss;
-    ss << w1 << "|" << j;
-    F_p(e[j - 1], kz, ss.str());
+    e_inputs[static_cast<size_t>(j - 1)] = w1 + "|" + std::to_string(j);
   }
+  KeyedPrf(kz).F_p_Batch(e, e_inputs);
 
   req.stokenList.clear();
   for (int j = 0; j < m; ++j) {
     req.stokenList.push_back(token.bstag[j]);
   }
 
+  // Deserialize and precompute each bxtrap once; it is the base for all m
+  // exponentiations below.
   const int cross_keyword_count =
       std::min(static_cast<int>(token.bxtrap.size()), n - 1);
-  req.xtokenList.clear();
+  std::vector<std::vector<std::unique_ptr<FixedBasePoint>>> bases(
+      static_cast<size_t>(cross_keyword_count));
+  for (int i = 0; i < cross_keyword_count; ++i) {
+    for (size_t t = 0; t < token.bxtrap[i].size(); ++t) {
+      bases[i].emplace_back(new FixedBasePoint(token.bxtrap[i][t]));
+    }
+  }
+
+  // All xtokens are computed first and then encoded as one batch.
+  size_t row = 0;
+  for (int i = 0; i < cross_keyword_count; ++i) {
+    row += bases[i].size();
+  }
+  PointBuffer xtokens(static_cast<size_t>(m) * row);
   for (int j = 0; j < m; ++j) {
-    std::vector<std::vector<std::string>> xtoken_list_j;
+    size_t b = j * row;
     for (int i = 0; i < cross_keyword_count; ++i) {
-      std::vector<std::string> xtoken_list_ji;
-      const int k = static_cast<int>(token.bxtrap[i].size());
-      for (int t = 0; t < k; ++t) {
-        ep_t bxtrap_it;
-        ep_new(bxtrap_it);
-        DeserializePoint(bxtrap_it, token.bxtrap[i][t]);
-
-        ep_t xtoken;
-        ep_new(xtoken);
-        ep_mul(xtoken, bxtrap_it, e[j]);
-
-        xtoken_list_ji.push_back(SerializePoint(xtoken));
-
-        ep_free(xtoken);
-        ep_free(bxtrap_it);
+      for (size_t t = 0; t < bases[i].size(); ++t) {
+        bases[i][t]->mul(xtokens[b++], e[j]);
       }
-      xtoken_list_j.push_back(xtoken_list_ji);
     }
-    req.xtokenList.push_back(xtoken_list_j);
+  }
+  std::vector<core::CompressedPoint> encoded(xtokens.size());
+  SerializePoints(xtokens.data(), xtokens.size(), encoded.data());
+
+  req.xtokenList.assign(
+      m, std::vector<std::vector<core::CompressedPoint>>(cross_keyword_count));
+  for (int j = 0; j < m; ++j) {
+    std::vector<core::CompressedPoint>::const_iterator next =
+        encoded.begin() + j * row;
+    for (int i = 0; i < cross_keyword_count; ++i) {
+      req.xtokenList[j][i].assign(next, next + bases[i].size());
+      next += bases[i].size();
+    }
   }
 
   for (int j = 0; j < m; ++j) {
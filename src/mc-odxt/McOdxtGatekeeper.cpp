@@ -69,6 +69,9 @@ int McOdxtGatekeeper::setup(int d) {
   }
 
   m_updateCnt.clear();
+  m_field.reset(new core::ScalarField());
+  m_ky_prf.reset(new KeyedPrf(m_Ky));
+  m_token_cache.clear();  // cached prefixes were derived under the old Kt
 
   bn_free(ord);
   return 0;
@@ -164,9 +167,10 @@ UpdateMetadata McOdxtGatekeeper::update(OpType op, const std::string& id,
 
   bn_new(meta.alpha);
 
+  // F_p(Ky, id||op) feeds both alpha and the xtag exponent.
   bn_t fp_ky;
   bn_new(fp_ky);
-  computeF_p(fp_ky, m_Ky, ss_plain.str());
+  m_ky_prf->F_p(fp_ky, plaintext);
 
   bn_t fp_kz;
   bn_new(fp_kz);
@@ -174,50 +178,32 @@ UpdateMetadata McOdxtGatekeeper::update(OpType op, const std::string& id,
   ss_w_cnt << keyword << "|" << cnt;
   computeF_p(fp_kz, kz, ss_w_cnt.str());
 
-  bn_t ord;
-  bn_new(ord);
-  ep_curve_get_ord(ord);
-
   bn_t fp_kz_inv;
   bn_new(fp_kz_inv);
-  bn_mod_inv(fp_kz_inv, fp_kz, ord);
-
-  bn_mul(meta.alpha, fp_ky, fp_kz_inv);
-  bn_mod(meta.alpha, meta.alpha, ord);
+  m_field->inv(fp_kz_inv, fp_kz);
+  m_field->mul(meta.alpha, fp_ky, fp_kz_inv);
 
-  bn_free(fp_ky);
   bn_free(fp_kz);
   bn_free(fp_kz_inv);
-  bn_free(ord);
 
   ep_t hw;
   ep_new(hw);
   Hash_H1(hw, keyword);
 
-  bn_t fp_ky_id_op;
-  bn_new(fp_ky_id_op);
-  computeF_p(fp_ky_id_op, m_Ky, ss_plain.str());
-
-  bn_t ord2;
-  bn_new(ord2);
-  ep_curve_get_ord(ord2);
-
   bn_t exp;
   bn_new(exp);
-  bn_mul(exp, m_Kx[idx], fp_ky_id_op);
-  bn_mod(exp, exp, ord2);
+  m_field->mul(exp, m_Kx[idx], fp_ky);
 
   ep_t xtag;
   ep_new(xtag);
   ep_mul(xtag, hw, exp);
-  meta.xtag = SerializePoint(xtag);
+  SerializePoint(xtag, &meta.xtag);
 
   ep_free(xtag);
   bn_free(exp);
 
   ep_free(hw);
-  bn_free(fp_ky_id_op);
-  bn_free(ord2);
+  bn_free(fp_ky);
   return meta;
 }
 
@@ -261,28 +247,11 @@ SearchToken McOdxtGatekeeper::genToken(const TokenRequest& req) {
   ep_mul(token.strap, token.strap, m_Ks);
 
   // Step 2: Compute bstag_j = H(w1||j||0)^Kt[I(w1)] for j=1..m
+  // and delta_j = H(w1||j||1)^Kt[I(w1)], reusing the cached prefix for w1.
   const std::string& w1 = req.query_keywords[0];
   const int i1 = indexFunction(w1);
-  const int m = static_cast<int>(req.hw1_j_0.size());
-
-  token.bstag.clear();
-  token.delta.clear();
-
-  for (int j = 0; j < m; ++j) {
-    ep_t bstag;
-    ep_new(bstag);
-    DeserializePoint(bstag, req.hw1_j_0[j]);
-    ep_mul(bstag, bstag, m_Kt[i1]);
-    token.bstag.push_back(SerializePoint(bstag));
-    ep_free(bstag);
-
-    ep_t delta;
-    ep_new(delta);
-    DeserializePoint(delta, req.hw1_j_1[j]);
-    ep_mul(delta, delta, m_Kt[i1]);
-    token.delta.push_back(SerializePoint(delta));
-    ep_free(delta);
-  }
+  m_token_cache.derive(w1, m_Kt[i1], req.hw1_j_0, req.hw1_j_1, &token.bstag,
+                       &token.delta);
 
   // Step 3: Compute bxtrap for cross-keywords
   token.bxtrap.clear();
@@ -296,8 +265,8 @@ SearchToken McOdxtGatekeeper::genToken(const TokenRequest& req) {
     DeserializePoint(xtrap, req.hashed_keywords[i + 1]);
     ep_mul(xtrap, xtrap, m_Kx[idx]);
 
-    std::vector<std::string> bxtrap_i;
-    bxtrap_i.push_back(SerializePoint(xtrap));
+    std::vector<core::CompressedPoint> bxtrap_i;
+    bxtrap_i.push_back(CompressPoint(xtrap));
     token.bxtrap.push_back(bxtrap_i);
 
     ep_free(xtrap);
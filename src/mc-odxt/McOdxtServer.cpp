@@ -6,95 +6,134 @@
 
 namespace mcodxt {
 
+namespace {
+
+// Slots handed to a search worker at a time.
+const size_t kSearchGrain = 8;
+
+}  // namespace
+
 McOdxtServer::McOdxtServer() {}
 
-McOdxtServer::~McOdxtServer() {
-  m_TSet.clear();
-  m_XSet.clear();
-}
+McOdxtServer::~McOdxtServer() {}
 
 void McOdxtServer::setup(const std::vector<uint8_t>& /*Km*/) {}
 
 void McOdxtServer::update(const UpdateMetadata& meta) {
-  const std::string addr_key = SerializePoint(meta.addr);
+  m_TSet.insert(CompressPoint(meta.addr), meta.val, meta.alpha);
+  m_XSet.insert(meta.xtag);
+}
 
-  TSetEntry entry;
-  entry.val = meta.val;
-  bn_new(entry.alpha);
-  bn_copy(entry.alpha, meta.alpha);
-  m_TSet[addr_key] = std::move(entry);
+void McOdxtServer::updateBatch(const std::vector<UpdateMetadata>& metas) {
+  std::vector<core::CompressedPoint> addr_keys(metas.size());
+  std::vector<core::FlatTSet::Record> records(metas.size());
+  for (size_t i = 0; i < metas.size(); ++i) {
+    SerializePoint(metas[i].addr, &addr_keys[i]);
+    records[i].key = addr_keys[i].data();
+    records[i].key_len = core::CompressedPoint::kBytes;
+    records[i].val = &metas[i].val;
+    records[i].alpha = metas[i].alpha;
+  }
+  m_TSet.bulkBuild(records);
+  m_XSet.reserve(m_XSet.size() + metas.size());
 
-  if (!meta.xtag.empty()) {
-    m_XSet[meta.xtag] = true;
+  for (size_t i = 0; i < metas.size(); ++i) {
+    m_XSet.insert(metas[i].xtag);
   }
 }
 
-std::vector<SearchResultEntry> McOdxtServer::search(
-    const McOdxtClient::SearchRequest& req) {
-  std::vector<SearchResultEntry> results;
+void McOdxtServer::setSearchThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
 
-  const int m = static_cast<int>(req.stokenList.size());
+bool McOdxtServer::matchSlot(const McOdxtClient::SearchRequest& req, int j,
+                             const core::FlatTSet::Entry& entry,
+                             int* match_count) const {
   const int n = req.num_keywords;
+  *match_count = 0;
+  if (n <= 1) {
+    return true;
+  }
 
-  for (int j = 0; j < m; ++j) {
-    const std::string& stag_key = req.stokenList[j];
-    std::map<std::string, TSetEntry>::const_iterator it = m_TSet.find(stag_key);
-    if (it == m_TSet.end()) {
-      continue;
+  bn_t alpha;
+  bn_null(alpha);
+  bn_new(alpha);
+  entry.readAlpha(alpha);
+
+  bool all_match = true;
+  for (int i = 0; i < n - 1 && all_match; ++i) {
+    if (j >= static_cast<int>(req.xtokenList.size()) ||
+        i >= static_cast<int>(req.xtokenList[j].size())) {
+      all_match = false;
+      break;
     }
 
-    const TSetEntry& entry = it->second;
-    bool all_match = true;
-    int match_count = 0;
-
-    if (n > 1) {
-      for (int i = 0; i < n - 1; ++i) {
-        if (j >= static_cast<int>(req.xtokenList.size()) ||
-            i >= static_cast<int>(req.xtokenList[j].size())) {
-          all_match = false;
-          break;
-        }
-
-        const std::vector<std::string>& xtokens = req.xtokenList[j][i];
-        bool keyword_match = false;
-
-        for (size_t t = 0; t < xtokens.size(); ++t) {
-          ep_t xtoken;
-          ep_new(xtoken);
-          DeserializePoint(xtoken, xtokens[t]);
-
-          ep_t xtag;
-          ep_new(xtag);
-          ep_mul(xtag, xtoken, entry.alpha);
-
-          const std::string xtag_key = SerializePoint(xtag);
-          if (m_XSet.find(xtag_key) != m_XSet.end()) {
-            keyword_match = true;
-            match_count++;
-          }
-
-          ep_free(xtag);
-          ep_free(xtoken);
-
-          if (keyword_match) {
-            break;
-          }
-        }
-
-        if (!keyword_match) {
-          all_match = false;
-          break;
-        }
+    const std::vector<core::CompressedPoint>& xtokens = req.xtokenList[j][i];
+    bool keyword_match = false;
+
+    for (size_t t = 0; t < xtokens.size(); ++t) {
+      ep_t xtoken;
+      ep_new(xtoken);
+      DeserializePoint(xtoken, xtokens[t]);
+
+      ep_t xtag;
+      ep_new(xtag);
+      ep_mul(xtag, xtoken, alpha);
+
+      if (m_XSet.contains(CompressPoint(xtag))) {
+        keyword_match = true;
+        (*match_count)++;
+      }
+
+      ep_free(xtag);
+      ep_free(xtoken);
+
+      if (keyword_match) {
+        break;
       }
     }
 
-    if (all_match) {
-      SearchResultEntry result;
-      result.j = j + 1;
-      result.sval = entry.val;
-      result.cnt = match_count;
-      results.push_back(result);
+    all_match = keyword_match;
+  }
+
+  bn_free(alpha);
+  return all_match;
+}
+
+std::vector<SearchResultEntry> McOdxtServer::search(
+    const McOdxtClient::SearchRequest& req) {
+  std::vector<SearchResultEntry> results;
+
+  const size_t m = req.stokenList.size();
+  const std::vector<core::FlatTSet::Entry> entries =
+      m_TSet.findBatch(req.stokenList);
+
+  // Slots are independent; evaluate them (possibly in parallel) and merge in
+  // j order so the output matches the sequential scan.
+  std::vector<char> matched(m, 0);
+  std::vector<int> match_counts(m, 0);
+  auto evaluate = [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      matched[j] = entries[j].found() &&
+                   matchSlot(req, static_cast<int>(j), entries[j],
+                             &match_counts[j]);
+    }
+  };
+  if (m_pool) {
+    m_pool->parallelFor(m, kSearchGrain, evaluate);
+  } else {
+    evaluate(0, m);
+  }
+
+  for (size_t j = 0; j < m; ++j) {
+    if (!matched[j]) {
+      continue;
     }
+    SearchResultEntry result;
+    result.j = static_cast<int>(j) + 1;
+    result.sval = entries[j].copyVal();
+    result.cnt = match_counts[j];
+    results.push_back(result);
   }
 
   return results;
@@ -1,11 +1,16 @@
 #include "nomos/Client.hpp"
 
 #include <algorithm>
-#include <sstream>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "core/Primitive.hpp"
+#include "core/QueryPlanner.hpp"
 
 namespace nomos {
 
@@ -21,20 +26,122 @@ int getUpdateCount(const std::unordered_map<std::string, int>& updateCnt,
   return it->second;
 }
 
+// Appends out = in as a width-byte big-endian scalar.
+void appendScalar(std::vector<uint8_t>* out, const bn_t in, size_t width) {
+  const size_t offset = out->size();
+  out->resize(offset + width, 0);
+  const int len = bn_size_bin(in);
+  if (len > 0) {
+    bn_write_bin(&(*out)[offset + width - static_cast<size_t>(len)], len, in);
+  }
+}
+
 }  // namespace
 
-Client::Client() {}
+Client::Client()
+    : m_xterm_order(core::XTermOrder::kAscendingCount),
+      m_keyword_hits(0),
+      m_keyword_misses(0),
+      m_reused_positions(0),
+      m_computed_positions(0) {}
 
 Client::~Client() {}
 
 int Client::setup() { return 0; }
 
+void Client::setHashThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
+void Client::setCacheBudget(size_t max_bytes) {
+  if (max_bytes == 0) {
+    m_cache.reset();
+  } else {
+    m_cache.reset(new core::LruCache<std::string, CachedKeyword>(max_bytes));
+  }
+  m_keyword_hits = 0;
+  m_keyword_misses = 0;
+  m_reused_positions = 0;
+  m_computed_positions = 0;
+}
+
+Client::CacheStats Client::cacheStats() const {
+  CacheStats stats;
+  if (m_cache) {
+    stats.keyword_hits = m_keyword_hits;
+    stats.keyword_misses = m_keyword_misses;
+    stats.evictions = m_cache->stats().evictions;
+    stats.bytes = m_cache->bytes();
+  }
+  stats.reused_positions = m_reused_positions;
+  stats.computed_positions = m_computed_positions;
+  return stats;
+}
+
+size_t Client::CachedKeyword::memoryBytes(const std::string& keyword) const {
+  return sizeof(CachedKeyword) + keyword.size() + kz.size() + e.capacity() +
+         (hw_0.capacity() + hw_1.capacity()) * sizeof(core::CompressedPoint);
+}
+
+Client::CachedKeyword* Client::cacheEntry(const std::string& keyword) {
+  if (!m_cache) {
+    return nullptr;
+  }
+  CachedKeyword* entry = m_cache->find(keyword);
+  if (entry == nullptr) {
+    const CachedKeyword empty;
+    entry = m_cache->insert(keyword, empty, empty.memoryBytes(keyword));
+  }
+  return entry;
+}
+
+void Client::cacheResized(const std::string& keyword,
+                          const CachedKeyword& entry) {
+  m_cache->resize(keyword, entry.memoryBytes(keyword));
+}
+
+void Client::countKeyword(bool served) {
+  if (m_cache) {
+    ++(served ? m_keyword_hits : m_keyword_misses);
+  }
+}
+
+bool Client::keywordPoint(const std::string& keyword, CachedKeyword* entry,
+                          core::CompressedPoint* out) {
+  if (entry != nullptr && entry->has_hw) {
+    *out = entry->hw;
+    return true;
+  }
+  ep_t hw;
+  ep_null(hw);
+  ep_new(hw);
+  Hash_H1(hw, keyword);
+  SerializePoint(hw, out);
+  ep_free(hw);
+  if (entry != nullptr) {
+    entry->hw = *out;
+    entry->has_hw = true;
+  }
+  return false;
+}
+
 TokenRequest Client::genToken(
     const std::vector<std::string>& query_keywords,
     const std::unordered_map<std::string, int>& updateCnt) {
+  return genPageToken(query_keywords, updateCnt, 0,
+                      std::numeric_limits<int>::max());
+}
+
+TokenRequest Client::genPageToken(
+    const std::vector<std::string>& query_keywords,
+    const std::unordered_map<std::string, int>& updateCnt, int first_slot,
+    int max_slots) {
   // Paper: Algorithm 4 - Nomos GenToken (Client side)
   // Simplified experiment path: keep query reordering and hashing on the
   // client, but omit the paper's OPRF blinding/deblinding.
+  if (first_slot < 0 || max_slots <= 0) {
+    throw std::invalid_argument("Invalid slot range in Nomos genPageToken");
+  }
   TokenRequest req;
 
   const int n = static_cast<int>(query_keywords.size());
@@ -44,54 +151,106 @@ TokenRequest Client::genToken(
 
   req.query_keywords = query_keywords;
 
-  int min_update_count = getUpdateCount(updateCnt, req.query_keywords[0]);
-  int min_index = 0;
-  for (int i = 1; i < n; ++i) {
-    const int current_count = getUpdateCount(updateCnt, req.query_keywords[i]);
-    if (current_count < min_update_count) {
-      min_update_count = current_count;
-      min_index = i;
-    }
-  }
-
-  if (min_index != 0) {
-    std::swap(req.query_keywords[0], req.query_keywords[min_index]);
-  }
+  core::PlanQuery(&req.query_keywords, updateCnt, m_xterm_order);
 
   const std::string& w1 = req.query_keywords[0];
   const int m = getUpdateCount(updateCnt, w1);
-  if (m == 0) {
+  req.slot_offset = std::min(first_slot, m);
+  if (req.slot_offset == m) {
     return req;
   }
 
-  for (int i = 0; i < n; ++i) {
-    ep_t hw;
-    ep_new(hw);
-    Hash_H1(hw, req.query_keywords[i]);
-    req.hashed_keywords.push_back(SerializePoint(hw));
-    ep_free(hw);
+  // Each keyword is looked up once. w1 is finished first: looking up the
+  // others may evict its entry.
+  req.hashed_keywords.resize(static_cast<size_t>(n));
+  const int end = m - req.slot_offset > max_slots ? req.slot_offset + max_slots
+                                                  : m;
+  CachedKeyword* entry = cacheEntry(w1);
+  bool served = keywordPoint(w1, entry, &req.hashed_keywords[0]);
+  served = slotPoints(w1, entry, static_cast<size_t>(req.slot_offset),
+                      static_cast<size_t>(end), &req) ||
+           served;
+  countKeyword(served);
+  for (int i = 1; i < n; ++i) {
+    const std::string& keyword = req.query_keywords[i];
+    countKeyword(
+        keywordPoint(keyword, cacheEntry(keyword), &req.hashed_keywords[i]));
   }
+  return req;
+}
 
-  for (int j = 1; j <= m; ++j) {
-    std::stringstream ss_b;
-    std::stringstream ss_c;
-    ss_b << w1 << "|" << j << "|0";
-    ss_c << w1 << "|" << j << "|1";
-
-    ep_t b;
-    ep_t c;
-    ep_new(b);
-    ep_new(c);
-    Hash_H1(b, ss_b.str());
-    Hash_H1(c, ss_c.str());
+bool Client::slotPoints(const std::string& w1, CachedKeyword* entry,
+                        size_t begin, size_t end, TokenRequest* req) {
+  // H(w1||j||0) and H(w1||j||1) for j=begin+1..end. Positions inside the
+  // cached prefix are reused; the rest is hashed as one batch each and
+  // appended to the cache when it continues the prefix.
+  const size_t have = entry != nullptr ? entry->hw_0.size() : 0;
+  const size_t split = std::min(std::max(have, begin), end);
+  const size_t fresh = end - split;
+  req->slot_offset = static_cast<int>(begin);
+  if (entry != nullptr && begin < have) {
+    req->hw1_j_0.assign(entry->hw_0.begin() + begin,
+                        entry->hw_0.begin() + split);
+    req->hw1_j_1.assign(entry->hw_1.begin() + begin,
+                        entry->hw_1.begin() + split);
+  } else {
+    req->hw1_j_0.clear();
+    req->hw1_j_1.clear();
+  }
+  if (entry != nullptr) {
+    m_reused_positions += split - begin;
+    m_computed_positions += fresh;
+  }
 
-    req.hw1_j_0.push_back(SerializePoint(b));
-    req.hw1_j_1.push_back(SerializePoint(c));
+  if (fresh > 0) {
+    const int first = static_cast<int>(split) + 1;
+    PointBuffer points(2 * fresh);
+    Hash_H1_Batch(points.data(), w1, first, fresh, 0, m_pool.get());
+    Hash_H1_Batch(points.data() + fresh, w1, first, fresh, 1, m_pool.get());
+    std::vector<core::CompressedPoint> encoded(points.size());
+    SerializePoints(points.data(), points.size(), encoded.data());
+    req->hw1_j_0.insert(req->hw1_j_0.end(), encoded.begin(),
+                        encoded.begin() + fresh);
+    req->hw1_j_1.insert(req->hw1_j_1.end(), encoded.begin() + fresh,
+                        encoded.end());
+    if (entry != nullptr && split == have) {
+      entry->hw_0.insert(entry->hw_0.end(), encoded.begin(),
+                         encoded.begin() + fresh);
+      entry->hw_1.insert(entry->hw_1.end(), encoded.begin() + fresh,
+                         encoded.end());
+      cacheResized(w1, *entry);
+    }
+  }
+  return split > begin;
+}
 
-    ep_free(b);
-    ep_free(c);
+TokenRequest Client::genIncrementalToken(
+    const std::string& keyword,
+    const std::unordered_map<std::string, int>& updateCnt) {
+  TokenRequest req;
+  req.query_keywords.push_back(keyword);
+  const int m = getUpdateCount(updateCnt, keyword);
+
+  // Resume after the snapshot; a counter below it means the gatekeeper was
+  // reset, so the keyword is searched from the start again.
+  std::unordered_map<std::string, ResultSnapshot>::const_iterator it =
+      m_snapshots.find(keyword);
+  const int begin =
+      it != m_snapshots.end() && it->second.update_count <= m
+          ? it->second.update_count
+          : 0;
+  req.slot_offset = begin;
+  if (begin == m) {
+    return req;
   }
 
+  req.hashed_keywords.resize(1);
+  CachedKeyword* entry = cacheEntry(keyword);
+  bool served = keywordPoint(keyword, entry, &req.hashed_keywords[0]);
+  served = slotPoints(keyword, entry, static_cast<size_t>(begin),
+                      static_cast<size_t>(m), &req) ||
+           served;
+  countKeyword(served);
   return req;
 }
 
@@ -112,15 +271,45 @@ Client::SearchRequest Client::prepareSearch(const SearchToken& token,
   // Step 1: Compute Kz = F(strap, 1)
   const std::string kz = F(SerializePoint(token.strap), "1");
 
-  // Step 2: For each j=1..m, compute e_j = F_p(Kz, w1||j)
+  // Step 2: For each slot j, compute e_j = F_p(Kz, w1||j). Slots inside the
+  // cached prefix (under the same Kz) are reused; the rest share one
+  // KeyedPrf for Kz.
+  req.slot_offset = token.slot_offset;
   bn_t* e = new bn_t[m];
-  for (int j = 1; j <= m; ++j) {
-    bn_new(e[j - 1]);
+  for (int j = 0; j < m; ++j) {
+    bn_new(e[j]);
+  }
+  const size_t begin = static_cast<size_t>(token.slot_offset);
+  const size_t count = static_cast<size_t>(m);
+  const size_t width = ScalarBytes();
+  CachedKeyword* entry = cacheEntry(w1);
+  if (entry != nullptr && entry->kz != kz) {
+    entry->kz = kz;  // Kz changed with the gatekeeper keys
+    entry->e.clear();
+  }
+  const size_t have = entry != nullptr ? entry->e.size() / width : 0;
+  const size_t cached = have > begin ? std::min(have - begin, count) : 0;
+  for (size_t j = 0; j < cached; ++j) {
+    bn_read_bin(e[j], &entry->e[(begin + j) * width], static_cast<int>(width));
+  }
 
-    // Apply the scalar-valued PRF to derive the per-position scalar e_j.
-    std::stringstream ss;
-    ss << w1 << "|" << j;
-    F_p(e[j - 1], kz, ss.str());
+  std::vector<std::string> e_inputs(count - cached);
+  for (size_t j = cached; j < count; ++j) {
+    e_inputs[j - cached] = w1 + "|" + std::to_string(begin + j + 1);
+  }
+  if (!e_inputs.empty()) {
+    KeyedPrf(kz).F_p_Batch(e + cached, e_inputs);
+  }
+  countKeyword(cached > 0);
+  if (entry != nullptr) {
+    m_reused_positions += cached;
+    m_computed_positions += e_inputs.size();
+    if (!e_inputs.empty() && begin + cached == have) {
+      for (size_t j = cached; j < count; ++j) {
+        appendScalar(&entry->e, e[j], width);
+      }
+      cacheResized(w1, *entry);
+    }
   }
 
   // Step 3: Copy stokens from the simplified token.
@@ -130,33 +319,44 @@ Client::SearchRequest Client::prepareSearch(const SearchToken& token,
   }
 
   // Step 4: Compute xtoken[i][j][t] = bxtrap[j][t]^{e_j}
-  const int k = 2;  // Parameter k
+  // Each bxtrap[i][t] is the base for all m exponentiations, so it is
+  // deserialized and precomputed once.
+  // k (cross-tags per x-term) is carried by the token.
+  const int k = token.bxtrap.empty()
+                    ? 0
+                    : static_cast<int>(token.bxtrap[0].size());
   const int crossKeywordCount =
       std::min(static_cast<int>(token.bxtrap.size()), n - 1);
-  req.xtokenList.clear();
+  std::vector<std::unique_ptr<FixedBasePoint>> bases;
+  for (int i = 0; i < crossKeywordCount; ++i) {
+    if (static_cast<int>(token.bxtrap[i].size()) != k) {
+      throw std::invalid_argument("SearchToken bxtrap rows differ in size");
+    }
+    for (int t = 0; t < k; ++t) {
+      bases.emplace_back(new FixedBasePoint(token.bxtrap[i][t]));
+    }
+  }
+
+  // All m·(n-1)·k xtokens are computed first and then encoded as one batch.
+  const size_t row = bases.size();
+  PointBuffer xtokens(static_cast<size_t>(m) * row);
+  for (int j = 0; j < m; ++j) {
+    for (size_t b = 0; b < row; ++b) {
+      // Compute xtoken = bxtrap^{e_j}
+      bases[b]->mul(xtokens[j * row + b], e[j]);
+    }
+  }
+  std::vector<core::CompressedPoint> encoded(xtokens.size());
+  SerializePoints(xtokens.data(), xtokens.size(), encoded.data());
+
+  req.xtokenList.assign(
+      m, std::vector<std::vector<core::CompressedPoint>>(crossKeywordCount));
   for (int j = 0; j < m; ++j) {
-    std::vector<std::vector<std::string>> xtokenList_j;
     for (int i = 0; i < crossKeywordCount; ++i) {
-      std::vector<std::string> xtokenList_ji;
-      for (int t = 0; t < k; ++t) {
-        // Deserialize bxtrap[i][t]
-        ep_t bxtrap_it;
-        ep_new(bxtrap_it);
-        DeserializePoint(bxtrap_it, token.bxtrap[i][t]);
-
-        // Compute xtoken = bxtrap^{e_j}
-        ep_t xtoken;
-        ep_new(xtoken);
-        ep_mul(xtoken, bxtrap_it, e[j]);
-
-        xtokenList_ji.push_back(SerializePoint(xtoken));
-
-        ep_free(xtoken);
-        ep_free(bxtrap_it);
-      }
-      xtokenList_j.push_back(xtokenList_ji);
+      std::vector<core::CompressedPoint>::const_iterator first =
+          encoded.begin() + j * row + i * k;
+      req.xtokenList[j][i].assign(first, first + k);
     }
-    req.xtokenList.push_back(xtokenList_j);
   }
 
   // Clean up
@@ -167,65 +367,131 @@ Client::SearchRequest Client::prepareSearch(const SearchToken& token,
 
 std::vector<std::string> Client::decryptResults(
     const std::vector<SearchResultEntry>& results, const SearchToken& token) {
+  ResultDecryptor decryptor(token);
+  for (const auto& result : results) {
+    decryptor.add(result);
+  }
+  return decryptor.ids();
+}
+
+std::vector<std::string> Client::applyIncrementalResults(
+    const TokenRequest& token_request, const SearchToken& token,
+    const std::vector<SearchResultEntry>& results) {
+  if (token_request.query_keywords.size() != 1) {
+    throw std::invalid_argument(
+        "Incremental search expects a single-keyword TokenRequest");
+  }
+  const std::string& keyword = token_request.query_keywords[0];
+  ResultSnapshot& snapshot = m_snapshots[keyword];
+  if (token_request.slot_offset == 0) {
+    snapshot.net_count.clear();
+  } else if (token_request.slot_offset != snapshot.update_count) {
+    throw std::invalid_argument(
+        "Incremental TokenRequest does not continue the result snapshot");
+  }
+
+  // Per-slot ADD/DEL contributions are additive, so the new slots' net
+  // counts are folded into the snapshot.
+  ResultDecryptor decryptor(token);
+  for (const auto& result : results) {
+    decryptor.add(result);
+  }
+  for (const auto& kv : decryptor.netCounts()) {
+    snapshot.net_count[kv.first] += kv.second;
+  }
+  snapshot.update_count = token_request.slot_offset +
+                          static_cast<int>(token_request.hw1_j_0.size());
+  return ResultDecryptor::LiveIds(snapshot.net_count);
+}
+
+int Client::snapshotUpdateCount(const std::string& keyword) const {
+  std::unordered_map<std::string, ResultSnapshot>::const_iterator it =
+      m_snapshots.find(keyword);
+  return it == m_snapshots.end() ? 0 : it->second.update_count;
+}
+
+void Client::dropSnapshot(const std::string& keyword) {
+  m_snapshots.erase(keyword);
+}
+
+ResultDecryptor::ResultDecryptor(const SearchToken& token) : m_token(token) {}
+
+bool ResultDecryptor::add(const SearchResultEntry& result) {
+  return add(result.j, result.sval.data(), result.sval.size());
+}
+
+bool ResultDecryptor::add(const SearchResultRef& result) {
+  return add(result.j, result.sval, result.sval_len);
+}
+
+bool ResultDecryptor::add(int result_j, const uint8_t* sval,
+                          size_t sval_len) {
   // Paper: Algorithm 4 - Search (Section 4.3)
   // Correct backward privacy: a document that was ADD-ed then DEL-eted must NOT
   // appear in results.  We tally net ADD count per id: count[id] = #ADDs -
   // #DELs across all TSet entries that decrypted successfully.  An id is live
   // iff count[id] > 0.
-  std::unordered_map<std::string, int> net_count;
-
-  for (const auto& result : results) {
-    int j = result.j;
-    if (j < 1 || j > static_cast<int>(token.delta.size())) {
-      continue;  // Invalid index
-    }
+  // result_j is absolute; the token holds slots slot_offset+1, ...
+  const int j = result_j - m_token.slot_offset;
+  if (j < 1 || j > static_cast<int>(m_token.delta.size())) {
+    return false;  // Invalid index
+  }
 
-    // Decrypt sval using delta_j
-    // sval = (id||op) ⊕ delta_j
-    ep_t delta_j;
-    ep_new(delta_j);
-    DeserializePoint(delta_j, token.delta[j - 1]);
-
-    // Serialize delta_j safely
-    const int delta_len = ep_size_bin(delta_j, 1);
-    if (delta_len <= 0) {
-      ep_free(delta_j);
-      continue;
-    }
-    std::vector<uint8_t> delta_bytes(static_cast<size_t>(delta_len));
-    ep_write_bin(delta_bytes.data(), delta_len, delta_j, 1);
-
-    // XOR decryption
-    const size_t dec_len =
-        std::min(result.sval.size(), static_cast<size_t>(delta_len));
-    std::vector<uint8_t> plaintext(dec_len);
-    for (size_t i = 0; i < dec_len; ++i) {
-      plaintext[i] = result.sval[i] ^ delta_bytes[i];
-    }
+  // Decrypt sval using delta_j
+  // sval = (id||op) ⊕ delta_j
+  ep_t delta_j;
+  ep_new(delta_j);
+  DeserializePoint(delta_j, m_token.delta[j - 1]);
 
+  // Serialize delta_j safely
+  const int delta_len = ep_size_bin(delta_j, 1);
+  if (delta_len <= 0) {
     ep_free(delta_j);
+    return false;
+  }
+  std::vector<uint8_t> delta_bytes(static_cast<size_t>(delta_len));
+  ep_write_bin(delta_bytes.data(), delta_len, delta_j, 1);
+
+  // XOR decryption
+  const size_t dec_len = std::min(sval_len, static_cast<size_t>(delta_len));
+  std::vector<uint8_t> plaintext(dec_len);
+  for (size_t i = 0; i < dec_len; ++i) {
+    plaintext[i] = sval[i] ^ delta_bytes[i];
+  }
 
-    // Parse (id||op)
-    std::string decrypted(plaintext.begin(), plaintext.end());
-    size_t pos = decrypted.find('|');
-    if (pos == std::string::npos) {
-      continue;  // Invalid format
-    }
+  ep_free(delta_j);
 
-    std::string id = decrypted.substr(0, pos);
-    int op = std::stoi(decrypted.substr(pos + 1));
+  // Parse (id||op)
+  std::string decrypted(plaintext.begin(), plaintext.end());
+  size_t pos = decrypted.find('|');
+  if (pos == std::string::npos) {
+    return false;  // Invalid format
+  }
 
-    // Accumulate: ADD increments, DEL decrements
-    if (net_count.find(id) == net_count.end()) {
-      net_count[id] = 0;
-    }
-    if (op == OP_ADD) {
-      net_count[id]++;
-    } else {
-      net_count[id]--;
-    }
+  std::string id = decrypted.substr(0, pos);
+  const std::string op_field = decrypted.substr(pos + 1);
+  char* op_end = nullptr;
+  const long op = std::strtol(op_field.c_str(), &op_end, 10);
+  if (op_field.empty() || op_end != op_field.c_str() + op_field.size() ||
+      (op != OP_ADD && op != OP_DEL)) {
+    return false;
   }
 
+  // Accumulate: ADD increments, DEL decrements
+  if (op == OP_ADD) {
+    m_net_count[id]++;
+  } else {
+    m_net_count[id]--;
+  }
+  return true;
+}
+
+std::vector<std::string> ResultDecryptor::ids() const {
+  return LiveIds(m_net_count);
+}
+
+std::vector<std::string> ResultDecryptor::LiveIds(
+    const std::unordered_map<std::string, int>& net_count) {
   // Collect ids whose net count is positive (still live in the database)
   std::vector<std::string> ids;
   for (const auto& kv : net_count) {
@@ -233,7 +499,6 @@ std::vector<std::string> Client::decryptResults(
       ids.push_back(kv.first);
     }
   }
-
   return ids;
 }
 
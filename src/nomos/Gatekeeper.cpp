@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "core/Primitive.hpp"
@@ -14,6 +15,13 @@ extern "C" {
 
 namespace nomos {
 
+namespace {
+
+// Update entries handed to a worker at a time.
+const size_t kUpdateGrain = 16;
+
+}  // namespace
+
 static int sampleBetaIndex(int ell) {
   if (ell <= 0) {
     throw std::runtime_error("ell must be positive");
@@ -30,7 +38,18 @@ static int sampleBetaIndex(int ell) {
   return (sample % ell) + 1;
 }
 
-Gatekeeper::Gatekeeper() : m_d(0), m_Kt(nullptr), m_Kx(nullptr) {
+static void validateCrossTagParams(int ell, int k) {
+  // sampleBetaIndex draws from a single byte, which caps ℓ at 255.
+  if (ell < 1 || ell > 255) {
+    throw std::invalid_argument("ell must be in [1, 255]");
+  }
+  if (k < 1 || k > ell) {
+    throw std::invalid_argument("k must be in [1, ell]");
+  }
+}
+
+Gatekeeper::Gatekeeper()
+    : m_Kt(nullptr), m_Kx(nullptr), m_d(0), m_ell(3), m_k(2) {
   bn_null(m_Ks);
   bn_null(m_Ky);
 }
@@ -54,8 +73,11 @@ Gatekeeper::~Gatekeeper() {
   }
 }
 
-int Gatekeeper::setup(int d) {
+int Gatekeeper::setup(int d, int ell, int k) {
+  validateCrossTagParams(ell, k);
   m_d = d;
+  m_ell = ell;
+  m_k = k;
 
   // Get curve order
   bn_t ord;
@@ -94,6 +116,10 @@ int Gatekeeper::setup(int d) {
   // Initialize UpdateCnt
   m_updateCnt.clear();
 
+  m_field.reset(new core::ScalarField());
+  m_ky_prf.reset(new KeyedPrf(m_Ky));
+  m_token_cache.clear();  // cached prefixes were derived under the old Kt
+
   bn_free(ord);
   return 0;
 }
@@ -127,38 +153,125 @@ std::string Gatekeeper::computeKz(const std::string& keyword) {
   return kz;
 }
 
-void Gatekeeper::computeF_p(bn_t result, const bn_t key,
-                            const std::string& input) {
-  F_p(result, key, input);
-}
+Gatekeeper::KeywordState::KeywordState() : idx(0) { ep_null(hw); }
+
+Gatekeeper::KeywordState::~KeywordState() { ep_free(hw); }
 
-void Gatekeeper::computeF_p(bn_t result, const std::string& key,
-                            const std::string& input) {
-  F_p(result, key, input);
+void Gatekeeper::initKeywordState(KeywordState* state,
+                                  const std::string& keyword) {
+  state->kz = computeKz(keyword);
+  state->kz_prf.reset(new KeyedPrf(state->kz));
+  state->idx = indexFunction(keyword);
+  ep_new(state->hw);
+  Hash_H1(state->hw, keyword);
 }
 
 UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
                                   const std::string& keyword) {
+  // Step 1: Compute Kz = F((H(w))^Ks, 1), I(w) and H(w)
+  KeywordState state;
+  initKeywordState(&state, keyword);
+
+  // Step 2: Update counter
+  const int cnt = ++m_updateCnt[keyword];
+
+  bn_t fp_kz_inv;
+  bn_null(fp_kz_inv);
+  bn_new(fp_kz_inv);
+  computeFpKz(fp_kz_inv, keyword, cnt, state);
+  m_field->inv(fp_kz_inv, fp_kz_inv);
+
   UpdateMetadata meta;
+  try {
+    buildMetadata(&meta, op, id, keyword, cnt, state, fp_kz_inv);
+  } catch (...) {
+    bn_free(fp_kz_inv);
+    throw;
+  }
+  bn_free(fp_kz_inv);
+  return meta;
+}
 
-  // Step 1: Compute Kz = F((H(w))^Ks, 1)
-  const std::string kz = computeKz(keyword);
+std::vector<UpdateMetadata> Gatekeeper::updateBatch(
+    const std::vector<UpdateRequest>& requests) {
+  // Steps 1-2 run sequentially: one KeywordState per distinct keyword, and
+  // counters advance in input order so the result matches repeated update().
+  std::unordered_map<std::string, size_t> state_index;
+  std::vector<std::unique_ptr<KeywordState>> states;
+  std::vector<size_t> entry_state(requests.size());
+  std::vector<int> entry_cnt(requests.size());
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const std::string& keyword = requests[i].keyword;
+    std::unordered_map<std::string, size_t>::const_iterator it =
+        state_index.find(keyword);
+    if (it == state_index.end()) {
+      states.push_back(std::unique_ptr<KeywordState>(new KeywordState()));
+      initKeywordState(states.back().get(), keyword);
+      it = state_index.insert(std::make_pair(keyword, states.size() - 1)).first;
+    }
+    entry_state[i] = it->second;
+    entry_cnt[i] = ++m_updateCnt[keyword];
+  }
 
-  // Step 2: Update counter
-  if (m_updateCnt.find(keyword) == m_updateCnt.end()) {
-    m_updateCnt[keyword] = 0;
+  // F_p(Kz, w||cnt) for every entry, then one inversion for the whole batch.
+  core::ScalarBuffer fp_kz_inv(requests.size());
+  auto prf = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      computeFpKz(fp_kz_inv[i], requests[i].keyword, entry_cnt[i],
+                  *states[entry_state[i]]);
+    }
+  };
+  runUpdateRange(requests.size(), prf);
+  m_field->batchInvert(fp_kz_inv.data(), fp_kz_inv.size());
+
+  // Steps 3-6 only read keys and shared keyword state.
+  std::vector<UpdateMetadata> metas(requests.size());
+  auto build = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      buildMetadata(&metas[i], requests[i].op, requests[i].id,
+                    requests[i].keyword, entry_cnt[i],
+                    *states[entry_state[i]], fp_kz_inv[i]);
+    }
+  };
+  runUpdateRange(requests.size(), build);
+  return metas;
+}
+
+void Gatekeeper::setUpdateThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
+void Gatekeeper::runUpdateRange(size_t count,
+                                const core::WorkerPool::RangeFn& body) {
+  if (m_pool) {
+    m_pool->parallelFor(count, kUpdateGrain, body);
+  } else {
+    body(0, count);
   }
-  m_updateCnt[keyword]++;
-  int cnt = m_updateCnt[keyword];
+}
+
+void Gatekeeper::computeFpKz(bn_t result, const std::string& keyword, int cnt,
+                             const KeywordState& state) const {
+  std::stringstream ss_w_cnt;
+  ss_w_cnt << keyword << "|" << cnt;
+  state.kz_prf->F_p(result, ss_w_cnt.str());
+}
+
+void Gatekeeper::buildMetadata(UpdateMetadata* meta, OP op,
+                               const std::string& id,
+                               const std::string& keyword, int cnt,
+                               const KeywordState& state,
+                               const bn_t fp_kz_inv) const {
+  const int idx = state.idx;
 
   // Step 3: Compute addr = (H(w||cnt||0))^Kt[I(w)]
-  int idx = indexFunction(keyword);
   std::stringstream ss_addr;
   ss_addr << keyword << "|" << cnt << "|0";
 
-  ep_new(meta.addr);
-  Hash_H1(meta.addr, ss_addr.str());
-  ep_mul(meta.addr, meta.addr, m_Kt[idx]);
+  ep_new(meta->addr);
+  Hash_H1(meta->addr, ss_addr.str());
+  ep_mul(meta->addr, meta->addr, m_Kt[idx]);
 
   // Step 4: Compute val = (id||op) ⊕ (H(w||cnt||1))^Kt[I(w)]
   std::stringstream ss_mask;
@@ -181,7 +294,7 @@ UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
   // Prepare plaintext
   std::stringstream ss_plain;
   ss_plain << id << "|" << static_cast<int>(op);
-  std::string plaintext = ss_plain.str();
+  const std::string plaintext = ss_plain.str();
 
   // Truncation check: ensure mask is sufficient for the entire plaintext.
   if (plaintext.length() > static_cast<size_t>(mask_len)) {
@@ -193,91 +306,42 @@ UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
 
   // XOR encryption
   const size_t enc_len = plaintext.length();
-  meta.val.resize(enc_len);
+  meta->val.resize(enc_len);
   for (size_t i = 0; i < enc_len; ++i) {
-    meta.val[i] = plaintext[i] ^ mask_bytes[i];
+    meta->val[i] = plaintext[i] ^ mask_bytes[i];
   }
 
   ep_free(mask_point);
 
   // Step 5: Compute alpha = F_p(Ky, id||op) · (F_p(Kz, w||cnt))^{-1}
-  bn_new(meta.alpha);
+  // plaintext is exactly id||op, so F_p(Ky, id||op) is shared with Step 6.
+  bn_new(meta->alpha);
 
   bn_t fp_ky;
   bn_new(fp_ky);
-  std::stringstream ss_id_op;
-  ss_id_op << id << "|" << static_cast<int>(op);
-  computeF_p(fp_ky, m_Ky, ss_id_op.str());
-
-  bn_t fp_kz;
-  bn_new(fp_kz);
-  std::stringstream ss_w_cnt;
-  ss_w_cnt << keyword << "|" << cnt;
-  computeF_p(fp_kz, kz, ss_w_cnt.str());
-
-  // Compute inverse
-  bn_t ord;
-  bn_new(ord);
-  ep_curve_get_ord(ord);
-
-  bn_t fp_kz_inv;
-  bn_new(fp_kz_inv);
-  bn_mod_inv(fp_kz_inv, fp_kz, ord);
+  m_ky_prf->F_p(fp_ky, plaintext);
 
-  // alpha = fp_ky * fp_kz_inv mod ord
-  bn_mul(meta.alpha, fp_ky, fp_kz_inv);
-  bn_mod(meta.alpha, meta.alpha, ord);
-
-  bn_free(fp_ky);
-  bn_free(fp_kz);
-  bn_free(fp_kz_inv);
-  bn_free(ord);
+  // alpha = fp_ky * fp_kz_inv mod ord; the inverse is supplied by the caller
+  // so updateBatch can amortize it.
+  m_field->mul(meta->alpha, fp_ky, fp_kz_inv);
 
   // Step 6: Compute xtag_i = H(w)^{Kx[I(w)] · F_p(Ky, id||op) · i}
-  const int ell = 3;  // Parameter ℓ
-  meta.xtags.clear();
-
-  ep_t hw;
-  ep_new(hw);
-  Hash_H1(hw, keyword);
-
-  bn_t fp_ky_id_op;
-  bn_new(fp_ky_id_op);
-  computeF_p(fp_ky_id_op, m_Ky, ss_id_op.str());
-
-  bn_t ord2;
-  bn_new(ord2);
-  ep_curve_get_ord(ord2);
-
-  for (int i = 1; i <= ell; ++i) {
-    // Compute exponent: Kx[I(w)] · Fp(Ky, id||op) · i
-    bn_t exp;
-    bn_new(exp);
-
-    bn_mul(exp, m_Kx[idx], fp_ky_id_op);
-    bn_t i_bn;
-    bn_new(i_bn);
-    bn_set_dig(i_bn, i);
-    bn_mul(exp, exp, i_bn);
-    bn_mod(exp, exp, ord2);
-
-    // Compute xtag_i = H(w)^exp
-    ep_t xtag;
-    ep_new(xtag);
-    ep_mul(xtag, hw, exp);
-
-    // Serialize and store
-    meta.xtags.push_back(SerializePoint(xtag));
-
-    ep_free(xtag);
-    bn_free(exp);
-    bn_free(i_bn);
+  // xtag_i = xtag_{i-1} + xtag_1, so only xtag_1 needs a scalar multiplication.
+  bn_t exp;
+  bn_new(exp);
+  m_field->mul(exp, m_Kx[idx], fp_ky);
+
+  // The ep_add results are projective; SerializePoints normalizes them with
+  // one shared inversion.
+  PointBuffer xtags(static_cast<size_t>(m_ell));
+  ep_mul(xtags[0], state.hw, exp);
+  for (int i = 1; i < m_ell; ++i) {
+    ep_add(xtags[i], xtags[i - 1], xtags[0]);
   }
-
-  ep_free(hw);
-  bn_free(fp_ky_id_op);
-  bn_free(ord2);
-  return meta;
+  meta->xtags.resize(xtags.size());
+  SerializePoints(xtags.data(), xtags.size(), meta->xtags.data());
+  bn_free(exp);
+  bn_free(fp_ky);
 }
 
 int Gatekeeper::getUpdateCount(const std::string& keyword) const {
@@ -310,44 +374,32 @@ SearchToken Gatekeeper::genToken(const TokenRequest& req) {
         "TokenRequest stag/delta count mismatch in Nomos genToken");
   }
 
+  if (req.slot_offset < 0) {
+    throw std::invalid_argument("TokenRequest slot offset is negative");
+  }
+
   const std::string& w1 = req.query_keywords[0];
   int m = static_cast<int>(req.hw1_j_0.size());
   if (m == 0) return token;
+  token.slot_offset = req.slot_offset;
 
   // Step 1: Compute strap = H(w1)^Ks
   ep_new(token.strap);
   DeserializePoint(token.strap, req.hashed_keywords[0]);
   ep_mul(token.strap, token.strap, m_Ks);
 
-  // Step 2: Compute stag_j = H(w1||j||0)^Kt[I(w1)] for j=1..m
+  // Step 2: Compute stag_j = H(w1||j||0)^Kt[I(w1)] for the requested slots
+  // Step 3: Compute delta_j = H(w1||j||1)^Kt[I(w1)] for the requested slots
+  // A cached prefix for w1 is reused; the rest is computed as one batch.
   int I1 = indexFunction(w1);
-  token.bstag.clear();
-  for (int j = 0; j < m; ++j) {
-    ep_t bstag;
-    ep_new(bstag);
-    DeserializePoint(bstag, req.hw1_j_0[j]);
-    ep_mul(bstag, bstag, m_Kt[I1]);
-    token.bstag.push_back(SerializePoint(bstag));
-    ep_free(bstag);
-  }
-
-  // Step 3: Compute delta_j = H(w1||j||1)^Kt[I(w1)] for j=1..m
-  token.delta.clear();
-  for (int j = 0; j < m; ++j) {
-    ep_t delta;
-    ep_new(delta);
-    DeserializePoint(delta, req.hw1_j_1[j]);
-    ep_mul(delta, delta, m_Kt[I1]);
-    token.delta.push_back(SerializePoint(delta));
-    ep_free(delta);
-  }
+  m_token_cache.derive(w1, m_Kt[I1], req.hw1_j_0, req.hw1_j_1, &token.bstag,
+                       &token.delta, static_cast<size_t>(req.slot_offset));
 
   // Step 4 & 5: Compute xtrap_j = H(wj)^Kx[Ij] and bxtrap
-  const int k = 2;    // Parameter k
-  const int ell = 3;  // Parameter ℓ
+  const int k = m_k;
   std::vector<int> beta(k);
   for (int i = 0; i < k; ++i) {
-    beta[i] = sampleBetaIndex(ell);
+    beta[i] = sampleBetaIndex(m_ell);
   }
 
   token.bxtrap.clear();
@@ -362,7 +414,7 @@ SearchToken Gatekeeper::genToken(const TokenRequest& req) {
     ep_mul(xtrap_j, xtrap_j, m_Kx[Ij]);
 
     // Compute bxtrap_j[t] = xtrap_j^beta[t]
-    std::vector<std::string> bxtrap_j;
+    std::vector<core::CompressedPoint> bxtrap_j;
     for (int t = 0; t < k; ++t) {
       bn_t beta_bn;
       bn_new(beta_bn);
@@ -371,7 +423,7 @@ SearchToken Gatekeeper::genToken(const TokenRequest& req) {
       ep_t bxtrap_jt;
       ep_new(bxtrap_jt);
       ep_mul(bxtrap_jt, xtrap_j, beta_bn);
-      bxtrap_j.push_back(SerializePoint(bxtrap_jt));
+      bxtrap_j.push_back(CompressPoint(bxtrap_jt));
 
       ep_free(bxtrap_jt);
       bn_free(beta_bn);
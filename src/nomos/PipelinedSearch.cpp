@@ -0,0 +1,284 @@
+#include "nomos/PipelinedSearch.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "core/RelicContext.hpp"
+
+namespace nomos {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t kDefaultChunkSlots = 64;
+const size_t kDefaultQueueDepth = 2;
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// One chunk of w1 slots on its way through the stages.
+struct Chunk {
+  TokenRequest token_request;
+  SearchToken token;
+  Client::SearchRequest search_request;
+  std::vector<SearchResultEntry> results;
+};
+
+typedef std::unique_ptr<Chunk> ChunkPtr;
+
+// FIFO of at most capacity chunks between two stages. After close(), push
+// fails and pop drains what is left before failing.
+class ChunkQueue {
+ public:
+  explicit ChunkQueue(size_t capacity)
+      : m_capacity(capacity), m_closed(false) {}
+
+  bool push(ChunkPtr chunk) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_full.wait(lock, [this]() {
+      return m_closed || m_chunks.size() < m_capacity;
+    });
+    if (m_closed) {
+      return false;
+    }
+    m_chunks.push_back(std::move(chunk));
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  bool pop(ChunkPtr* chunk) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_empty.wait(lock, [this]() { return m_closed || !m_chunks.empty(); });
+    if (m_chunks.empty()) {
+      return false;
+    }
+    *chunk = std::move(m_chunks.front());
+    m_chunks.pop_front();
+    m_not_full.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_not_full.notify_all();
+    m_not_empty.notify_all();
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_not_full;
+  std::condition_variable m_not_empty;
+  std::deque<ChunkPtr> m_chunks;
+  size_t m_capacity;
+  bool m_closed;
+};
+
+}  // namespace
+
+PipelinedSearch::Stats::Stats()
+    : chunks(0), latency_ms(0.0), first_chunk_ms(0.0) {
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    busy_ms[stage] = 0.0;
+  }
+}
+
+double PipelinedSearch::Stats::occupancy(Stage stage) const {
+  return latency_ms > 0.0 ? busy_ms[stage] / latency_ms : 0.0;
+}
+
+PipelinedSearch::PipelinedSearch(Client* client, Gatekeeper* gatekeeper,
+                                 Server* server)
+    : m_client(client),
+      m_gatekeeper(gatekeeper),
+      m_server(server),
+      m_chunk_slots(kDefaultChunkSlots),
+      m_queue_depth(kDefaultQueueDepth) {}
+
+void PipelinedSearch::setChunkSlots(size_t chunk_slots) {
+  if (chunk_slots == 0) {
+    throw std::invalid_argument("PipelinedSearch chunk size must be positive");
+  }
+  m_chunk_slots = chunk_slots;
+}
+
+void PipelinedSearch::setQueueDepth(size_t queue_depth) {
+  if (queue_depth == 0) {
+    throw std::invalid_argument("PipelinedSearch queue depth must be positive");
+  }
+  m_queue_depth = queue_depth;
+}
+
+const char* PipelinedSearch::StageName(Stage stage) {
+  switch (stage) {
+    case kClientToken:
+      return "client_token";
+    case kGatekeeperToken:
+      return "gatekeeper_token";
+    case kClientPrepare:
+      return "client_prepare";
+    case kServerSearch:
+      return "server_search";
+    case kClientDecrypt:
+      return "client_decrypt";
+    default:
+      return "unknown";
+  }
+}
+
+std::vector<std::string> PipelinedSearch::run(
+    const std::vector<std::string>& query, Stats* stats) {
+  Stats local;
+  const Clock::time_point start = Clock::now();
+  // The client stage reads the counts while the gatekeeper thread runs.
+  const std::unordered_map<std::string, int> counts =
+      m_gatekeeper->getUpdateCounts();
+  const int chunk_slots = static_cast<int>(m_chunk_slots);
+  std::mutex client_mutex;
+  std::unordered_map<std::string, int> net_count;
+  int next_slot = 0;
+
+  // Stage kClientToken: produces the next chunk, or false when done.
+  auto nextChunk = [&](Chunk* chunk) {
+    std::lock_guard<std::mutex> lock(client_mutex);
+    chunk->token_request =
+        m_client->genPageToken(query, counts, next_slot, chunk_slots);
+    next_slot = chunk->token_request.slot_offset +
+                static_cast<int>(chunk->token_request.hw1_j_0.size());
+    return !chunk->token_request.hw1_j_0.empty();
+  };
+
+  // Stages kGatekeeperToken .. kClientDecrypt, applied in order.
+  std::vector<std::function<void(Chunk*)>> work(kStageCount);
+  work[kGatekeeperToken] = [&](Chunk* chunk) {
+    chunk->token = m_gatekeeper->genToken(chunk->token_request);
+  };
+  work[kClientPrepare] = [&](Chunk* chunk) {
+    std::lock_guard<std::mutex> lock(client_mutex);
+    chunk->search_request =
+        m_client->prepareSearch(chunk->token, chunk->token_request);
+  };
+  work[kServerSearch] = [&](Chunk* chunk) {
+    chunk->results = m_server->search(chunk->search_request);
+    chunk->search_request = Client::SearchRequest();
+  };
+  work[kClientDecrypt] = [&](Chunk* chunk) {
+    // Per-slot ADD/DEL counts are additive across chunks.
+    ResultDecryptor decryptor(chunk->token);
+    for (const auto& result : chunk->results) {
+      decryptor.add(result);
+    }
+    for (const auto& kv : decryptor.netCounts()) {
+      net_count[kv.first] += kv.second;
+    }
+    if (local.chunks++ == 0) {
+      local.first_chunk_ms = elapsedMs(start, Clock::now());
+    }
+  };
+
+  // Each stage writes only its own busy_ms entry.
+  auto timed = [&](Stage stage, const std::function<void()>& body) {
+    const Clock::time_point begin = Clock::now();
+    body();
+    local.busy_ms[stage] += elapsedMs(begin, Clock::now());
+  };
+
+  if (!core::RelicHasThreadLocalContext()) {
+    for (;;) {
+      Chunk chunk;
+      bool more = false;
+      timed(kClientToken, [&]() { more = nextChunk(&chunk); });
+      if (!more) {
+        break;
+      }
+      for (int stage = kGatekeeperToken; stage < kStageCount; ++stage) {
+        timed(static_cast<Stage>(stage), [&]() { work[stage](&chunk); });
+      }
+    }
+  } else {
+    // queues[s] carries chunks from stage s to stage s + 1.
+    std::vector<std::unique_ptr<ChunkQueue>> queues;
+    for (int stage = 0; stage + 1 < kStageCount; ++stage) {
+      queues.emplace_back(new ChunkQueue(m_queue_depth));
+    }
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto fail = [&]() {
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      for (size_t q = 0; q < queues.size(); ++q) {
+        queues[q]->close();
+      }
+    };
+
+    const int ep_param = ep_param_get();
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+      try {
+        core::ScopedRelicContext context(ep_param);
+        for (;;) {
+          ChunkPtr chunk(new Chunk());
+          bool more = false;
+          timed(kClientToken, [&]() { more = nextChunk(chunk.get()); });
+          if (!more || !queues[kClientToken]->push(std::move(chunk))) {
+            break;
+          }
+        }
+        queues[kClientToken]->close();
+      } catch (...) {
+        fail();
+      }
+    });
+    for (int stage = kGatekeeperToken; stage < kStageCount; ++stage) {
+      threads.emplace_back([&, stage]() {
+        try {
+          core::ScopedRelicContext context(ep_param);
+          ChunkQueue* in = queues[stage - 1].get();
+          ChunkQueue* out =
+              stage + 1 < kStageCount ? queues[stage].get() : nullptr;
+          ChunkPtr chunk;
+          while (in->pop(&chunk)) {
+            timed(static_cast<Stage>(stage),
+                  [&]() { work[stage](chunk.get()); });
+            if (out != nullptr && !out->push(std::move(chunk))) {
+              break;
+            }
+          }
+          if (out != nullptr) {
+            out->close();
+          }
+        } catch (...) {
+          fail();
+        }
+      });
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  local.latency_ms = elapsedMs(start, Clock::now());
+  if (stats != nullptr) {
+    *stats = local;
+  }
+  return ResultDecryptor::LiveIds(net_count);
+}
+
+}  // namespace nomos
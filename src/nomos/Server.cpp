@@ -1,124 +1,231 @@
 #include "nomos/Server.hpp"
 
+#include <algorithm>
 #include <sstream>
 
+#include "core/Primitive.hpp"
+
 namespace nomos {
 
-Server::Server() {}
+namespace {
 
-Server::~Server() {
-  // Explicitly clear TSet to ensure TSetEntry destructors are called
-  // This frees all bn_t alpha values stored in TSet entries
-  m_TSet.clear();
-  m_XSet.clear();
-}
+// Slots handed to a search worker at a time; each costs up to (n-1)*k ep_mul.
+const size_t kSearchGrain = 8;
 
-void Server::setup(const std::vector<uint8_t>& /*Km*/) {}
+// Slots evaluated per searchStream block before their matches are delivered.
+const size_t kStreamBlock = 64;
 
-std::string Server::serializePoint(const ep_t point) const {
-  uint8_t bytes[256];
-  int len = ep_size_bin(point, 1);
-  ep_write_bin(bytes, len, point, 1);
-  return std::string(reinterpret_cast<char*>(bytes), len);
+// Sink that copies each match into a SearchResultEntry.
+SearchResultSink collectInto(std::vector<SearchResultEntry>* results) {
+  return [results](const SearchResultRef& ref) {
+    SearchResultEntry result;
+    result.j = ref.j;
+    result.sval.assign(ref.sval, ref.sval + ref.sval_len);
+    result.cnt = ref.cnt;
+    results->push_back(result);
+    return true;
+  };
 }
 
+}  // namespace
+
+Server::Server() {}
+
+Server::~Server() {}
+
+void Server::setup(const std::vector<uint8_t>& /*Km*/) {}
+
 void Server::update(const UpdateMetadata& meta) {
-  // Step 1: Serialize addr to string key
-  std::string addr_key = serializePoint(meta.addr);
+  // Step 1: Compress addr into the TSet key
+  const core::CompressedPoint addr_key = CompressPoint(meta.addr);
 
   // Step 2: Store TSet[addr] = (val, alpha)
-  TSetEntry entry;
-  entry.val = meta.val;
-  bn_new(entry.alpha);
-  bn_copy(entry.alpha, meta.alpha);
-
-  m_TSet[addr_key] = std::move(entry);
+  m_TSet.insert(addr_key, meta.val, meta.alpha);
 
   // Step 3: Store xtags in XSet
-  for (const auto& xtag_str : meta.xtags) {
-    m_XSet[xtag_str] = true;
+  for (const auto& xtag : meta.xtags) {
+    m_XSet.insert(xtag);
   }
 }
 
-std::vector<SearchResultEntry> Server::search(
-    const Client::SearchRequest& req) {
-  std::vector<SearchResultEntry> results;
+void Server::updateBatch(const std::vector<UpdateMetadata>& metas) {
+  // Same as calling update() per entry, but TSet and XSet are sized once.
+  std::vector<core::CompressedPoint> addr_keys(metas.size());
+  std::vector<core::FlatTSet::Record> records(metas.size());
+  size_t xtag_count = 0;
+  for (size_t i = 0; i < metas.size(); ++i) {
+    SerializePoint(metas[i].addr, &addr_keys[i]);
+    records[i].key = addr_keys[i].data();
+    records[i].key_len = core::CompressedPoint::kBytes;
+    records[i].val = &metas[i].val;
+    records[i].alpha = metas[i].alpha;
+    xtag_count += metas[i].xtags.size();
+  }
+  m_TSet.bulkBuild(records);
+  m_XSet.reserve(m_XSet.size() + xtag_count);
 
-  int m = req.stokenList.size();
-  int n = req.num_keywords;
+  for (size_t i = 0; i < metas.size(); ++i) {
+    for (const auto& xtag : metas[i].xtags) {
+      m_XSet.insert(xtag);
+    }
+  }
+}
 
-  // For each stoken_j (Paper: Algorithm 4, lines 3-14)
-  for (int j = 0; j < m; ++j) {
-    const std::string& stag_key = req.stokenList[j];
+void Server::setSearchThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
 
-    // Lookup (val, alpha) = TSet[stag] - Paper: Algorithm 4, line 6
-    auto it = m_TSet.find(stag_key);
-    if (it == m_TSet.end()) {
-      continue;  // No match
+bool Server::matchSlot(const Client::SearchRequest& req, int j,
+                       const core::FlatTSet::Entry& entry,
+                       int* match_count) const {
+  const int n = req.num_keywords;
+  *match_count = 0;
+  if (n <= 1) {  // No cross-filtering keywords
+    return true;
+  }
+
+  bn_t alpha;
+  bn_null(alpha);
+  bn_new(alpha);
+  entry.readAlpha(alpha);
+
+  // Check cross-filtering: for each xtoken, verify xtag in XSet
+  bool all_match = true;
+  for (int i = 0; i < n - 1 && all_match; ++i) {
+    if (j >= static_cast<int>(req.xtokenList.size()) ||
+        i >= static_cast<int>(req.xtokenList[j].size())) {
+      all_match = false;
+      break;
     }
 
-    const TSetEntry& entry = it->second;
-
-    // Check cross-filtering: for each xtoken, verify xtag in XSet
-    bool all_match = true;
-    int match_count = 0;
-
-    if (n > 1) {  // Has cross-filtering keywords
-      for (int i = 0; i < n - 1; ++i) {
-        if (j >= static_cast<int>(req.xtokenList.size())) {
-          all_match = false;
-          break;
-        }
-        if (i >= static_cast<int>(req.xtokenList[j].size())) {
-          all_match = false;
-          break;
-        }
-
-        const auto& xtokens = req.xtokenList[j][i];
-        bool keyword_match = false;
-
-        // For each xtoken[i][j][t], compute xtag = xtoken^{alpha}
-        for (const auto& xtoken_str : xtokens) {
-          ep_t xtoken;
-          ep_new(xtoken);
-          ep_read_bin(xtoken,
-                      reinterpret_cast<const uint8_t*>(xtoken_str.data()),
-                      xtoken_str.length());
-
-          ep_t xtag;
-          ep_new(xtag);
-          ep_mul(xtag, xtoken, entry.alpha);
-
-          std::string xtag_key = serializePoint(xtag);
-          if (m_XSet.find(xtag_key) != m_XSet.end()) {
-            keyword_match = true;
-            match_count++;
-          }
-
-          ep_free(xtag);
-          ep_free(xtoken);
-
-          if (keyword_match) break;  // Found match for this keyword
-        }
-
-        if (!keyword_match) {
-          all_match = false;
-          break;
-        }
+    const auto& xtokens = req.xtokenList[j][i];
+    bool keyword_match = false;
+
+    // For each xtoken[i][j][t], compute xtag = xtoken^{alpha}
+    for (const auto& xtoken_bytes : xtokens) {
+      ep_t xtoken;
+      ep_new(xtoken);
+      DeserializePoint(xtoken, xtoken_bytes);
+
+      ep_t xtag;
+      ep_new(xtag);
+      ep_mul(xtag, xtoken, alpha);
+
+      if (m_XSet.contains(CompressPoint(xtag))) {
+        keyword_match = true;
+        (*match_count)++;
       }
-    }
 
-    // If all keywords match, add to results
-    if (all_match) {
-      SearchResultEntry result;
-      result.j = j + 1;  // 1-indexed
-      result.sval = entry.val;
-      result.cnt = match_count;
-      results.push_back(result);
+      ep_free(xtag);
+      ep_free(xtoken);
+
+      if (keyword_match) break;  // Found match for this keyword
     }
+
+    all_match = keyword_match;
   }
 
+  bn_free(alpha);
+  return all_match;
+}
+
+std::vector<SearchResultEntry> Server::search(
+    const Client::SearchRequest& req) {
+  std::vector<SearchResultEntry> results;
+  scanSlots(req, 0, req.stokenList.size(), collectInto(&results));
   return results;
 }
 
+size_t Server::searchStream(const Client::SearchRequest& req,
+                            const SearchResultSink& sink) {
+  size_t delivered = 0;
+  const SearchResultSink counted = [&](const SearchResultRef& ref) {
+    ++delivered;
+    return sink(ref);
+  };
+  const size_t m = req.stokenList.size();
+  const size_t threads = m_pool ? m_pool->concurrency() : 1;
+  const size_t block = std::max(kStreamBlock, kSearchGrain * threads);
+  for (size_t begin = 0; begin < m; begin += block) {
+    if (!scanSlots(req, begin, std::min(m, begin + block), counted)) {
+      break;
+    }
+  }
+  return delivered;
+}
+
+SearchPage Server::searchPage(const Client::SearchRequest& req, size_t limit) {
+  SearchPage page;
+  const size_t m = req.stokenList.size();
+  if (limit == 0) {
+    scanSlots(req, 0, m, collectInto(&page.results));
+    page.next_slot = req.slot_offset + static_cast<int>(m);
+    return page;
+  }
+
+  // Blocks of at least one grain per thread keep the pool busy while
+  // bounding the work done past the limit-th match.
+  const size_t threads = m_pool ? m_pool->concurrency() : 1;
+  const size_t block = std::max(limit, kSearchGrain * threads);
+  size_t scanned = 0;
+  while (scanned < m && page.results.size() < limit) {
+    const size_t end = std::min(m, scanned + block);
+    scanSlots(req, scanned, end, collectInto(&page.results));
+    scanned = end;
+  }
+
+  if (page.results.size() >= limit) {
+    // Slots after the limit-th match are treated as unscanned.
+    page.results.resize(limit);
+    page.next_slot = page.results.back().j;
+  } else {
+    page.next_slot = req.slot_offset + static_cast<int>(scanned);
+  }
+  page.exhausted = page.next_slot == req.slot_offset + static_cast<int>(m);
+  return page;
+}
+
+bool Server::scanSlots(const Client::SearchRequest& req, size_t begin,
+                       size_t end, const SearchResultSink& sink) {
+  const size_t count = end - begin;
+
+  // Lookup (val, alpha) = TSet[stag] for every slot up front - Paper:
+  // Algorithm 4, line 6. The batched lookup overlaps the cache misses.
+  const std::vector<core::FlatTSet::Entry> entries =
+      m_TSet.findBatch(req.stokenList.data() + begin, count);
+
+  // For each stoken_j (Paper: Algorithm 4, lines 3-14). Slots are independent,
+  // so they are evaluated in parallel and merged below in j order.
+  std::vector<char> matched(count, 0);
+  std::vector<int> match_counts(count, 0);
+  auto evaluate = [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      matched[i] = entries[i].found() &&
+                   matchSlot(req, static_cast<int>(begin + i), entries[i],
+                             &match_counts[i]);
+    }
+  };
+  if (m_pool) {
+    m_pool->parallelFor(count, kSearchGrain, evaluate);
+  } else {
+    evaluate(0, count);
+  }
+
+  // If all keywords match, hand the entry to the sink
+  for (size_t i = 0; i < count; ++i) {
+    if (!matched[i]) {
+      continue;
+    }
+    SearchResultRef result;
+    result.j = req.slot_offset + static_cast<int>(begin + i) + 1;  // absolute
+    result.sval = entries[i].val;
+    result.sval_len = entries[i].val_len;
+    result.cnt = match_counts[i];
+    if (!sink(result)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace nomos
@@ -1,39 +1,44 @@
 #include "verifiable/QTree.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
-extern "C" {
-#include <openssl/sha.h>
-}
-
 namespace verifiable {
 
 namespace {
 
-void appendUint64(std::string* out, uint64_t value) {
-  for (int shift = 56; shift >= 0; shift -= 8) {
-    out->push_back(static_cast<char>((value >> shift) & 0xff));
-  }
-}
+// Dirty nodes per parallel chunk; a node hash is about a microsecond.
+const size_t kHashGrain = 256;
 
-std::string sha256(const std::string& input) {
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256(reinterpret_cast<const unsigned char*>(input.data()), input.size(),
-         hash);
-  return std::string(reinterpret_cast<const char*>(hash), SHA256_DIGEST_LENGTH);
+bool isUnset(const uint8_t* digest) {
+  static const uint8_t kUnset[32] = {0};  // SHA-256 size
+  return std::memcmp(digest, kUnset, sizeof(kUnset)) == 0;
 }
 
 }  // namespace
 
-QTree::QTree(size_t capacity) : m_capacity(capacity), m_version(0) {
-  size_t tree_size = 1;
-  while (tree_size < capacity) {
-    tree_size *= 2;
+void QTree::FreeDeleter::operator()(uint8_t* p) const { std::free(p); }
+
+QTree::QTree(size_t capacity) : m_capacity(1), m_depth(0) {
+  while (m_capacity < capacity) {
+    m_capacity *= 2;
+    ++m_depth;
+  }
+
+  const uint8_t one_leaf[2] = {0, 1};
+  const uint8_t zero_leaf[2] = {0, 0};
+  Sha256(one_leaf, sizeof(one_leaf), m_one_leaf);
+  m_zero.resize((m_depth + 1) * kDigestBytes);
+  Sha256(zero_leaf, sizeof(zero_leaf), &m_zero[0]);
+  for (size_t level = 1; level <= m_depth; ++level) {
+    const uint8_t* below = &m_zero[(level - 1) * kDigestBytes];
+    HashChildren(below, below, &m_zero[level * kDigestBytes]);
   }
-  m_capacity = tree_size;
-  m_bit_array.resize(m_capacity, false);
 }
 
 QTree::~QTree() {}
@@ -43,209 +48,283 @@ void QTree::initialize(const std::vector<bool>& bit_array) {
     throw std::runtime_error("Bit array exceeds QTree capacity");
   }
 
-  m_bit_array = bit_array;
-  m_bit_array.resize(m_capacity, false);
-  buildTree(m_bit_array);
-  m_version = 1;
-}
+  m_digests.reset(
+      static_cast<uint8_t*>(std::calloc(2 * m_capacity, kDigestBytes)));
+  if (!m_digests) {
+    throw std::runtime_error("Failed to allocate QTree digests");
+  }
 
-void QTree::updateBit(const std::string& address, bool value) {
-  updateBits(std::vector<std::string>(1, address), value);
+  m_bits.assign((m_capacity + 63) / 64, 0);
+  std::vector<size_t> dirty;
+  for (size_t i = 0; i < bit_array.size(); ++i) {
+    if (bit_array[i]) {
+      assignBit(i, true);
+      dirty.push_back(m_capacity + i);
+    }
+  }
+  rehashUpward(&dirty);
+  m_version = 1;
 }
 
 void QTree::updateBits(const std::vector<std::string>& addresses, bool value) {
-  if (!m_root) {
-    initialize(std::vector<bool>(m_capacity, false));
+  if (!m_digests) {
+    initialize(std::vector<bool>());
   }
 
+  // Dirty nodes of the current level, ascending and distinct, so the
+  // parents of a level come out ascending and distinct as well.
+  std::vector<size_t> dirty;
+  dirty.reserve(addresses.size());
   for (size_t i = 0; i < addresses.size(); ++i) {
     const size_t index = getLeafIndex(addresses[i]);
-    m_bit_array[index] = value;
-    updatePath(index);
+    assignBit(index, value);
+    dirty.push_back(m_capacity + index);
   }
+  std::sort(dirty.begin(), dirty.end());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+  rehashUpward(&dirty);
   m_version++;
 }
 
 bool QTree::getBit(const std::string& address) const {
-  if (m_bit_array.empty()) {
+  if (m_bits.empty()) {
     return false;
   }
-  return m_bit_array[getLeafIndex(address)];
+  return testBit(getLeafIndex(address));
 }
 
 std::vector<std::string> QTree::generateProof(
     const std::string& address) const {
   std::vector<std::string> proof;
-  if (!m_root) {
+  if (!m_digests) {
     return proof;
   }
 
-  size_t index = getLeafIndex(address);
-  const Node* current = m_root.get();
-  size_t level_size = m_capacity;
+  // Siblings from the root down, as verifyPath expects them.
+  proof.resize(m_depth);
+  size_t node = m_capacity + getLeafIndex(address);
+  for (size_t level = 0; level < m_depth; ++level, node /= 2) {
+    proof[m_depth - 1 - level].assign(
+        reinterpret_cast<const char*>(nodeDigest(node ^ 1, level)),
+        kDigestBytes);
+  }
+  return proof;
+}
 
-  while (!current->is_leaf) {
-    level_size /= 2;
-    if (index < level_size) {
-      proof.push_back(current->right->hash);
-      current = current->left.get();
+std::string QTree::getRootHash() const {
+  if (!m_digests) {
+    return "";
+  }
+  return std::string(reinterpret_cast<const char*>(nodeDigest(1, m_depth)),
+                     kDigestBytes);
+}
+
+bool QTree::verifyPath(const std::string& address, bool bit_value,
+                       const std::vector<std::string>& proof,
+                       const std::string& root_hash) const {
+  if (proof.size() != m_depth || root_hash.size() != kDigestBytes) {
+    return false;
+  }
+
+  const size_t index = getLeafIndex(address);
+  uint8_t current[kDigestBytes];
+  std::memcpy(current, bit_value ? m_one_leaf : &m_zero[0], kDigestBytes);
+  size_t node = m_capacity + index;
+  for (size_t level = m_depth; level > 0; --level, node /= 2) {
+    const std::string& sibling = proof[level - 1];
+    if (sibling.size() != kDigestBytes) {
+      return false;
+    }
+    const uint8_t* sibling_hash =
+        reinterpret_cast<const uint8_t*>(sibling.data());
+    if (node & 1) {
+      HashChildren(sibling_hash, current, current);
     } else {
-      proof.push_back(current->left->hash);
-      current = current->right.get();
-      index -= level_size;
+      HashChildren(current, sibling_hash, current);
     }
   }
 
-  return proof;
+  return std::memcmp(current, root_hash.data(), kDigestBytes) == 0;
 }
 
-std::string QTree::generatePositiveProof(
+std::string QTree::generateMultiProof(
     const std::vector<std::string>& addresses) const {
-  std::stringstream ss;
-  ss << "POSITIVE|" << addresses.size() << "|";
+  if (!m_digests) {
+    return "";
+  }
 
+  std::vector<size_t> nodes;
+  nodes.reserve(addresses.size());
   for (size_t i = 0; i < addresses.size(); ++i) {
-    const std::vector<std::string> path = generateProof(addresses[i]);
-    ss << addresses[i] << "|" << path.size() << "|";
-    for (size_t j = 0; j < path.size(); ++j) {
-      ss << path[j] << "|";
+    nodes.push_back(m_capacity + getLeafIndex(addresses[i]));
+  }
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  // Same walk as verifyMultiProof: a sibling is sent only when it is not
+  // itself on a covered path.
+  std::string siblings;
+  std::vector<size_t> parents;
+  for (size_t level = 0; level < m_depth; ++level) {
+    parents.clear();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const size_t node = nodes[i];
+      if (i + 1 < nodes.size() && nodes[i + 1] == (node ^ 1)) {
+        ++i;
+      } else {
+        siblings.append(
+            reinterpret_cast<const char*>(nodeDigest(node ^ 1, level)),
+            kDigestBytes);
+      }
+      parents.push_back(node / 2);
     }
+    nodes.swap(parents);
   }
 
-  return ss.str();
+  std::string proof;
+  AppendU32(static_cast<uint32_t>(siblings.size() / kDigestBytes), &proof);
+  proof += siblings;
+  return proof;
 }
 
-std::string QTree::generateNegativeProof(const std::string& address) const {
-  std::stringstream ss;
-  ss << "NEGATIVE|";
-
-  const std::vector<std::string> path = generateProof(address);
-  ss << address << "|" << path.size() << "|";
-  for (size_t i = 0; i < path.size(); ++i) {
-    ss << path[i] << "|";
+bool QTree::verifyMultiProof(const std::vector<std::string>& addresses,
+                             const std::vector<bool>& bit_values,
+                             const std::string& proof,
+                             const std::string& root_hash) const {
+  if (addresses.empty() || addresses.size() != bit_values.size() ||
+      root_hash.size() != kDigestBytes) {
+    return false;
   }
-
-  return ss.str();
-}
-
-std::string QTree::getRootHash() const {
-  if (!m_root) {
-    return "";
+  size_t pos = 0;
+  uint32_t count = 0;
+  if (!ReadU32(proof, &pos, &count) ||
+      (proof.size() - pos) / kDigestBytes != count ||
+      (proof.size() - pos) % kDigestBytes != 0) {
+    return false;
   }
-  return m_root->hash;
-}
-
-bool QTree::verifyPath(const std::string& address, bool bit_value,
-                       const std::vector<std::string>& proof,
-                       const std::string& root_hash) const {
-  const size_t index = getLeafIndex(address);
 
-  std::vector<bool> went_right(proof.size(), false);
-  size_t tmp_index = index;
-  size_t level_size = m_capacity;
-  for (size_t i = 0; i < proof.size(); ++i) {
-    level_size /= 2;
-    if (tmp_index >= level_size) {
-      went_right[i] = true;
-      tmp_index -= level_size;
+  std::vector<std::pair<size_t, bool>> leaves;
+  leaves.reserve(addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    leaves.push_back(
+        std::make_pair(m_capacity + getLeafIndex(addresses[i]), bit_values[i]));
+  }
+  std::sort(leaves.begin(), leaves.end());
+
+  // Addresses that fold onto one leaf must claim the same bit.
+  std::vector<size_t> nodes;
+  std::vector<uint8_t> digests;
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    if (!nodes.empty() && nodes.back() == leaves[i].first) {
+      if (leaves[i - 1].second != leaves[i].second) {
+        return false;
+      }
+      continue;
     }
+    nodes.push_back(leaves[i].first);
+    const uint8_t* leaf = leaves[i].second ? m_one_leaf : &m_zero[0];
+    digests.insert(digests.end(), leaf, leaf + kDigestBytes);
   }
 
-  std::string current_hash = hashLeaf(index, bit_value);
-  for (int i = static_cast<int>(proof.size()) - 1; i >= 0; --i) {
-    if (went_right[static_cast<size_t>(i)]) {
-      current_hash = hashInternal(proof[static_cast<size_t>(i)], current_hash);
-    } else {
-      current_hash = hashInternal(current_hash, proof[static_cast<size_t>(i)]);
+  // Parents are written over the slots they were hashed from, each shared
+  // ancestor once.
+  for (size_t level = 0; level < m_depth; ++level) {
+    size_t out = 0;
+    for (size_t i = 0; i < nodes.size(); ++i, ++out) {
+      const size_t node = nodes[i];
+      uint8_t* current = &digests[i * kDigestBytes];
+      uint8_t* parent = &digests[out * kDigestBytes];
+      if (i + 1 < nodes.size() && nodes[i + 1] == (node ^ 1)) {
+        HashChildren(current, current + kDigestBytes, parent);
+        ++i;
+      } else {
+        if (pos == proof.size()) {
+          return false;
+        }
+        const uint8_t* sibling =
+            reinterpret_cast<const uint8_t*>(proof.data() + pos);
+        pos += kDigestBytes;
+        if (node & 1) {
+          HashChildren(sibling, current, parent);
+        } else {
+          HashChildren(current, sibling, parent);
+        }
+      }
+      nodes[out] = node / 2;
     }
+    nodes.resize(out);
   }
 
-  return current_hash == root_hash;
+  return pos == proof.size() &&
+         std::memcmp(&digests[0], root_hash.data(), kDigestBytes) == 0;
 }
 
 size_t QTree::getLeafIndex(const std::string& address) const {
-  const std::string digest = sha256(address);
+  uint8_t digest[kDigestBytes];
+  Sha256(reinterpret_cast<const uint8_t*>(address.data()), address.size(),
+         digest);
   uint64_t value = 0;
   for (int i = 0; i < 8; ++i) {
-    value = (value << 8) |
-            static_cast<unsigned char>(digest[static_cast<size_t>(i)]);
+    value = (value << 8) | digest[i];
   }
   return static_cast<size_t>(value % m_capacity);
 }
 
-void QTree::buildTree(const std::vector<bool>& bit_array) {
-  std::vector<std::unique_ptr<Node>> current_level;
-  current_level.reserve(m_capacity);
-
-  for (size_t i = 0; i < m_capacity; ++i) {
-    std::unique_ptr<Node> leaf(new Node());
-    leaf->is_leaf = true;
-    leaf->bit_value = bit_array[i];
-    leaf->hash = hashLeaf(i, bit_array[i]);
-    current_level.push_back(std::move(leaf));
-  }
-
-  while (current_level.size() > 1) {
-    std::vector<std::unique_ptr<Node>> next_level;
-    next_level.reserve(current_level.size() / 2);
-
-    for (size_t i = 0; i < current_level.size(); i += 2) {
-      std::unique_ptr<Node> parent(new Node());
-      parent->is_leaf = false;
-      parent->left = std::move(current_level[i]);
-      parent->right = std::move(current_level[i + 1]);
-      parent->hash = hashInternal(parent->left->hash, parent->right->hash);
-      next_level.push_back(std::move(parent));
-    }
-
-    current_level = std::move(next_level);
+void QTree::assignBit(size_t index, bool value) {
+  const uint64_t mask = static_cast<uint64_t>(1) << (index % 64);
+  if (value) {
+    m_bits[index / 64] |= mask;
+  } else {
+    m_bits[index / 64] &= ~mask;
   }
-
-  m_root = std::move(current_level[0]);
 }
 
-std::string QTree::hashLeaf(size_t address, bool bit_value) const {
-  std::string input;
-  input.push_back(static_cast<char>(0));
-  appendUint64(&input, static_cast<uint64_t>(address));
-  input.push_back(static_cast<char>(bit_value ? 1 : 0));
-  return sha256(input);
+void QTree::setHashThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
 }
 
-std::string QTree::hashInternal(const std::string& left_hash,
-                                const std::string& right_hash) const {
-  std::string input;
-  input.push_back(static_cast<char>(1));
-  input.append(left_hash);
-  input.append(right_hash);
-  return sha256(input);
+void QTree::rehashUpward(std::vector<size_t>* dirty) {
+  // Ascending, distinct node ids give ascending, distinct parents.
+  std::vector<size_t> parents;
+  for (size_t level = 0; !dirty->empty(); ++level) {
+    hashNodes(*dirty, level);
+    if (level == m_depth) {
+      break;
+    }
+    parents.clear();
+    for (size_t i = 0; i < dirty->size(); ++i) {
+      if (parents.empty() || parents.back() != (*dirty)[i] / 2) {
+        parents.push_back((*dirty)[i] / 2);
+      }
+    }
+    dirty->swap(parents);
+  }
 }
 
-void QTree::updatePath(size_t leaf_index) {
-  std::vector<Node*> path;
-  Node* current = m_root.get();
-  size_t index = leaf_index;
-  size_t level_size = m_capacity;
-
-  while (!current->is_leaf) {
-    path.push_back(current);
-    level_size /= 2;
-    if (index < level_size) {
-      current = current->left.get();
-    } else {
-      current = current->right.get();
-      index -= level_size;
+void QTree::hashNodes(const std::vector<size_t>& nodes, size_t level) {
+  auto body = [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      const size_t node = nodes[i];
+      uint8_t* out = &m_digests[node * kDigestBytes];
+      if (level == 0) {
+        std::memcpy(out, testBit(node - m_capacity) ? m_one_leaf : &m_zero[0],
+                    kDigestBytes);
+      } else {
+        HashChildren(nodeDigest(2 * node, level - 1),
+                     nodeDigest(2 * node + 1, level - 1), out);
+      }
     }
+  };
+  if (m_pool && nodes.size() > kHashGrain) {
+    m_pool->parallelFor(nodes.size(), kHashGrain, body);
+  } else {
+    body(0, nodes.size());
   }
+}
 
-  current->bit_value = m_bit_array[leaf_index];
-  current->hash = hashLeaf(leaf_index, current->bit_value);
-
-  for (std::vector<Node*>::reverse_iterator it = path.rbegin();
-       it != path.rend(); ++it) {
-    Node* node = *it;
-    node->hash = hashInternal(node->left->hash, node->right->hash);
-  }
+const uint8_t* QTree::nodeDigest(size_t node, size_t level) const {
+  const uint8_t* stored = &m_digests[node * kDigestBytes];
+  return isUnset(stored) ? &m_zero[level * kDigestBytes] : stored;
 }
 
 }  // namespace verifiable
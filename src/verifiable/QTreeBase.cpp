@@ -0,0 +1,115 @@
+#include "verifiable/QTreeBase.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+extern "C" {
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+}
+
+namespace verifiable {
+
+namespace {
+
+// On OpenSSL 3 the one-shot SHA256() looks the algorithm up again on every
+// call, which dominates a 64-byte node hash, so each thread keeps a context
+// and the algorithm is fetched once. OpenSSL 1.1 has no fetch and
+// EVP_sha256() is already a static table.
+class NodeHasher {
+ public:
+  NodeHasher() : m_ctx(EVP_MD_CTX_new()) {
+    if (m_ctx == nullptr) {
+      throw std::runtime_error("EVP_MD_CTX_new failed");
+    }
+  }
+  ~NodeHasher() { EVP_MD_CTX_free(m_ctx); }
+
+  NodeHasher(const NodeHasher&) = delete;
+  NodeHasher& operator=(const NodeHasher&) = delete;
+
+  void digest(const uint8_t* in, size_t len, uint8_t* out) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static const EVP_MD* md = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+#else
+    static const EVP_MD* md = EVP_sha256();
+#endif
+    if (md == nullptr || EVP_DigestInit_ex(m_ctx, md, nullptr) != 1 ||
+        EVP_DigestUpdate(m_ctx, in, len) != 1 ||
+        EVP_DigestFinal_ex(m_ctx, out, nullptr) != 1) {
+      throw std::runtime_error("QTree SHA-256 failed");
+    }
+  }
+
+ private:
+  EVP_MD_CTX* m_ctx;
+};
+
+}  // namespace
+
+const size_t QTreeBase::kDigestBytes;
+
+void QTreeBase::Sha256(const uint8_t* in, size_t len, uint8_t* out) {
+  thread_local NodeHasher hasher;
+  hasher.digest(in, len, out);
+}
+
+void QTreeBase::HashChildren(const uint8_t* left_hash,
+                             const uint8_t* right_hash, uint8_t* out) {
+  uint8_t input[1 + 2 * kDigestBytes];
+  input[0] = 1;
+  std::memcpy(input + 1, left_hash, kDigestBytes);
+  std::memcpy(input + 1 + kDigestBytes, right_hash, kDigestBytes);
+  Sha256(input, sizeof(input), out);
+}
+
+void QTreeBase::AppendU32(uint32_t value, std::string* out) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out->push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+bool QTreeBase::ReadU32(const std::string& in, size_t* pos, uint32_t* value) {
+  if (in.size() < 4 || *pos > in.size() - 4) {
+    return false;
+  }
+  *value = 0;
+  for (int i = 0; i < 4; ++i) {
+    *value = (*value << 8) | static_cast<uint8_t>(in[*pos + i]);
+  }
+  *pos += 4;
+  return true;
+}
+
+std::string QTreeBase::generatePositiveProof(
+    const std::vector<std::string>& addresses) const {
+  std::stringstream ss;
+  ss << "POSITIVE|" << addresses.size() << "|";
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    const std::vector<std::string> path = generateProof(addresses[i]);
+    ss << addresses[i] << "|" << path.size() << "|";
+    for (size_t j = 0; j < path.size(); ++j) {
+      ss << path[j] << "|";
+    }
+  }
+
+  return ss.str();
+}
+
+std::string QTreeBase::generateNegativeProof(
+    const std::string& address) const {
+  std::stringstream ss;
+  ss << "NEGATIVE|";
+
+  const std::vector<std::string> path = generateProof(address);
+  ss << address << "|" << path.size() << "|";
+  for (size_t i = 0; i < path.size(); ++i) {
+    ss << path[i] << "|";
+  }
+
+  return ss.str();
+}
+
+}  // namespace verifiable
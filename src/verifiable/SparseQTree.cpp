@@ -0,0 +1,590 @@
+#include "verifiable/SparseQTree.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace verifiable {
+
+namespace {
+
+// Dirty nodes per parallel chunk, as in QTree.
+const size_t kHashGrain = 256;
+
+const uint8_t kEmptyDigest[32] = {0};
+
+enum Terminal : uint8_t {
+  kTerminalEmpty = 0,
+  kTerminalOwn = 1,
+  kTerminalOther = 2
+};
+
+enum Record : uint8_t {
+  kRecordEmpty = 0,
+  kRecordLeaf = 1,
+  kRecordBoth = 2,
+  kRecordLeft = 3,
+  kRecordRight = 4
+};
+
+}  // namespace
+
+const uint32_t SparseQTree::kNone;
+const size_t SparseQTree::kKeyBits;
+
+SparseQTree::SparseQTree() : m_root(kNone), m_size(0), m_initialized(false) {}
+
+SparseQTree::~SparseQTree() {}
+
+void SparseQTree::initialize(const std::vector<bool>& bit_array) {
+  for (size_t i = 0; i < bit_array.size(); ++i) {
+    if (bit_array[i]) {
+      throw std::invalid_argument(
+          "SparseQTree cannot be initialized from set bit positions");
+    }
+  }
+  m_nodes.clear();
+  m_free.clear();
+  m_root = kNone;
+  m_size = 0;
+  m_initialized = true;
+  m_version = 1;
+}
+
+void SparseQTree::updateBits(const std::vector<std::string>& addresses,
+                             bool value) {
+  if (!m_initialized) {
+    initialize(std::vector<bool>());
+  }
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    const Key key = KeyOf(addresses[i]);
+    uint32_t root = m_root;
+    if (value ? insert(&root, key, 0) : remove(&root, key, 0)) {
+      m_size = value ? m_size + 1 : m_size - 1;
+    }
+    m_root = root;
+  }
+  rehashDirty();
+  m_version++;
+}
+
+bool SparseQTree::getBit(const std::string& address) const {
+  const Key key = KeyOf(address);
+  uint32_t index = m_root;
+  for (size_t depth = 0; index != kNone; ++depth) {
+    const Node& node = m_nodes[index];
+    if (node.leaf) {
+      return std::memcmp(node.key.bytes, key.bytes, sizeof(key.bytes)) == 0;
+    }
+    index = node.child[key.bit(depth)];
+  }
+  return false;
+}
+
+std::vector<std::string> SparseQTree::generateProof(
+    const std::string& address) const {
+  std::vector<std::string> proof;
+  if (!m_initialized) {
+    return proof;
+  }
+
+  const Key key = KeyOf(address);
+  std::vector<uint32_t> siblings;
+  uint32_t index = m_root;
+  while (index != kNone && !m_nodes[index].leaf) {
+    const Node& node = m_nodes[index];
+    const bool bit = key.bit(siblings.size());
+    siblings.push_back(node.child[!bit]);
+    index = node.child[bit];
+  }
+
+  std::string terminal(1, static_cast<char>(kTerminalEmpty));
+  if (index != kNone) {
+    const Key& leaf_key = m_nodes[index].key;
+    if (std::memcmp(leaf_key.bytes, key.bytes, sizeof(key.bytes)) == 0) {
+      terminal[0] = static_cast<char>(kTerminalOwn);
+    } else {
+      terminal[0] = static_cast<char>(kTerminalOther);
+      terminal.append(reinterpret_cast<const char*>(leaf_key.bytes),
+                      sizeof(leaf_key.bytes));
+    }
+  }
+
+  const size_t depth = siblings.size();
+  std::string bitmap(2 + (depth + 7) / 8, '\0');
+  bitmap[0] = static_cast<char>(depth >> 8);
+  bitmap[1] = static_cast<char>(depth & 0xff);
+  proof.push_back(terminal);
+  proof.push_back(std::string());
+  for (size_t d = 0; d < depth; ++d) {
+    if (siblings[d] == kNone) {
+      continue;
+    }
+    bitmap[2 + d / 8] =
+        static_cast<char>(bitmap[2 + d / 8] | (0x80 >> (d % 8)));
+    proof.push_back(std::string(
+        reinterpret_cast<const char*>(digestOf(siblings[d])), kDigestBytes));
+  }
+  proof[1].swap(bitmap);
+  return proof;
+}
+
+std::string SparseQTree::getRootHash() const {
+  if (!m_initialized) {
+    return "";
+  }
+  return std::string(reinterpret_cast<const char*>(digestOf(m_root)),
+                     kDigestBytes);
+}
+
+bool SparseQTree::verifyPath(const std::string& address, bool bit_value,
+                             const std::vector<std::string>& proof,
+                             const std::string& root_hash) const {
+  if (proof.size() < 2 || proof[0].empty() || proof[1].size() < 2 ||
+      root_hash.size() != kDigestBytes) {
+    return false;
+  }
+
+  const std::string& bitmap = proof[1];
+  const size_t depth =
+      (static_cast<size_t>(static_cast<uint8_t>(bitmap[0])) << 8) |
+      static_cast<uint8_t>(bitmap[1]);
+  if (depth > kKeyBits || bitmap.size() != 2 + (depth + 7) / 8) {
+    return false;
+  }
+  size_t present = 0;
+  for (size_t d = 0; d < depth; ++d) {
+    present += (static_cast<uint8_t>(bitmap[2 + d / 8]) >> (7 - d % 8)) & 1;
+  }
+  if (present != proof.size() - 2) {
+    return false;
+  }
+
+  const Key key = KeyOf(address);
+  const std::string& terminal = proof[0];
+  uint8_t current[kDigestBytes];
+  switch (static_cast<uint8_t>(terminal[0])) {
+    case kTerminalEmpty:
+      if (bit_value || terminal.size() != 1) {
+        return false;
+      }
+      std::memcpy(current, kEmptyDigest, kDigestBytes);
+      break;
+    case kTerminalOwn:
+      if (!bit_value || terminal.size() != 1) {
+        return false;
+      }
+      LeafDigest(key, current);
+      break;
+    case kTerminalOther: {
+      if (bit_value || terminal.size() != 1 + sizeof(key.bytes)) {
+        return false;
+      }
+      Key other;
+      std::memcpy(other.bytes, terminal.data() + 1, sizeof(other.bytes));
+      if (std::memcmp(other.bytes, key.bytes, sizeof(key.bytes)) == 0) {
+        return false;
+      }
+      // The other leaf must sit on the address's own path.
+      for (size_t d = 0; d < depth; ++d) {
+        if (other.bit(d) != key.bit(d)) {
+          return false;
+        }
+      }
+      LeafDigest(other, current);
+      break;
+    }
+    default:
+      return false;
+  }
+
+  size_t next = proof.size();
+  for (size_t d = depth; d > 0; --d) {
+    const size_t level = d - 1;
+    const uint8_t* sibling = kEmptyDigest;
+    if ((static_cast<uint8_t>(bitmap[2 + level / 8]) >> (7 - level % 8)) & 1) {
+      const std::string& digest = proof[--next];
+      if (digest.size() != kDigestBytes) {
+        return false;
+      }
+      sibling = reinterpret_cast<const uint8_t*>(digest.data());
+    }
+    if (key.bit(level)) {
+      HashChildren(sibling, current, current);
+    } else {
+      HashChildren(current, sibling, current);
+    }
+  }
+
+  return std::memcmp(current, root_hash.data(), kDigestBytes) == 0;
+}
+
+std::string SparseQTree::generateMultiProof(
+    const std::vector<std::string>& addresses) const {
+  if (!m_initialized) {
+    return "";
+  }
+
+  std::vector<Key> keys;
+  keys.reserve(addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    keys.push_back(KeyOf(addresses[i]));
+  }
+  auto less = [](const Key& a, const Key& b) {
+    return std::memcmp(a.bytes, b.bytes, sizeof(a.bytes)) < 0;
+  };
+  auto equal = [](const Key& a, const Key& b) {
+    return std::memcmp(a.bytes, b.bytes, sizeof(a.bytes)) == 0;
+  };
+  std::sort(keys.begin(), keys.end(), less);
+  keys.erase(std::unique(keys.begin(), keys.end(), equal), keys.end());
+
+  std::string body;
+  uint32_t records = 0;
+  if (!keys.empty()) {
+    appendMultiProof(m_root, keys.data(), keys.data() + keys.size(), 0, &body,
+                     &records);
+  }
+  std::string proof;
+  AppendU32(records, &proof);
+  proof += body;
+  return proof;
+}
+
+bool SparseQTree::verifyMultiProof(const std::vector<std::string>& addresses,
+                                   const std::vector<bool>& bit_values,
+                                   const std::string& proof,
+                                   const std::string& root_hash) const {
+  if (addresses.empty() || addresses.size() != bit_values.size() ||
+      root_hash.size() != kDigestBytes) {
+    return false;
+  }
+  size_t pos = 0;
+  uint32_t records = 0;
+  if (!ReadU32(proof, &pos, &records)) {
+    return false;
+  }
+
+  std::vector<Claim> claims(addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    claims[i].key = KeyOf(addresses[i]);
+    claims[i].bit = bit_values[i];
+  }
+  std::sort(claims.begin(), claims.end(), [](const Claim& a, const Claim& b) {
+    return std::memcmp(a.key.bytes, b.key.bytes, sizeof(a.key.bytes)) < 0;
+  });
+  // A repeated address must claim the same bit.
+  std::vector<Claim> distinct;
+  for (size_t i = 0; i < claims.size(); ++i) {
+    if (!distinct.empty() &&
+        std::memcmp(distinct.back().key.bytes, claims[i].key.bytes,
+                    sizeof(claims[i].key.bytes)) == 0) {
+      if (distinct.back().bit != claims[i].bit) {
+        return false;
+      }
+      continue;
+    }
+    distinct.push_back(claims[i]);
+  }
+
+  uint8_t root[kDigestBytes];
+  return FoldMultiProof(distinct.data(), distinct.data() + distinct.size(), 0,
+                        proof, &pos, &records, root) &&
+         records == 0 && pos == proof.size() &&
+         std::memcmp(root, root_hash.data(), kDigestBytes) == 0;
+}
+
+void SparseQTree::setHashThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
+size_t SparseQTree::memoryBytes() const {
+  return m_nodes.capacity() * sizeof(Node) +
+         m_free.capacity() * sizeof(uint32_t);
+}
+
+SparseQTree::Key SparseQTree::KeyOf(const std::string& address) {
+  Key key;
+  Sha256(reinterpret_cast<const uint8_t*>(address.data()), address.size(),
+         key.bytes);
+  return key;
+}
+
+void SparseQTree::LeafDigest(const Key& key, uint8_t* out) {
+  uint8_t input[1 + sizeof(key.bytes)];
+  input[0] = 0;
+  std::memcpy(input + 1, key.bytes, sizeof(key.bytes));
+  Sha256(input, sizeof(input), out);
+}
+
+uint32_t SparseQTree::newLeaf(const Key& key) {
+  const uint32_t index = newInternal();
+  Node& node = m_nodes[index];
+  node.leaf = true;
+  node.dirty = false;
+  node.key = key;
+  LeafDigest(key, node.digest);
+  return index;
+}
+
+uint32_t SparseQTree::newInternal() {
+  uint32_t index;
+  if (!m_free.empty()) {
+    index = m_free.back();
+    m_free.pop_back();
+  } else {
+    if (m_nodes.size() >= kNone) {
+      throw std::runtime_error("SparseQTree node arena is full");
+    }
+    index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node());
+  }
+  Node& node = m_nodes[index];
+  node.leaf = false;
+  node.dirty = true;
+  node.child[0] = kNone;
+  node.child[1] = kNone;
+  return index;
+}
+
+void SparseQTree::freeNode(uint32_t index) { m_free.push_back(index); }
+
+const uint8_t* SparseQTree::digestOf(uint32_t index) const {
+  return index == kNone ? kEmptyDigest : m_nodes[index].digest;
+}
+
+bool SparseQTree::insert(uint32_t* slot, const Key& key, size_t depth) {
+  if (*slot == kNone) {
+    *slot = newLeaf(key);
+    return true;
+  }
+
+  const uint32_t index = *slot;
+  if (m_nodes[index].leaf) {
+    const Key other = m_nodes[index].key;
+    if (std::memcmp(other.bytes, key.bytes, sizeof(key.bytes)) == 0) {
+      return false;
+    }
+    // Push the existing leaf down until the two keys diverge.
+    uint32_t parent = newInternal();
+    *slot = parent;
+    while (key.bit(depth) == other.bit(depth)) {
+      const uint32_t child = newInternal();
+      m_nodes[parent].child[key.bit(depth)] = child;
+      parent = child;
+      ++depth;
+    }
+    const uint32_t leaf = newLeaf(key);
+    m_nodes[parent].child[key.bit(depth)] = leaf;
+    m_nodes[parent].child[other.bit(depth)] = index;
+    return true;
+  }
+
+  const bool bit = key.bit(depth);
+  uint32_t child = m_nodes[index].child[bit];
+  if (!insert(&child, key, depth + 1)) {
+    return false;
+  }
+  m_nodes[index].child[bit] = child;
+  m_nodes[index].dirty = true;
+  return true;
+}
+
+bool SparseQTree::remove(uint32_t* slot, const Key& key, size_t depth) {
+  if (*slot == kNone) {
+    return false;
+  }
+
+  const uint32_t index = *slot;
+  if (m_nodes[index].leaf) {
+    if (std::memcmp(m_nodes[index].key.bytes, key.bytes, sizeof(key.bytes)) !=
+        0) {
+      return false;
+    }
+    freeNode(index);
+    *slot = kNone;
+    return true;
+  }
+
+  const bool bit = key.bit(depth);
+  uint32_t child = m_nodes[index].child[bit];
+  if (!remove(&child, key, depth + 1)) {
+    return false;
+  }
+  m_nodes[index].child[bit] = child;
+
+  // A node left with one leaf and an empty side collapses into the leaf;
+  // the parent then sees the leaf and may collapse in turn.
+  const uint32_t left = m_nodes[index].child[0];
+  const uint32_t right = m_nodes[index].child[1];
+  const uint32_t only = left == kNone ? right : (right == kNone ? left : kNone);
+  if (only != kNone && m_nodes[only].leaf) {
+    freeNode(index);
+    *slot = only;
+  } else {
+    m_nodes[index].dirty = true;
+  }
+  return true;
+}
+
+void SparseQTree::rehashDirty() {
+  std::vector<std::vector<uint32_t>> by_depth;
+  collectDirty(m_root, 0, &by_depth);
+
+  for (size_t d = by_depth.size(); d > 0; --d) {
+    const std::vector<uint32_t>& nodes = by_depth[d - 1];
+    auto body = [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        Node& node = m_nodes[nodes[i]];
+        HashChildren(digestOf(node.child[0]), digestOf(node.child[1]),
+                     node.digest);
+        node.dirty = false;
+      }
+    };
+    if (m_pool && nodes.size() > kHashGrain) {
+      m_pool->parallelFor(nodes.size(), kHashGrain, body);
+    } else {
+      body(0, nodes.size());
+    }
+  }
+}
+
+void SparseQTree::collectDirty(
+    uint32_t index, size_t depth,
+    std::vector<std::vector<uint32_t>>* by_depth) const {
+  // A clean node has no dirty descendants: every edit marks its whole path.
+  if (index == kNone || m_nodes[index].leaf || !m_nodes[index].dirty) {
+    return;
+  }
+  if (by_depth->size() <= depth) {
+    by_depth->resize(depth + 1);
+  }
+  (*by_depth)[depth].push_back(index);
+  collectDirty(m_nodes[index].child[0], depth + 1, by_depth);
+  collectDirty(m_nodes[index].child[1], depth + 1, by_depth);
+}
+
+void SparseQTree::appendMultiProof(uint32_t index, const Key* first,
+                                   const Key* last, size_t depth,
+                                   std::string* out, uint32_t* records) const {
+  ++*records;
+  if (index == kNone) {
+    out->push_back(static_cast<char>(kRecordEmpty));
+    return;
+  }
+  const Node& node = m_nodes[index];
+  if (node.leaf) {
+    out->push_back(static_cast<char>(kRecordLeaf));
+    out->append(reinterpret_cast<const char*>(node.key.bytes),
+                sizeof(node.key.bytes));
+    return;
+  }
+
+  // Sorted keys sharing the first depth bits split into a 0 run and a 1 run.
+  const Key* split = std::partition_point(
+      first, last, [depth](const Key& key) { return !key.bit(depth); });
+  if (split == last) {
+    out->push_back(static_cast<char>(kRecordLeft));
+    out->append(reinterpret_cast<const char*>(digestOf(node.child[1])),
+                kDigestBytes);
+    appendMultiProof(node.child[0], first, last, depth + 1, out, records);
+  } else if (split == first) {
+    out->push_back(static_cast<char>(kRecordRight));
+    out->append(reinterpret_cast<const char*>(digestOf(node.child[0])),
+                kDigestBytes);
+    appendMultiProof(node.child[1], first, last, depth + 1, out, records);
+  } else {
+    out->push_back(static_cast<char>(kRecordBoth));
+    appendMultiProof(node.child[0], first, split, depth + 1, out, records);
+    appendMultiProof(node.child[1], split, last, depth + 1, out, records);
+  }
+}
+
+bool SparseQTree::FoldMultiProof(const Claim* first, const Claim* last,
+                                 size_t depth, const std::string& proof,
+                                 size_t* pos, uint32_t* records,
+                                 uint8_t* out) {
+  if (*records == 0 || *pos >= proof.size()) {
+    return false;
+  }
+  --*records;
+  const uint8_t tag = static_cast<uint8_t>(proof[(*pos)++]);
+
+  if (tag == kRecordEmpty) {
+    for (const Claim* claim = first; claim != last; ++claim) {
+      if (claim->bit) {
+        return false;
+      }
+    }
+    std::memcpy(out, kEmptyDigest, kDigestBytes);
+    return true;
+  }
+
+  if (tag == kRecordLeaf) {
+    Key leaf;
+    if (proof.size() - *pos < sizeof(leaf.bytes)) {
+      return false;
+    }
+    std::memcpy(leaf.bytes, proof.data() + *pos, sizeof(leaf.bytes));
+    *pos += sizeof(leaf.bytes);
+    // The leaf must sit on the claims' shared path, and exactly the claim
+    // with its key may be set.
+    for (size_t d = 0; d < depth; ++d) {
+      if (leaf.bit(d) != first->key.bit(d)) {
+        return false;
+      }
+    }
+    for (const Claim* claim = first; claim != last; ++claim) {
+      const bool same = std::memcmp(claim->key.bytes, leaf.bytes,
+                                    sizeof(leaf.bytes)) == 0;
+      if (claim->bit != same) {
+        return false;
+      }
+    }
+    LeafDigest(leaf, out);
+    return true;
+  }
+
+  if (depth >= kKeyBits) {
+    return false;
+  }
+  const Claim* split =
+      std::partition_point(first, last, [depth](const Claim& claim) {
+        return !claim.key.bit(depth);
+      });
+  uint8_t left[kDigestBytes];
+  uint8_t right[kDigestBytes];
+  switch (tag) {
+    case kRecordBoth:
+      if (split == first || split == last ||
+          !FoldMultiProof(first, split, depth + 1, proof, pos, records, left) ||
+          !FoldMultiProof(split, last, depth + 1, proof, pos, records, right)) {
+        return false;
+      }
+      break;
+    case kRecordLeft:
+    case kRecordRight: {
+      const bool go_left = tag == kRecordLeft;
+      if ((go_left ? split != last : split != first) ||
+          proof.size() - *pos < kDigestBytes) {
+        return false;
+      }
+      std::memcpy(go_left ? right : left, proof.data() + *pos, kDigestBytes);
+      *pos += kDigestBytes;
+      if (!FoldMultiProof(first, last, depth + 1, proof, pos, records,
+                          go_left ? left : right)) {
+        return false;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  HashChildren(left, right, out);
+  return true;
+}
+
+}  // namespace verifiable
@@ -3,12 +3,15 @@
 #include <algorithm>
 #include <cstdlib>
 #include <map>
+#include <memory>
 #include <set>
-#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "core/Primitive.hpp"
+#include "core/QueryPlanner.hpp"
 #include "vq-nomos/Common.hpp"
 #include "vq-nomos/MerkleOpen.hpp"
 #include "vq-nomos/QTree.hpp"
@@ -41,10 +44,17 @@ struct RelationKey {
 
 }  // namespace
 
-Client::Client() : m_qtree_capacity(1024), m_bucket_count(10) {}
+Client::Client()
+    : m_qtree_capacity(1024),
+      m_bucket_count(10),
+      m_xterm_order(core::XTermOrder::kAscendingCount) {}
 
 Client::~Client() {}
 
+void Client::setHashThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
 int Client::setup(const std::string& public_key_pem,
                   const Anchor& initial_anchor, size_t qtree_capacity,
                   int bucket_count) {
@@ -67,20 +77,7 @@ TokenRequest Client::genToken(
 
   req.query_keywords = query_keywords;
 
-  int min_update_count = getUpdateCount(update_count, req.query_keywords[0]);
-  int min_index = 0;
-  for (int i = 1; i < n; ++i) {
-    const int current_count =
-        getUpdateCount(update_count, req.query_keywords[i]);
-    if (current_count < min_update_count) {
-      min_update_count = current_count;
-      min_index = i;
-    }
-  }
-
-  if (min_index != 0) {
-    std::swap(req.query_keywords[0], req.query_keywords[min_index]);
-  }
+  core::PlanQuery(&req.query_keywords, update_count, m_xterm_order);
 
   const std::string& w1 = req.query_keywords[0];
   const int m = getUpdateCount(update_count, w1);
@@ -92,27 +89,19 @@ TokenRequest Client::genToken(
     ep_t hw;
     ep_new(hw);
     Hash_H1(hw, req.query_keywords[i]);
-    req.hashed_keywords.push_back(SerializePoint(hw));
+    req.hashed_keywords.push_back(CompressPoint(hw));
     ep_free(hw);
   }
 
-  for (int j = 1; j <= m; ++j) {
-    std::stringstream ss_b;
-    std::stringstream ss_c;
-    ss_b << w1 << "|" << j << "|0";
-    ss_c << w1 << "|" << j << "|1";
-
-    ep_t b;
-    ep_t c;
-    ep_new(b);
-    ep_new(c);
-    Hash_H1(b, ss_b.str());
-    Hash_H1(c, ss_c.str());
-    req.hw1_j_0.push_back(SerializePoint(b));
-    req.hw1_j_1.push_back(SerializePoint(c));
-    ep_free(b);
-    ep_free(c);
-  }
+  // H(w1||j||0) and H(w1||j||1) for j=1..m, hashed as one batch each.
+  const size_t count = static_cast<size_t>(m);
+  PointBuffer points(2 * count);
+  Hash_H1_Batch(points.data(), w1, 1, count, 0, m_pool.get());
+  Hash_H1_Batch(points.data() + count, w1, 1, count, 1, m_pool.get());
+  std::vector<core::CompressedPoint> encoded(points.size());
+  SerializePoints(points.data(), points.size(), encoded.data());
+  req.hw1_j_0.assign(encoded.begin(), encoded.begin() + m);
+  req.hw1_j_1.assign(encoded.begin() + m, encoded.end());
 
   return req;
 }
@@ -137,43 +126,57 @@ SearchRequest Client::prepareSearch(const SearchToken& token,
   const std::string& w1 = token_request.query_keywords[0];
   const std::string kz = F(SerializePoint(token.strap), "1");
 
+  // e_j = F_p(Kz, w1||j) for j=1..m under one precomputed HMAC state.
+  std::vector<std::string> e_inputs(static_cast<size_t>(m));
   bn_t* e = new bn_t[m];
   for (int j = 1; j <= m; ++j) {
     bn_new(e[j - 1]);
-    std::stringstream ss;
-    ss << w1 << "|" << j;
-    F_p(e[j - 1], kz, ss.str());
+    e_inputs[static_cast<size_t>(j - 1)] = w1 + "|" + std::to_string(j);
   }
+  KeyedPrf(kz).F_p_Batch(e, e_inputs);
 
   for (int j = 0; j < m; ++j) {
     req.stokenList.push_back(token.bstag[static_cast<size_t>(j)]);
   }
 
-  const int k = 2;
+  // Deserialize and precompute each bxtrap once; it is the base for all m
+  // exponentiations below.
+  const int k = static_cast<int>(token.beta_indices.size());
   const int cross_keyword_count =
       std::min(static_cast<int>(token.bxtrap.size()), n - 1);
-  for (int j = 0; j < m; ++j) {
-    std::vector<std::vector<std::string>> xtoken_list_j;
-    for (int i = 0; i < cross_keyword_count; ++i) {
-      std::vector<std::string> xtoken_list_ji;
-      for (int t = 0; t < k; ++t) {
-        ep_t bxtrap_it;
-        ep_new(bxtrap_it);
-        DeserializePoint(
-            bxtrap_it,
-            token.bxtrap[static_cast<size_t>(i)][static_cast<size_t>(t)]);
-
-        ep_t xtoken;
-        ep_new(xtoken);
-        ep_mul(xtoken, bxtrap_it, e[j]);
-        xtoken_list_ji.push_back(SerializePoint(xtoken));
-
-        ep_free(xtoken);
-        ep_free(bxtrap_it);
-      }
-      xtoken_list_j.push_back(xtoken_list_ji);
+  std::vector<std::unique_ptr<FixedBasePoint>> bases;
+  for (int i = 0; i < cross_keyword_count; ++i) {
+    if (static_cast<int>(token.bxtrap[static_cast<size_t>(i)].size()) != k) {
+      throw std::invalid_argument(
+          "SearchToken bxtrap size does not match beta_indices");
+    }
+    for (int t = 0; t < k; ++t) {
+      bases.emplace_back(new FixedBasePoint(
+          token.bxtrap[static_cast<size_t>(i)][static_cast<size_t>(t)]));
+    }
+  }
+
+  // All m·(n-1)·k xtokens are computed first and then encoded as one batch.
+  const size_t row = bases.size();
+  PointBuffer xtokens(static_cast<size_t>(m) * row);
+  for (size_t j = 0; j < static_cast<size_t>(m); ++j) {
+    for (size_t b = 0; b < row; ++b) {
+      bases[b]->mul(xtokens[j * row + b], e[j]);
+    }
+  }
+  std::vector<core::CompressedPoint> encoded(xtokens.size());
+  SerializePoints(xtokens.data(), xtokens.size(), encoded.data());
+
+  req.xtokenList.assign(
+      static_cast<size_t>(m),
+      std::vector<std::vector<core::CompressedPoint>>(
+          static_cast<size_t>(cross_keyword_count)));
+  for (size_t j = 0; j < static_cast<size_t>(m); ++j) {
+    for (size_t i = 0; i < static_cast<size_t>(cross_keyword_count); ++i) {
+      std::vector<core::CompressedPoint>::const_iterator first =
+          encoded.begin() + j * row + i * static_cast<size_t>(k);
+      req.xtokenList[j][i].assign(first, first + k);
     }
-    req.xtokenList.push_back(xtoken_list_j);
   }
 
   for (int j = 0; j < m; ++j) {
@@ -231,7 +234,10 @@ VerificationResult Client::decryptAndVerify(const SearchResponse& response,
   }
 
   std::map<RelationKey, bool> relation_verdicts;
-  QTree qtree_verifier(m_qtree_capacity);
+  std::unique_ptr<QTreeBase> qtree_verifier = MakeQTree(m_qtree_capacity);
+  // Set-bit witnesses carry no path; they are checked together against
+  // response.qtree_multiproof once every relation has been read.
+  std::vector<std::string> set_addresses;
   for (size_t i = 0; i < response.relation_proofs.size(); ++i) {
     const RelationProof& proof = response.relation_proofs[i];
     RelationKey key;
@@ -274,7 +280,7 @@ VerificationResult Client::decryptAndVerify(const SearchResponse& response,
         }
         if (!MerkleOpenTree::VerifyPath(proof.auth.root_hash,
                                         opening.beta_index, opening.xtag,
-                                        opening.path, 3)) {
+                                        opening.path, token.ell)) {
           return result;
         }
         opened_addresses.insert(opening.xtag);
@@ -299,8 +305,11 @@ VerificationResult Client::decryptAndVerify(const SearchResponse& response,
          ++witness_index) {
       const QTreeWitness& witness =
           proof.qualification.witnesses[witness_index];
-      if (!qtree_verifier.verifyPath(witness.address, witness.bit_value,
-                                     witness.path, response.anchor.root_hash)) {
+      if (witness.bit_value && witness.path.empty()) {
+        set_addresses.push_back(witness.address);
+      } else if (!qtree_verifier->verifyPath(witness.address, witness.bit_value,
+                                            witness.path,
+                                            response.anchor.root_hash)) {
         return result;
       }
       proof_addresses.insert(witness.address);
@@ -340,6 +349,12 @@ VerificationResult Client::decryptAndVerify(const SearchResponse& response,
   if (relation_verdicts.size() != expected_relations.size()) {
     return result;
   }
+  if (!set_addresses.empty() &&
+      !qtree_verifier->verifyMultiProof(
+          set_addresses, std::vector<bool>(set_addresses.size(), true),
+          response.qtree_multiproof, response.anchor.root_hash)) {
+    return result;
+  }
 
   std::set<int> recomputed_result_slots;
   for (std::map<int, DecryptedEntry>::const_iterator it =
@@ -33,13 +33,26 @@ int sampleBetaIndex(int ell) {
   return (sample % ell) + 1;
 }
 
+void validateCrossTagParams(int ell, int k) {
+  // sampleBetaIndex draws from a single byte, which caps ℓ at 255.
+  if (ell < 1 || ell > 255) {
+    throw std::invalid_argument("ell must be in [1, 255]");
+  }
+  if (k < 1 || k > ell) {
+    throw std::invalid_argument("k must be in [1, ell]");
+  }
+}
+
 }  // namespace
 
 Gatekeeper::Gatekeeper()
     : m_Kt(NULL),
       m_Kx(NULL),
       m_d(0),
+      m_ell(3),
+      m_k(2),
       m_qtree(new QTree(1024)),
+      m_update_threads(1),
       m_signing_key(NULL) {
   bn_null(m_Ks);
   bn_null(m_Ky);
@@ -68,8 +81,11 @@ Gatekeeper::~Gatekeeper() {
   }
 }
 
-int Gatekeeper::setup(int d, size_t qtree_capacity) {
+int Gatekeeper::setup(int d, size_t qtree_capacity, int ell, int k) {
+  validateCrossTagParams(ell, k);
   m_d = d;
+  m_ell = ell;
+  m_k = k;
 
   bn_t ord;
   bn_new(ord);
@@ -100,10 +116,14 @@ int Gatekeeper::setup(int d, size_t qtree_capacity) {
   }
 
   m_updateCnt.clear();
+  m_field.reset(new core::ScalarField());
+  m_ky_prf.reset(new KeyedPrf(m_Ky));
+  m_token_cache.clear();  // cached prefixes were derived under the old Kt
   bn_free(ord);
 
-  m_qtree.reset(new QTree(qtree_capacity));
-  m_qtree->initialize(std::vector<bool>(m_qtree->getCapacity(), false));
+  m_qtree = MakeQTree(qtree_capacity);
+  m_qtree->setHashThreads(m_update_threads);
+  m_qtree->initialize(std::vector<bool>());
 
   if (m_signing_key != NULL) {
     EVP_PKEY_free(m_signing_key);
@@ -125,6 +145,45 @@ int Gatekeeper::setup(int d, size_t qtree_capacity) {
 
 UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
                                   const std::string& keyword) {
+  std::vector<std::string> xtag_keys;
+  UpdateMetadata meta = buildUpdate(op, id, keyword, &xtag_keys);
+  m_qtree->updateBits(xtag_keys, true);
+  meta.anchor = buildAnchor();
+  return meta;
+}
+
+std::vector<UpdateMetadata> Gatekeeper::updateBatch(
+    const std::vector<UpdateRequest>& requests) {
+  std::vector<UpdateMetadata> metas;
+  if (requests.empty()) {
+    return metas;
+  }
+
+  metas.reserve(requests.size());
+  std::vector<std::string> xtag_keys;
+  xtag_keys.reserve(requests.size() * static_cast<size_t>(m_ell));
+  for (size_t i = 0; i < requests.size(); ++i) {
+    metas.push_back(buildUpdate(requests[i].op, requests[i].id,
+                                requests[i].keyword, &xtag_keys));
+  }
+
+  // One QTree version and one anchor signature for the whole batch.
+  m_qtree->updateBits(xtag_keys, true);
+  const Anchor anchor = buildAnchor();
+  for (size_t i = 0; i < metas.size(); ++i) {
+    metas[i].anchor = anchor;
+  }
+  return metas;
+}
+
+void Gatekeeper::setUpdateThreads(size_t num_threads) {
+  m_update_threads = num_threads;
+  m_qtree->setHashThreads(num_threads);
+}
+
+UpdateMetadata Gatekeeper::buildUpdate(OP op, const std::string& id,
+                                       const std::string& keyword,
+                                       std::vector<std::string>* xtag_keys) {
   // Paper: Algorithm 2 + Chapter 3 Update'
   UpdateMetadata meta;
 
@@ -176,11 +235,10 @@ UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
   ep_free(mask_point);
 
   bn_new(meta.alpha);
+  // F_p(Ky, id||op) feeds both alpha and the xtag exponent.
   bn_t fp_ky;
   bn_new(fp_ky);
-  std::stringstream ss_id_op;
-  ss_id_op << id << "|" << static_cast<int>(op);
-  F_p(fp_ky, m_Ky, ss_id_op.str());
+  m_ky_prf->F_p(fp_ky, plaintext);
 
   bn_t fp_kz;
   bn_new(fp_kz);
@@ -188,67 +246,43 @@ UpdateMetadata Gatekeeper::update(OP op, const std::string& id,
   ss_w_cnt << keyword << "|" << cnt;
   F_p(fp_kz, kz, ss_w_cnt.str());
 
-  bn_t ord;
-  bn_new(ord);
-  ep_curve_get_ord(ord);
-
   bn_t fp_kz_inv;
   bn_new(fp_kz_inv);
-  bn_mod_inv(fp_kz_inv, fp_kz, ord);
-  bn_mul(meta.alpha, fp_ky, fp_kz_inv);
-  bn_mod(meta.alpha, meta.alpha, ord);
+  m_field->inv(fp_kz_inv, fp_kz);
+  m_field->mul(meta.alpha, fp_ky, fp_kz_inv);
 
-  bn_free(fp_ky);
   bn_free(fp_kz);
   bn_free(fp_kz_inv);
-  bn_free(ord);
 
-  meta.xtags.clear();
   ep_t hw;
   ep_new(hw);
   Hash_H1(hw, keyword);
 
-  bn_t fp_ky_id_op;
-  bn_new(fp_ky_id_op);
-  F_p(fp_ky_id_op, m_Ky, ss_id_op.str());
-
-  bn_t ord2;
-  bn_new(ord2);
-  ep_curve_get_ord(ord2);
-
-  const int ell = 3;
-  for (int i = 1; i <= ell; ++i) {
-    bn_t exp;
-    bn_t i_bn;
-    bn_new(exp);
-    bn_new(i_bn);
-    bn_set_dig(i_bn, i);
-
-    bn_mul(exp, m_Kx[idx], fp_ky_id_op);
-    bn_mul(exp, exp, i_bn);
-    bn_mod(exp, exp, ord2);
-
-    ep_t xtag;
-    ep_new(xtag);
-    ep_mul(xtag, hw, exp);
-    meta.xtags.push_back(SerializePoint(xtag));
-
-    ep_free(xtag);
-    bn_free(exp);
-    bn_free(i_bn);
+  // xtag_i = H(w)^{Kx·F_p·i} = xtag_{i-1} + xtag_1.
+  bn_t exp;
+  bn_new(exp);
+  m_field->mul(exp, m_Kx[idx], fp_ky);
+
+  // The ep_add results share one normalization in SerializePoints.
+  PointBuffer xtags(static_cast<size_t>(m_ell));
+  ep_mul(xtags[0], hw, exp);
+  for (int i = 1; i < m_ell; ++i) {
+    ep_add(xtags[i], xtags[i - 1], xtags[0]);
   }
+  meta.xtags.resize(xtags.size());
+  SerializePoints(xtags.data(), xtags.size(), meta.xtags.data());
+  bn_free(exp);
 
   ep_free(hw);
-  bn_free(fp_ky_id_op);
-  bn_free(ord2);
+  bn_free(fp_ky);
 
   meta.keyword = keyword;
-  MerkleOpenTree merkle_tree(meta.xtags);
+  const std::vector<std::string> keys = XtagStrings(meta.xtags);
+  MerkleOpenTree merkle_tree(keys);
   meta.merkle_root = merkle_tree.getRootHash();
   meta.merkle_signature = signMerkleRoot(keyword, meta.merkle_root);
 
-  m_qtree->updateBits(meta.xtags, true);
-  meta.anchor = buildAnchor();
+  xtag_keys->insert(xtag_keys->end(), keys.begin(), keys.end());
   return meta;
 }
 
@@ -293,32 +327,19 @@ SearchToken Gatekeeper::genToken(const TokenRequest& request) {
   DeserializePoint(token.strap, request.hashed_keywords[0]);
   ep_mul(token.strap, token.strap, m_Ks);
 
+  // bstag_j and delta_j reuse the cached prefix for w1; the rest is computed
+  // as one batch.
   const int I1 = indexFunction(w1);
-  for (int j = 0; j < m; ++j) {
-    ep_t point;
-    ep_new(point);
-    DeserializePoint(point, request.hw1_j_0[static_cast<size_t>(j)]);
-    ep_mul(point, point, m_Kt[I1]);
-    token.bstag.push_back(SerializePoint(point));
-    ep_free(point);
-  }
-
-  for (int j = 0; j < m; ++j) {
-    ep_t point;
-    ep_new(point);
-    DeserializePoint(point, request.hw1_j_1[static_cast<size_t>(j)]);
-    ep_mul(point, point, m_Kt[I1]);
-    token.delta.push_back(SerializePoint(point));
-    ep_free(point);
-  }
+  m_token_cache.derive(w1, m_Kt[I1], request.hw1_j_0, request.hw1_j_1,
+                       &token.bstag, &token.delta);
 
-  const int k = 2;
-  const int ell = 3;
+  const int k = m_k;
   std::vector<int> beta(k);
   for (int i = 0; i < k; ++i) {
-    beta[i] = sampleBetaIndex(ell);
+    beta[i] = sampleBetaIndex(m_ell);
   }
   token.beta_indices = beta;
+  token.ell = m_ell;
 
   for (int j = 1; j < n; ++j) {
     const std::string& wj = request.query_keywords[static_cast<size_t>(j)];
@@ -329,7 +350,7 @@ SearchToken Gatekeeper::genToken(const TokenRequest& request) {
     DeserializePoint(xtrap_j, request.hashed_keywords[static_cast<size_t>(j)]);
     ep_mul(xtrap_j, xtrap_j, m_Kx[Ij]);
 
-    std::vector<std::string> bxtrap_j;
+    std::vector<core::CompressedPoint> bxtrap_j;
     for (int t = 0; t < k; ++t) {
       bn_t beta_bn;
       ep_t bxtrap_jt;
@@ -337,7 +358,7 @@ SearchToken Gatekeeper::genToken(const TokenRequest& request) {
       bn_set_dig(beta_bn, beta[t]);
       ep_new(bxtrap_jt);
       ep_mul(bxtrap_jt, xtrap_j, beta_bn);
-      bxtrap_j.push_back(SerializePoint(bxtrap_jt));
+      bxtrap_j.push_back(CompressPoint(bxtrap_jt));
       ep_free(bxtrap_jt);
       bn_free(beta_bn);
     }
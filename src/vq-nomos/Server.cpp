@@ -3,41 +3,69 @@
 #include <stdexcept>
 #include <vector>
 
+#include "core/Primitive.hpp"
+
 namespace vqnomos {
 
-Server::Server() : m_qtree(new QTree(1024)) {}
+namespace {
+
+// Slots handed to a search worker at a time.
+const size_t kSearchGrain = 8;
+
+}  // namespace
+
+Server::Server() : m_qtree(new QTree(1024)), m_update_threads(1) {}
 
 Server::~Server() {
-  m_TSet.clear();
-  m_XSet.clear();
   m_MPos.clear();
   m_MTree.clear();
 }
 
 void Server::setup(const std::vector<uint8_t>& /*Km*/,
                    const Anchor& initial_anchor, size_t qtree_capacity) {
-  m_qtree.reset(new QTree(qtree_capacity));
-  m_qtree->initialize(std::vector<bool>(m_qtree->getCapacity(), false));
+  m_qtree = MakeQTree(qtree_capacity);
+  m_qtree->setHashThreads(m_update_threads);
+  m_qtree->initialize(std::vector<bool>());
   m_current_anchor = initial_anchor;
 }
 
 void Server::update(const UpdateMetadata& metadata) {
-  // Paper: Update' - store TSet/XSet plus Merkle-open auxiliary state.
-  const std::string addr_key = serializePoint(metadata.addr);
+  std::vector<std::string> xtag_keys;
+  storeUpdate(metadata, &xtag_keys);
+  m_qtree->updateBits(xtag_keys, true);
+  m_current_anchor = metadata.anchor;
+}
+
+void Server::updateBatch(const std::vector<UpdateMetadata>& metas) {
+  if (metas.empty()) {
+    return;
+  }
+
+  std::vector<std::string> xtag_keys;
+  for (size_t i = 0; i < metas.size(); ++i) {
+    storeUpdate(metas[i], &xtag_keys);
+  }
+  m_qtree->updateBits(xtag_keys, true);
+  m_current_anchor = metas.back().anchor;
+}
+
+void Server::setUpdateThreads(size_t num_threads) {
+  m_update_threads = num_threads;
+  m_qtree->setHashThreads(num_threads);
+}
 
-  TSetEntry entry;
-  entry.val = metadata.val;
-  bn_new(entry.alpha);
-  bn_copy(entry.alpha, metadata.alpha);
-  m_TSet[addr_key] = std::move(entry);
+void Server::storeUpdate(const UpdateMetadata& metadata,
+                         std::vector<std::string>* xtag_keys) {
+  // Paper: Update' - store TSet/XSet plus Merkle-open auxiliary state.
+  m_TSet.insert(CompressPoint(metadata.addr), metadata.val, metadata.alpha);
 
-  std::shared_ptr<MerkleOpenTree> merkle_tree(
-      new MerkleOpenTree(metadata.xtags));
+  const std::vector<std::string> keys = XtagStrings(metadata.xtags);
+  std::shared_ptr<MerkleOpenTree> merkle_tree(new MerkleOpenTree(keys));
   m_MTree[metadata.merkle_root] = merkle_tree;
 
-  for (size_t i = 0; i < metadata.xtags.size(); ++i) {
-    const std::string& xtag = metadata.xtags[i];
-    m_XSet[xtag] = true;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const std::string& xtag = keys[i];
+    m_XSet.insert(metadata.xtags[i]);
 
     MerklePosition position;
     position.leaf_index = static_cast<int>(i + 1);
@@ -46,8 +74,7 @@ void Server::update(const UpdateMetadata& metadata) {
     m_MPos[xtag] = position;
   }
 
-  m_qtree->updateBits(metadata.xtags, true);
-  m_current_anchor = metadata.anchor;
+  xtag_keys->insert(xtag_keys->end(), keys.begin(), keys.end());
 }
 
 SearchResponse Server::search(const SearchRequest& request,
@@ -56,150 +83,196 @@ SearchResponse Server::search(const SearchRequest& request,
   SearchResponse response;
   response.anchor = m_current_anchor;
 
+  // Slots only read server state, so they are proved independently and
+  // appended in slot order to keep the response layout unchanged.
+  const size_t m = request.stokenList.size();
+  const std::vector<core::FlatTSet::Entry> entries =
+      m_TSet.findBatch(request.stokenList);
+  std::vector<SlotProof> slots(m);
+  auto prove = [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      if (entries[j].found()) {
+        proveSlot(request, token, static_cast<int>(j), entries[j], &slots[j]);
+      }
+    }
+  };
+  if (m_pool) {
+    m_pool->parallelFor(m, kSearchGrain, prove);
+  } else {
+    prove(0, m);
+  }
+
+  for (size_t j = 0; j < m; ++j) {
+    SlotProof& slot = slots[j];
+    if (!slot.found) {
+      continue;
+    }
+    response.entries.push_back(slot.candidate);
+    for (size_t p = 0; p < slot.relation_proofs.size(); ++p) {
+      response.relation_proofs.push_back(slot.relation_proofs[p]);
+    }
+    if (slot.all_match) {
+      response.result_slots.push_back(static_cast<int>(j) + 1);
+    }
+  }
+
+  // Positive witnesses of all relations share one multiproof, so siblings
+  // common to their paths are sent once.
+  std::vector<std::string> set_addresses;
+  for (size_t p = 0; p < response.relation_proofs.size(); ++p) {
+    const QualificationProof& qualification =
+        response.relation_proofs[p].qualification;
+    if (qualification.verdict) {
+      for (size_t w = 0; w < qualification.witnesses.size(); ++w) {
+        set_addresses.push_back(qualification.witnesses[w].address);
+      }
+    }
+  }
+  if (!set_addresses.empty()) {
+    response.qtree_multiproof = m_qtree->generateMultiProof(set_addresses);
+  }
+
+  return response;
+}
+
+void Server::setSearchThreads(size_t num_threads) {
+  m_pool.reset(num_threads == 1 ? nullptr : new core::WorkerPool(num_threads));
+}
+
+void Server::proveSlot(const SearchRequest& request, const SearchToken& token,
+                       int j, const core::FlatTSet::Entry& entry,
+                       SlotProof* out) const {
   const int num_keywords = request.num_keywords;
   const int cross_keyword_count = num_keywords > 0 ? num_keywords - 1 : 0;
 
-  for (int j = 0; j < static_cast<int>(request.stokenList.size()); ++j) {
-    const std::string& stag_key = request.stokenList[static_cast<size_t>(j)];
-    std::map<std::string, TSetEntry>::const_iterator entry_it =
-        m_TSet.find(stag_key);
-    if (entry_it == m_TSet.end()) {
-      continue;
+  out->found = true;
+  out->candidate.candidate_slot = j + 1;
+  out->candidate.sval = entry.copyVal();
+
+  bn_t alpha;
+  bn_null(alpha);
+  bn_new(alpha);
+  entry.readAlpha(alpha);
+
+  bool all_match = true;
+  for (int keyword_offset = 0; keyword_offset < cross_keyword_count;
+       ++keyword_offset) {
+    if (j >= static_cast<int>(request.xtokenList.size()) ||
+        keyword_offset >=
+            static_cast<int>(
+                request.xtokenList[static_cast<size_t>(j)].size())) {
+      all_match = false;
+      break;
     }
 
-    CandidateEntry candidate;
-    candidate.candidate_slot = j + 1;
-    candidate.sval = entry_it->second.val;
-    response.entries.push_back(candidate);
-
-    bool all_match = true;
-    for (int keyword_offset = 0; keyword_offset < cross_keyword_count;
-         ++keyword_offset) {
-      if (j >= static_cast<int>(request.xtokenList.size()) ||
-          keyword_offset >=
-              static_cast<int>(
-                  request.xtokenList[static_cast<size_t>(j)].size())) {
-        all_match = false;
-        break;
+    RelationProof relation_proof;
+    relation_proof.keyword_offset = keyword_offset + 1;
+    relation_proof.candidate_slot = j + 1;
+
+    const std::vector<core::CompressedPoint>& xtokens =
+        request.xtokenList[static_cast<size_t>(j)]
+                          [static_cast<size_t>(keyword_offset)];
+    std::vector<std::string> sampled_xtags;
+    std::vector<bool> sampled_qtree_bits;
+    std::vector<MerklePosition> sampled_positions;
+    bool has_full_merkle_open = !xtokens.empty();
+
+    // Every sampled xtag is opened, so all k are computed and encoded as one
+    // batch.
+    PointBuffer xtags(xtokens.size());
+    ep_t xtoken;
+    ep_null(xtoken);
+    ep_new(xtoken);
+    for (size_t t = 0; t < xtokens.size(); ++t) {
+      DeserializePoint(xtoken, xtokens[t]);
+      ep_mul(xtags[t], xtoken, alpha);
+    }
+    ep_free(xtoken);
+    std::vector<core::CompressedPoint> encoded(xtags.size());
+    SerializePoints(xtags.data(), xtags.size(), encoded.data());
+
+    for (size_t t = 0; t < encoded.size(); ++t) {
+      const std::string xtag_key = encoded[t].str();
+
+      sampled_xtags.push_back(xtag_key);
+      sampled_qtree_bits.push_back(m_qtree->getBit(xtag_key));
+
+      std::map<std::string, MerklePosition>::const_iterator mpos_it =
+          m_MPos.find(xtag_key);
+      if (mpos_it == m_MPos.end()) {
+        has_full_merkle_open = false;
+      } else {
+        sampled_positions.push_back(mpos_it->second);
       }
+    }
 
-      RelationProof relation_proof;
-      relation_proof.keyword_offset = keyword_offset + 1;
-      relation_proof.candidate_slot = j + 1;
-
-      const std::vector<std::string>& xtokens =
-          request.xtokenList[static_cast<size_t>(j)]
-                            [static_cast<size_t>(keyword_offset)];
-      std::vector<std::string> sampled_xtags;
-      std::vector<bool> sampled_qtree_bits;
-      std::vector<MerklePosition> sampled_positions;
-      bool has_full_merkle_open = !xtokens.empty();
-
-      for (size_t t = 0; t < xtokens.size(); ++t) {
-        ep_t xtoken;
-        ep_new(xtoken);
-        ep_read_bin(xtoken, reinterpret_cast<const uint8_t*>(xtokens[t].data()),
-                    static_cast<int>(xtokens[t].size()));
-
-        ep_t xtag;
-        ep_new(xtag);
-        ep_mul(xtag, xtoken, entry_it->second.alpha);
-        const std::string xtag_key = serializePoint(xtag);
-
-        sampled_xtags.push_back(xtag_key);
-        sampled_qtree_bits.push_back(m_qtree->getBit(xtag_key));
-
-        std::map<std::string, MerklePosition>::const_iterator mpos_it =
-            m_MPos.find(xtag_key);
-        if (mpos_it == m_MPos.end()) {
+    if (has_full_merkle_open &&
+        sampled_positions.size() == sampled_xtags.size()) {
+      const std::string root_hash = sampled_positions[0].root_hash;
+      const std::string signature = sampled_positions[0].signature;
+      for (size_t t = 1; t < sampled_positions.size(); ++t) {
+        if (sampled_positions[t].root_hash != root_hash ||
+            sampled_positions[t].signature != signature) {
           has_full_merkle_open = false;
-        } else {
-          sampled_positions.push_back(mpos_it->second);
+          break;
         }
-
-        ep_free(xtag);
-        ep_free(xtoken);
       }
 
-      if (has_full_merkle_open &&
-          sampled_positions.size() == sampled_xtags.size()) {
-        const std::string root_hash = sampled_positions[0].root_hash;
-        const std::string signature = sampled_positions[0].signature;
-        for (size_t t = 1; t < sampled_positions.size(); ++t) {
-          if (sampled_positions[t].root_hash != root_hash ||
-              sampled_positions[t].signature != signature) {
-            has_full_merkle_open = false;
-            break;
-          }
+      if (has_full_merkle_open) {
+        relation_proof.has_auth = true;
+        relation_proof.auth.root_hash = root_hash;
+        relation_proof.auth.signature = signature;
+
+        std::map<std::string, std::shared_ptr<MerkleOpenTree>>::const_iterator
+            tree_it = m_MTree.find(root_hash);
+        if (tree_it == m_MTree.end()) {
+          throw std::runtime_error("Merkle tree state missing for root");
         }
 
-        if (has_full_merkle_open) {
-          relation_proof.has_auth = true;
-          relation_proof.auth.root_hash = root_hash;
-          relation_proof.auth.signature = signature;
-
-          std::map<std::string, std::shared_ptr<MerkleOpenTree>>::const_iterator
-              tree_it = m_MTree.find(root_hash);
-          if (tree_it == m_MTree.end()) {
-            throw std::runtime_error("Merkle tree state missing for root");
-          }
-
-          for (size_t t = 0; t < sampled_xtags.size(); ++t) {
-            MerkleOpening opening;
-            opening.beta_index = token.beta_indices[t];
-            opening.xtag = sampled_xtags[t];
-            opening.path =
-                tree_it->second->generateProof(sampled_positions[t].leaf_index);
-            relation_proof.openings.push_back(opening);
-          }
+        for (size_t t = 0; t < sampled_xtags.size(); ++t) {
+          MerkleOpening opening;
+          opening.beta_index = token.beta_indices[t];
+          opening.xtag = sampled_xtags[t];
+          opening.path =
+              tree_it->second->generateProof(sampled_positions[t].leaf_index);
+          relation_proof.openings.push_back(opening);
         }
       }
+    }
 
-      relation_proof.qualification.verdict = true;
-      int first_zero_index = -1;
-      for (size_t t = 0; t < sampled_qtree_bits.size(); ++t) {
-        if (!sampled_qtree_bits[t]) {
-          relation_proof.qualification.verdict = false;
-          first_zero_index = static_cast<int>(t);
-          break;
-        }
+    relation_proof.qualification.verdict = true;
+    int first_zero_index = -1;
+    for (size_t t = 0; t < sampled_qtree_bits.size(); ++t) {
+      if (!sampled_qtree_bits[t]) {
+        relation_proof.qualification.verdict = false;
+        first_zero_index = static_cast<int>(t);
+        break;
       }
+    }
 
-      if (relation_proof.qualification.verdict) {
-        for (size_t t = 0; t < sampled_xtags.size(); ++t) {
-          QTreeWitness witness;
-          witness.address = sampled_xtags[t];
-          witness.bit_value = true;
-          witness.path = m_qtree->generateProof(sampled_xtags[t]);
-          relation_proof.qualification.witnesses.push_back(witness);
-        }
-      } else if (first_zero_index >= 0) {
+    if (relation_proof.qualification.verdict) {
+      for (size_t t = 0; t < sampled_xtags.size(); ++t) {
         QTreeWitness witness;
-        witness.address = sampled_xtags[static_cast<size_t>(first_zero_index)];
-        witness.bit_value = false;
-        witness.path = m_qtree->generateProof(witness.address);
+        witness.address = sampled_xtags[t];
+        witness.bit_value = true;
         relation_proof.qualification.witnesses.push_back(witness);
       }
-
-      response.relation_proofs.push_back(relation_proof);
-      if (!(relation_proof.qualification.verdict && relation_proof.has_auth)) {
-        all_match = false;
-      }
+    } else if (first_zero_index >= 0) {
+      QTreeWitness witness;
+      witness.address = sampled_xtags[static_cast<size_t>(first_zero_index)];
+      witness.bit_value = false;
+      witness.path = m_qtree->generateProof(witness.address);
+      relation_proof.qualification.witnesses.push_back(witness);
     }
 
-    if (all_match) {
-      response.result_slots.push_back(j + 1);
+    out->relation_proofs.push_back(relation_proof);
+    if (!(relation_proof.qualification.verdict && relation_proof.has_auth)) {
+      all_match = false;
     }
   }
 
-  return response;
-}
-
-std::string Server::serializePoint(const ep_t point) const {
-  const int len = ep_size_bin(point, 1);
-  std::vector<uint8_t> bytes(static_cast<size_t>(len));
-  ep_write_bin(bytes.data(), len, point, 1);
-  return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  bn_free(alpha);
+  out->all_match = all_match;
 }
 
 }  // namespace vqnomos
@@ -0,0 +1,181 @@
+#include "core/FlatTSet.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/Primitive.hpp"
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+class FlatTSetTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (core_get() == NULL) {
+      if (core_init() != RLC_OK) {
+        FAIL() << "Failed to initialize RELIC";
+      }
+      if (pc_param_set_any() != RLC_OK) {
+        core_clean();
+        FAIL() << "Failed to set pairing parameters";
+      }
+    }
+  }
+
+  static std::string pointKey(const std::string& label) {
+    ep_t p;
+    ep_null(p);
+    ep_new(p);
+    Hash_H1(p, label);
+    const std::string key = SerializePoint(p);
+    ep_free(p);
+    return key;
+  }
+};
+
+TEST_F(FlatTSetTest, InsertAndFindRoundTripsValAndAlpha) {
+  core::FlatTSet tset;
+  bn_t alpha;
+  bn_t recovered;
+  bn_new(alpha);
+  bn_new(recovered);
+  Hash_Zn(alpha, "alpha-1");
+
+  const std::string key = pointKey("addr-1");
+  const std::vector<uint8_t> val = {1, 2, 3, 4, 5};
+  tset.insert(key, val, alpha);
+
+  const core::FlatTSet::Entry entry = tset.find(key);
+  ASSERT_TRUE(entry.found());
+  EXPECT_EQ(entry.copyVal(), val);
+  entry.readAlpha(recovered);
+  EXPECT_EQ(bn_cmp(alpha, recovered), RLC_EQ);
+
+  EXPECT_FALSE(tset.find(pointKey("addr-missing")).found());
+  EXPECT_EQ(tset.size(), 1u);
+
+  bn_free(alpha);
+  bn_free(recovered);
+}
+
+TEST_F(FlatTSetTest, CompressedPointKeysMatchStringKeys) {
+  core::FlatTSet tset;
+  bn_t alpha;
+  bn_new(alpha);
+  Hash_Zn(alpha, "alpha-cp");
+
+  ep_t p;
+  ep_null(p);
+  ep_new(p);
+  Hash_H1(p, "addr-cp");
+  const core::CompressedPoint key = CompressPoint(p);
+  const std::vector<uint8_t> val = {9, 8, 7};
+  tset.insert(key, val, alpha);
+
+  // Both key forms address the same slot.
+  ASSERT_TRUE(tset.find(key.str()).found());
+  const std::vector<core::CompressedPoint> keys = {
+      key, CompressPoint(p)};
+  const std::vector<core::FlatTSet::Entry> entries = tset.findBatch(keys);
+  ASSERT_EQ(entries.size(), 2u);
+  EXPECT_EQ(entries[0].copyVal(), val);
+  EXPECT_EQ(entries[1].copyVal(), val);
+
+  Hash_H1(p, "addr-cp-missing");
+  EXPECT_FALSE(tset.find(CompressPoint(p)).found());
+
+  ep_free(p);
+  bn_free(alpha);
+}
+
+TEST_F(FlatTSetTest, InsertOverwritesExistingKey) {
+  core::FlatTSet tset;
+  bn_t alpha;
+  bn_t recovered;
+  bn_new(alpha);
+  bn_new(recovered);
+
+  const std::string key = pointKey("addr-overwrite");
+  Hash_Zn(alpha, "first");
+  tset.insert(key, std::vector<uint8_t>(8, 0xAA), alpha);
+  Hash_Zn(alpha, "second");
+  tset.insert(key, std::vector<uint8_t>(3, 0xBB), alpha);
+
+  EXPECT_EQ(tset.size(), 1u);
+  const core::FlatTSet::Entry entry = tset.find(key);
+  ASSERT_TRUE(entry.found());
+  EXPECT_EQ(entry.copyVal(), std::vector<uint8_t>(3, 0xBB));
+  entry.readAlpha(recovered);
+  EXPECT_EQ(bn_cmp(alpha, recovered), RLC_EQ);
+
+  bn_free(alpha);
+  bn_free(recovered);
+}
+
+TEST_F(FlatTSetTest, BulkBuildMatchesIncrementalInsertAcrossRehash) {
+  const size_t count = 500;
+  std::vector<std::string> keys(count);
+  std::vector<std::vector<uint8_t>> vals(count);
+  for (size_t i = 0; i < count; ++i) {
+    keys[i] = pointKey("bulk-" + std::to_string(i));
+    vals[i] = std::vector<uint8_t>(1 + i % 7, static_cast<uint8_t>(i));
+  }
+
+  bn_t* alphas = new bn_t[count];
+  std::vector<core::FlatTSet::Record> records(count);
+  core::FlatTSet incremental;
+  for (size_t i = 0; i < count; ++i) {
+    bn_null(alphas[i]);
+    bn_new(alphas[i]);
+    Hash_Zn(alphas[i], "bulk-alpha-" + std::to_string(i));
+    records[i].key = reinterpret_cast<const uint8_t*>(keys[i].data());
+    records[i].key_len = keys[i].size();
+    records[i].val = &vals[i];
+    records[i].alpha = alphas[i];
+    incremental.insert(keys[i], vals[i], alphas[i]);
+  }
+
+  core::FlatTSet bulk;
+  bulk.bulkBuild(records);
+  EXPECT_EQ(bulk.size(), count);
+  EXPECT_EQ(incremental.size(), count);
+
+  std::vector<std::string> probes(keys);
+  probes.push_back(pointKey("not-present"));
+  const std::vector<core::FlatTSet::Entry> found = bulk.findBatch(probes);
+  ASSERT_EQ(found.size(), probes.size());
+
+  bn_t recovered;
+  bn_new(recovered);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(found[i].found());
+    EXPECT_EQ(found[i].copyVal(), vals[i]);
+    found[i].readAlpha(recovered);
+    EXPECT_EQ(bn_cmp(recovered, alphas[i]), RLC_EQ);
+    EXPECT_EQ(incremental.find(keys[i]).copyVal(), vals[i]);
+  }
+  EXPECT_FALSE(found[count].found());
+  bn_free(recovered);
+
+  for (size_t i = 0; i < count; ++i) {
+    bn_free(alphas[i]);
+  }
+  delete[] alphas;
+}
+
+TEST_F(FlatTSetTest, RejectsOversizedKey) {
+  core::FlatTSet tset;
+  bn_t alpha;
+  bn_new(alpha);
+  bn_set_dig(alpha, 7);
+
+  EXPECT_THROW(tset.insert(std::string(34, 'x'), std::vector<uint8_t>(), alpha),
+               std::invalid_argument);
+  EXPECT_FALSE(tset.find(std::string(34, 'x')).found());
+
+  bn_free(alpha);
+}
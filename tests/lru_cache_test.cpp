@@ -0,0 +1,58 @@
+#include "core/LruCache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(LruCacheTest, EvictsLeastRecentlyUsedOverBudget) {
+  core::LruCache<std::string, int> cache(30);
+  ASSERT_NE(cache.insert("a", 1, 10), nullptr);
+  ASSERT_NE(cache.insert("b", 2, 10), nullptr);
+  ASSERT_NE(cache.insert("c", 3, 10), nullptr);
+  ASSERT_NE(cache.find("a"), nullptr);  // "b" is now the coldest
+
+  ASSERT_NE(cache.insert("d", 4, 10), nullptr);
+  EXPECT_EQ(cache.size(), 3u);
+  EXPECT_EQ(cache.bytes(), 30u);
+  EXPECT_EQ(cache.find("b"), nullptr);
+  ASSERT_NE(cache.find("a"), nullptr);
+  EXPECT_EQ(*cache.find("d"), 4);
+
+  EXPECT_EQ(cache.stats().hits, 3u);
+  EXPECT_EQ(cache.stats().misses, 1u);
+  EXPECT_EQ(cache.stats().evictions, 1u);
+}
+
+TEST(LruCacheTest, ResizeEvictsOthersAndDropsOversizedEntry) {
+  core::LruCache<std::string, int> cache(30);
+  cache.insert("a", 1, 10);
+  cache.insert("b", 2, 10);
+  cache.insert("c", 3, 10);
+
+  // Growing "c" pushes out the two colder entries, never "c" itself.
+  EXPECT_TRUE(cache.resize("c", 25));
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(cache.bytes(), 25u);
+  EXPECT_EQ(cache.stats().evictions, 2u);
+
+  EXPECT_FALSE(cache.resize("c", 31));
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.bytes(), 0u);
+  EXPECT_FALSE(cache.resize("missing", 1));
+
+  EXPECT_EQ(cache.insert("huge", 9, 31), nullptr);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(LruCacheTest, InsertReplacesExistingKey) {
+  core::LruCache<std::string, int> cache(100);
+  cache.insert("a", 1, 40);
+  cache.insert("a", 2, 15);
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(cache.bytes(), 15u);
+  EXPECT_EQ(*cache.find("a"), 2);
+
+  cache.erase("a");
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.bytes(), 0u);
+}
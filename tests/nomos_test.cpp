@@ -2,10 +2,16 @@
 
 #include <algorithm>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
+#include "core/Primitive.hpp"
+#include "core/QueryPlanner.hpp"
 #include "nomos/Client.hpp"
 #include "nomos/Gatekeeper.hpp"
+#include "nomos/PipelinedSearch.hpp"
 #include "nomos/Server.hpp"
 
 extern "C" {
@@ -291,6 +297,697 @@ TEST_F(NomosTest, UsesLeastFrequentKeywordAsPrimaryTerm) {
   EXPECT_EQ(ids[0], "doc1");
 }
 
+TEST_F(NomosTest, ParallelSearchPreservesSlotOrder) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+
+  Server sequential;
+  sequential.setup(gatekeeper.getKm());
+  Server parallel;
+  parallel.setup(gatekeeper.getKm());
+  parallel.setSearchThreads(4);
+
+  for (int doc_i = 0; doc_i < 120; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    const UpdateMetadata primary = gatekeeper.update(OP_ADD, doc_id, "wide");
+    sequential.update(primary);
+    parallel.update(primary);
+    if (doc_i % 3 == 0) {
+      const UpdateMetadata cross = gatekeeper.update(OP_ADD, doc_id, "narrow");
+      sequential.update(cross);
+      parallel.update(cross);
+    }
+  }
+
+  // Force "wide" to be the s-term so the server walks all 120 slots.
+  std::unordered_map<std::string, int> counts = gatekeeper.getUpdateCounts();
+  counts["narrow"] = 1000;
+  const std::vector<std::string> query = {"wide", "narrow"};
+  const TokenRequest token_request = client.genToken(query, counts);
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const Client::SearchRequest request =
+      client.prepareSearch(token, token_request);
+
+  const std::vector<SearchResultEntry> expected = sequential.search(request);
+  const std::vector<SearchResultEntry> actual = parallel.search(request);
+
+  ASSERT_EQ(actual.size(), expected.size());
+  EXPECT_EQ(expected.size(), 40u);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].j, expected[i].j);
+    EXPECT_EQ(actual[i].sval, expected[i].sval);
+    EXPECT_EQ(actual[i].cnt, expected[i].cnt);
+  }
+  EXPECT_EQ(client.decryptResults(actual, token).size(), 40u);
+}
+
+TEST_F(NomosTest, ThreadedGenTokenMatchesSequential) {
+  std::unordered_map<std::string, int> counts;
+  counts["rare"] = 40;
+  counts["common"] = 90;
+  const std::vector<std::string> query = {"common", "rare"};
+
+  Client sequential;
+  Client threaded;
+  threaded.setHashThreads(4);
+  const TokenRequest expected = sequential.genToken(query, counts);
+  const TokenRequest actual = threaded.genToken(query, counts);
+
+  EXPECT_EQ(actual.query_keywords, expected.query_keywords);
+  ASSERT_EQ(actual.hw1_j_0.size(), 40u);
+  EXPECT_EQ(actual.hw1_j_0, expected.hw1_j_0);
+  EXPECT_EQ(actual.hw1_j_1, expected.hw1_j_1);
+
+  // Spot-check the batch against the scalar hash of "w1|j|b".
+  ep_t point;
+  ep_null(point);
+  ep_new(point);
+  Hash_H1(point, "rare|7|1");
+  EXPECT_EQ(actual.hw1_j_1[6], CompressPoint(point));
+  ep_free(point);
+}
+
+TEST_F(NomosTest, QueryCacheExtendsIncrementally) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client plain;
+  ASSERT_EQ(plain.setup(), 0);
+  Client cached;
+  ASSERT_EQ(cached.setup(), 0);
+  cached.setCacheBudget(1 << 20);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  const std::vector<std::string> query = {"rare", "common"};
+  std::vector<std::string> expected;
+  for (int doc_i = 0; doc_i < 12; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "common"));
+    if (doc_i % 3 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "rare"));
+      expected.push_back(doc_id);
+    }
+
+    // Query after each batch so m = count("rare") grows between queries.
+    if (doc_i % 3 != 2) {
+      continue;
+    }
+    const TokenRequest plain_request =
+        plain.genToken(query, gatekeeper.getUpdateCounts());
+    const TokenRequest cached_request =
+        cached.genToken(query, gatekeeper.getUpdateCounts());
+    EXPECT_EQ(cached_request.hashed_keywords, plain_request.hashed_keywords);
+    EXPECT_EQ(cached_request.hw1_j_0, plain_request.hw1_j_0);
+    EXPECT_EQ(cached_request.hw1_j_1, plain_request.hw1_j_1);
+
+    const SearchToken token = gatekeeper.genToken(cached_request);
+    const Client::SearchRequest plain_search =
+        plain.prepareSearch(token, cached_request);
+    const Client::SearchRequest cached_search =
+        cached.prepareSearch(token, cached_request);
+    EXPECT_EQ(cached_search.xtokenList, plain_search.xtokenList);
+
+    std::vector<std::string> ids =
+        cached.decryptResults(server.search(cached_search), token);
+    std::sort(ids.begin(), ids.end());
+    std::vector<std::string> sorted_expected(expected);
+    std::sort(sorted_expected.begin(), sorted_expected.end());
+    EXPECT_EQ(ids, sorted_expected);
+  }
+
+  // Four rounds with m = 1..4: hw and e_j each reuse 0+1+2+3 positions and
+  // compute the one new position per round. Each round counts "rare" and
+  // "common" in genToken and "rare" in prepareSearch; only the first round
+  // finds nothing cached.
+  const Client::CacheStats stats = cached.cacheStats();
+  EXPECT_EQ(stats.reused_positions, 12u);
+  EXPECT_EQ(stats.computed_positions, 8u);
+  EXPECT_EQ(stats.keyword_misses, 3u);
+  EXPECT_EQ(stats.keyword_hits, 9u);
+  EXPECT_EQ(stats.evictions, 0u);
+  EXPECT_GT(stats.bytes, 0u);
+  EXPECT_EQ(plain.cacheStats().keyword_hits, 0u);
+
+  // A budget too small for any entry degrades to recomputing every query.
+  Client tiny;
+  ASSERT_EQ(tiny.setup(), 0);
+  tiny.setCacheBudget(1);
+  const TokenRequest tiny_request =
+      tiny.genToken(query, gatekeeper.getUpdateCounts());
+  EXPECT_EQ(tiny_request.hw1_j_0,
+            plain.genToken(query, gatekeeper.getUpdateCounts()).hw1_j_0);
+  EXPECT_EQ(tiny.cacheStats().bytes, 0u);
+}
+
+TEST_F(NomosTest, GatekeeperTokenCacheReusesMatchingPrefix) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+
+  std::unordered_map<std::string, int> counts;
+  counts["w"] = 6;
+  const std::vector<std::string> query = {"w"};
+  const TokenRequest short_request = client.genToken(query, counts);
+  counts["w"] = 10;
+  TokenRequest request = client.genToken(query, counts);
+
+  const SearchToken expected = gatekeeper.genToken(request);
+  gatekeeper.setTokenCacheBudget(1 << 20);
+  gatekeeper.genToken(short_request);
+  const SearchToken extended = gatekeeper.genToken(request);
+  EXPECT_EQ(extended.bstag, expected.bstag);
+  EXPECT_EQ(extended.delta, expected.delta);
+
+  core::TokenPrefixCache::Stats stats = gatekeeper.tokenCacheStats();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.reused_positions, 6u);
+  EXPECT_EQ(stats.computed_positions, 10u);
+  EXPECT_GT(stats.bytes, 0u);
+
+  // A request whose points differ from the cached ones is not served from
+  // the cache past the first mismatch.
+  std::swap(request.hw1_j_0[3], request.hw1_j_0[4]);
+  const SearchToken swapped = gatekeeper.genToken(request);
+  EXPECT_EQ(swapped.bstag[3], expected.bstag[4]);
+  EXPECT_EQ(swapped.bstag[4], expected.bstag[3]);
+  EXPECT_EQ(swapped.delta, expected.delta);
+  stats = gatekeeper.tokenCacheStats();
+  EXPECT_EQ(stats.reused_positions, 9u);
+  EXPECT_EQ(stats.computed_positions, 17u);
+
+  // New keys invalidate every cached prefix.
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  EXPECT_EQ(gatekeeper.tokenCacheStats().bytes, 0u);
+  EXPECT_NE(gatekeeper.genToken(request).bstag[0], expected.bstag[0]);
+}
+
+TEST_F(NomosTest, IncrementalSearchMergesNewSlotsIntoSnapshot) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  // The caches are extended by the incremental windows and reused below.
+  client.setCacheBudget(1 << 20);
+  gatekeeper.setTokenCacheBudget(1 << 20);
+
+  const std::string keyword = "crypto";
+  server.update(gatekeeper.update(OP_ADD, "doc1", keyword));
+  server.update(gatekeeper.update(OP_ADD, "doc2", keyword));
+
+  TokenRequest request =
+      client.genIncrementalToken(keyword, gatekeeper.getUpdateCounts());
+  EXPECT_EQ(request.slot_offset, 0);
+  SearchToken token = gatekeeper.genToken(request);
+  std::vector<std::string> ids = client.applyIncrementalResults(
+      request, token, server.search(client.prepareSearch(token, request)));
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, std::vector<std::string>({"doc1", "doc2"}));
+  EXPECT_EQ(client.snapshotUpdateCount(keyword), 2);
+
+  // Only the two new slots are requested and searched.
+  server.update(gatekeeper.update(OP_DEL, "doc1", keyword));
+  server.update(gatekeeper.update(OP_ADD, "doc3", keyword));
+  request = client.genIncrementalToken(keyword, gatekeeper.getUpdateCounts());
+  EXPECT_EQ(request.slot_offset, 2);
+  ASSERT_EQ(request.hw1_j_0.size(), 2u);
+  token = gatekeeper.genToken(request);
+  const Client::SearchRequest search = client.prepareSearch(token, request);
+  EXPECT_EQ(search.stokenList.size(), 2u);
+  const std::vector<SearchResultEntry> results = server.search(search);
+  ASSERT_EQ(results.size(), 2u);
+  EXPECT_EQ(results[0].j, 3);
+  ids = client.applyIncrementalResults(request, token, results);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, std::vector<std::string>({"doc2", "doc3"}));
+
+  // Matches a full search over the whole history.
+  const std::vector<std::string> query = {keyword};
+  const TokenRequest full_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken full_token = gatekeeper.genToken(full_request);
+  std::vector<std::string> full_ids = client.decryptResults(
+      server.search(client.prepareSearch(full_token, full_request)),
+      full_token);
+  std::sort(full_ids.begin(), full_ids.end());
+  EXPECT_EQ(full_ids, ids);
+  EXPECT_EQ(gatekeeper.tokenCacheStats().reused_positions, 4u);
+  EXPECT_EQ(client.cacheStats().computed_positions, 8u);
+
+  // No new updates: nothing to search, snapshot answered locally.
+  request = client.genIncrementalToken(keyword, gatekeeper.getUpdateCounts());
+  EXPECT_EQ(request.slot_offset, 4);
+  EXPECT_TRUE(request.hw1_j_0.empty());
+  ids = client.applyIncrementalResults(request, SearchToken(),
+                                       std::vector<SearchResultEntry>());
+  EXPECT_EQ(ids.size(), 2u);
+
+  // A stale request cannot be merged twice.
+  TokenRequest stale;
+  stale.query_keywords.push_back(keyword);
+  stale.slot_offset = 2;
+  EXPECT_THROW(client.applyIncrementalResults(stale, SearchToken(),
+                                              std::vector<SearchResultEntry>()),
+               std::invalid_argument);
+}
+
+TEST_F(NomosTest, PagedSearchCoversFullResultInPages) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+  server.setSearchThreads(2);
+
+  for (int doc_i = 0; doc_i < 40; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "common"));
+    if (doc_i % 2 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "rare"));
+    }
+  }
+  server.update(gatekeeper.update(OP_ADD, "doc-rare-only", "rare"));
+
+  const std::vector<std::string> query = {"common", "rare"};
+  const TokenRequest full_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken full_token = gatekeeper.genToken(full_request);
+  std::vector<std::string> expected = client.decryptResults(
+      server.search(client.prepareSearch(full_token, full_request)),
+      full_token);
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(expected.size(), 20u);
+
+  // Pages of 8 slots, each stopping after 3 matches.
+  std::vector<std::string> paged;
+  int next_slot = 0;
+  int pages = 0;
+  for (bool done = false; !done; ++pages) {
+    const TokenRequest request =
+        client.genPageToken(query, gatekeeper.getUpdateCounts(), next_slot, 8);
+    ASSERT_EQ(request.query_keywords[0], "rare");
+    ASSERT_EQ(request.slot_offset, next_slot);
+    ASSERT_LE(request.hw1_j_0.size(), 8u);
+    const SearchToken token = gatekeeper.genToken(request);
+    const SearchPage page =
+        server.searchPage(client.prepareSearch(token, request), 3);
+    ASSERT_LE(page.results.size(), 3u);
+    ASSERT_GT(page.next_slot, next_slot);
+    const std::vector<std::string> ids =
+        client.decryptResults(page.results, token);
+    paged.insert(paged.end(), ids.begin(), ids.end());
+    next_slot = page.next_slot;
+    done = next_slot == gatekeeper.getUpdateCount("rare");
+  }
+  std::sort(paged.begin(), paged.end());
+  EXPECT_EQ(paged, expected);
+  EXPECT_EQ(pages, 7);
+
+  // A page past the end is empty.
+  const TokenRequest past_end =
+      client.genPageToken(query, gatekeeper.getUpdateCounts(), 100, 8);
+  EXPECT_EQ(past_end.slot_offset, 21);
+  EXPECT_TRUE(past_end.hw1_j_0.empty());
+  EXPECT_THROW(client.genPageToken(query, gatekeeper.getUpdateCounts(), 0, 0),
+               std::invalid_argument);
+}
+
+TEST_F(NomosTest, PageRequestsPastCachedPrefixAreComputed) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client plain;
+  ASSERT_EQ(plain.setup(), 0);
+  Client cached;
+  ASSERT_EQ(cached.setup(), 0);
+  cached.setCacheBudget(1 << 20);
+
+  std::unordered_map<std::string, int> counts;
+  counts["w"] = 20;
+  const std::vector<std::string> query = {"w"};
+  const TokenRequest full_request = plain.genToken(query, counts);
+  const SearchToken full_token = gatekeeper.genToken(full_request);
+  gatekeeper.setTokenCacheBudget(1 << 20);
+
+  // The first page leaves an empty cache entry for w (no slot points).
+  const TokenRequest empty_page = cached.genPageToken(query, counts, 20, 4);
+  EXPECT_TRUE(empty_page.hw1_j_0.empty());
+  TokenRequest request = cached.genPageToken(query, counts, 12, 4);
+  ASSERT_EQ(request.hw1_j_0.size(), 4u);
+  EXPECT_EQ(request.hw1_j_0[0], full_request.hw1_j_0[12]);
+  EXPECT_EQ(request.hw1_j_1[3], full_request.hw1_j_1[15]);
+
+  // Now 4 slots are cached on both sides, and a page at 12 starts past them.
+  const TokenRequest first_page = cached.genPageToken(query, counts, 0, 4);
+  EXPECT_EQ(first_page.hw1_j_0[3], full_request.hw1_j_0[3]);
+  gatekeeper.genToken(first_page);
+  request = cached.genPageToken(query, counts, 12, 4);
+  ASSERT_EQ(request.hw1_j_0.size(), 4u);
+  EXPECT_EQ(request.hw1_j_0[0], full_request.hw1_j_0[12]);
+
+  const SearchToken token = gatekeeper.genToken(request);
+  ASSERT_EQ(token.bstag.size(), 4u);
+  EXPECT_EQ(token.bstag[0], full_token.bstag[12]);
+  EXPECT_EQ(token.delta[3], full_token.delta[15]);
+  EXPECT_EQ(gatekeeper.tokenCacheStats().reused_positions, 0u);
+}
+
+TEST_F(NomosTest, SearchStreamDeliversMatchesInOrder) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+  server.setSearchThreads(3);
+
+  for (int doc_i = 0; doc_i < 150; ++doc_i) {
+    server.update(
+        gatekeeper.update(OP_ADD, "doc" + std::to_string(doc_i), "wide"));
+  }
+  server.update(gatekeeper.update(OP_DEL, "doc7", "wide"));
+
+  const std::vector<std::string> query = {"wide"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const Client::SearchRequest request =
+      client.prepareSearch(token, token_request);
+  const std::vector<SearchResultEntry> expected = server.search(request);
+
+  ResultDecryptor decryptor(token);
+  std::vector<int> slots;
+  const size_t delivered =
+      server.searchStream(request, [&](const SearchResultRef& ref) {
+        slots.push_back(ref.j);
+        EXPECT_TRUE(decryptor.add(ref));
+        return true;
+      });
+  ASSERT_EQ(delivered, expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(slots[i], expected[i].j);
+  }
+  std::vector<std::string> streamed = decryptor.ids();
+  std::vector<std::string> collected = client.decryptResults(expected, token);
+  std::sort(streamed.begin(), streamed.end());
+  std::sort(collected.begin(), collected.end());
+  EXPECT_EQ(streamed, collected);
+  EXPECT_EQ(streamed.size(), 149u);
+
+  // The consumer can stop the scan.
+  size_t seen = 0;
+  EXPECT_EQ(server.searchStream(request,
+                                [&](const SearchResultRef&) {
+                                  return ++seen < 5;
+                                }),
+            5u);
+}
+
+TEST_F(NomosTest, ResultDecryptorRejectsMalformedOp) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+  server.update(gatekeeper.update(OP_ADD, "doc1", "w"));
+
+  const std::vector<std::string> query = {"w"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const std::vector<SearchResultEntry> results =
+      server.search(client.prepareSearch(token, token_request));
+  ASSERT_EQ(results.size(), 1u);
+
+  // sval decrypts to "doc1|0"; rewrite the op digit in place.
+  SearchResultEntry garbage = results[0];
+  garbage.sval.back() ^= '0' ^ 'x';
+  SearchResultEntry unknown_op = results[0];
+  unknown_op.sval.back() ^= '0' ^ '7';
+  SearchResultEntry no_op = results[0];
+  no_op.sval.pop_back();
+
+  ResultDecryptor decryptor(token);
+  EXPECT_FALSE(decryptor.add(garbage));
+  EXPECT_FALSE(decryptor.add(unknown_op));
+  EXPECT_FALSE(decryptor.add(no_op));
+  EXPECT_TRUE(decryptor.ids().empty());
+  EXPECT_TRUE(decryptor.add(results[0]));
+  EXPECT_EQ(decryptor.ids(), std::vector<std::string>({"doc1"}));
+}
+
+TEST_F(NomosTest, PipelinedSearchMatchesSequentialSearch) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  for (int doc_i = 0; doc_i < 90; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "left"));
+    if (doc_i % 3 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "right"));
+    }
+  }
+  server.update(gatekeeper.update(OP_DEL, "doc3", "right"));
+
+  const std::vector<std::string> query = {"left", "right"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  std::vector<std::string> expected = client.decryptResults(
+      server.search(client.prepareSearch(token, token_request)), token);
+  std::sort(expected.begin(), expected.end());
+  ASSERT_FALSE(expected.empty());
+
+  PipelinedSearch pipeline(&client, &gatekeeper, &server);
+  pipeline.setChunkSlots(7);
+  PipelinedSearch::Stats stats;
+  std::vector<std::string> ids = pipeline.run(query, &stats);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, expected);
+  EXPECT_EQ(stats.chunks, 5u);  // 31 slots of "right" in chunks of 7
+  EXPECT_GT(stats.latency_ms, 0.0);
+  EXPECT_LE(stats.first_chunk_ms, stats.latency_ms);
+  for (int stage = 0; stage < PipelinedSearch::kStageCount; ++stage) {
+    const double occupancy =
+        stats.occupancy(static_cast<PipelinedSearch::Stage>(stage));
+    EXPECT_GT(occupancy, 0.0);
+    EXPECT_LE(occupancy, 1.0);
+  }
+
+  EXPECT_TRUE(pipeline.run({"left", "absent"}).empty());
+  EXPECT_THROW(pipeline.setChunkSlots(0), std::invalid_argument);
+}
+
+TEST_F(NomosTest, XTermOrderKeepsConjunctionResults) {
+  const std::unordered_map<std::string, int> counts = {
+      {"a", 40}, {"b", 5}, {"c", 30}, {"d", 10}, {"e", 10}};
+  std::vector<std::string> planned = {"a", "b", "c", "d", "e"};
+  core::PlanQuery(&planned, counts, core::XTermOrder::kAscendingCount);
+  EXPECT_EQ(planned, (std::vector<std::string>{"b", "d", "e", "c", "a"}));
+  std::vector<std::string> input = {"a", "b", "c", "d", "e"};
+  core::PlanQuery(&input, counts, core::XTermOrder::kInput);
+  EXPECT_EQ(input, (std::vector<std::string>{"b", "a", "c", "d", "e"}));
+
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  // "rare" is the s-term; "narrow" is the most selective x-term.
+  for (int doc_i = 0; doc_i < 48; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "wide"));
+    if (doc_i % 2 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "half"));
+    }
+    if (doc_i % 3 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "rare"));
+    }
+    if (doc_i % 4 == 0 || doc_i % 5 == 1) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "narrow"));
+    }
+  }
+
+  const std::vector<std::string> query = {"wide", "half", "narrow", "rare"};
+  std::vector<std::vector<std::string>> results;
+  const core::XTermOrder orders[] = {core::XTermOrder::kInput,
+                                     core::XTermOrder::kAscendingCount};
+  for (core::XTermOrder order : orders) {
+    client.setXTermOrder(order);
+    const TokenRequest token_request =
+        client.genToken(query, gatekeeper.getUpdateCounts());
+    ASSERT_EQ(token_request.query_keywords[0], "rare");
+    const SearchToken token = gatekeeper.genToken(token_request);
+    EXPECT_EQ(token.bxtrap.size(), query.size() - 1);
+    std::vector<std::string> ids = client.decryptResults(
+        server.search(client.prepareSearch(token, token_request)), token);
+    std::sort(ids.begin(), ids.end());
+    results.push_back(ids);
+  }
+  EXPECT_EQ(results[0], (std::vector<std::string>{"doc0", "doc12", "doc24",
+                                                   "doc36", "doc6"}));
+  EXPECT_EQ(results[1], results[0]);
+}
+
+TEST_F(NomosTest, UpdateBatchAssignsCountersInInputOrder) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  gatekeeper.setUpdateThreads(4);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  std::vector<UpdateRequest> requests;
+  for (int doc_i = 0; doc_i < 60; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    requests.push_back(UpdateRequest(OP_ADD, doc_id, "wide"));
+    if (doc_i % 4 == 0) {
+      requests.push_back(UpdateRequest(OP_ADD, doc_id, "narrow"));
+    }
+  }
+  requests.push_back(UpdateRequest(OP_DEL, "doc0", "narrow"));
+
+  const std::vector<UpdateMetadata> metas = gatekeeper.updateBatch(requests);
+  ASSERT_EQ(metas.size(), requests.size());
+  EXPECT_EQ(gatekeeper.getUpdateCount("wide"), 60);
+  EXPECT_EQ(gatekeeper.getUpdateCount("narrow"), 16);
+  server.updateBatch(metas);
+
+  const std::vector<std::string> narrow_query = {"narrow"};
+  const TokenRequest narrow_request =
+      client.genToken(narrow_query, gatekeeper.getUpdateCounts());
+  const SearchToken narrow_token = gatekeeper.genToken(narrow_request);
+  std::vector<std::string> narrow_ids = client.decryptResults(
+      server.search(client.prepareSearch(narrow_token, narrow_request)),
+      narrow_token);
+  EXPECT_EQ(narrow_ids.size(), 14u);
+  EXPECT_TRUE(std::find(narrow_ids.begin(), narrow_ids.end(), "doc0") ==
+              narrow_ids.end());
+
+  const std::vector<std::string> query = {"narrow", "wide"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const Client::SearchRequest request =
+      client.prepareSearch(token, token_request);
+  std::vector<std::string> ids =
+      client.decryptResults(server.search(request), token);
+
+  EXPECT_GE(ids.size(), 14u);
+  EXPECT_TRUE(std::find(ids.begin(), ids.end(), "doc4") != ids.end());
+  EXPECT_TRUE(std::find(ids.begin(), ids.end(), "doc56") != ids.end());
+  EXPECT_TRUE(std::find(ids.begin(), ids.end(), "doc5") == ids.end());
+}
+
+TEST_F(NomosTest, ConfigurableEllAndKFlowIntoTokens) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10, 5, 4), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+
+  const UpdateMetadata first = gatekeeper.update(OP_ADD, "doc1", "crypto");
+  ASSERT_EQ(first.xtags.size(), 5u);
+
+  // Incremental derivation must agree with xtag_i = i * xtag_1.
+  ep_t xtag_1;
+  ep_t expected;
+  ep_null(xtag_1);
+  ep_null(expected);
+  ep_new(xtag_1);
+  ep_new(expected);
+  DeserializePoint(xtag_1, first.xtags[0]);
+  for (size_t i = 1; i < first.xtags.size(); ++i) {
+    bn_t scalar;
+    bn_null(scalar);
+    bn_new(scalar);
+    bn_set_dig(scalar, static_cast<dig_t>(i + 1));
+    ep_mul(expected, xtag_1, scalar);
+    EXPECT_EQ(CompressPoint(expected), first.xtags[i]) << "xtag " << i + 1;
+    bn_free(scalar);
+  }
+  ep_free(expected);
+  ep_free(xtag_1);
+
+  server.update(first);
+  server.update(gatekeeper.update(OP_ADD, "doc1", "security"));
+  server.update(gatekeeper.update(OP_ADD, "doc2", "security"));
+
+  const std::vector<std::string> query = {"crypto", "security"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  ASSERT_EQ(token.bxtrap.size(), 1u);
+  EXPECT_EQ(token.bxtrap[0].size(), 4u);
+
+  const Client::SearchRequest request =
+      client.prepareSearch(token, token_request);
+  const std::vector<std::string> ids =
+      client.decryptResults(server.search(request), token);
+  ASSERT_EQ(ids.size(), 1u);
+  EXPECT_EQ(ids[0], "doc1");
+}
+
+TEST_F(NomosTest, SetupRejectsInvalidEllAndK) {
+  Gatekeeper gatekeeper;
+  EXPECT_THROW(gatekeeper.setup(10, 0, 1), std::invalid_argument);
+  EXPECT_THROW(gatekeeper.setup(10, 256, 2), std::invalid_argument);
+  EXPECT_THROW(gatekeeper.setup(10, 3, 4), std::invalid_argument);
+  EXPECT_THROW(gatekeeper.setup(10, 3, 0), std::invalid_argument);
+}
+
+TEST_F(NomosTest, SearchOnPlainPrimeOrderCurve) {
+  try {
+    UseCurve(Curve::Secp256k1);
+  } catch (const std::runtime_error&) {
+    UseCurve(Curve::Pairing);
+    GTEST_SKIP() << "secp256k1 not built into RELIC";
+  }
+
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10), 0);
+  Client client;
+  ASSERT_EQ(client.setup(), 0);
+  Server server;
+  server.setup(gatekeeper.getKm());
+  server.setSearchThreads(2);
+
+  for (int doc_i = 0; doc_i < 20; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "crypto"));
+    if (doc_i % 2 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "security"));
+    }
+  }
+
+  const std::vector<std::string> query = {"crypto", "security"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const Client::SearchRequest request =
+      client.prepareSearch(token, token_request);
+  const std::vector<std::string> ids =
+      client.decryptResults(server.search(request), token);
+  UseCurve(Curve::Pairing);
+
+  EXPECT_EQ(ids.size(), 10u);
+}
+
 TEST_F(NomosTest, LargeScale1000Updates) {
   // Paper: Algorithm 3 – Search (Section 4.3).
   // 200 docs × 5 keyword tiers = 1000 insertions. Keyword update counts:
@@ -2,6 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/RelicContext.hpp"
+#include "core/ScalarField.hpp"
+
 extern "C" {
 #include <relic/relic.h>
 }
@@ -173,3 +180,186 @@ TEST_F(PrimitiveTest, HashH1DifferentInputsProduceDifferentPoints) {
   ep_free(p1);
   ep_free(p2);
 }
+
+TEST_F(PrimitiveTest, FixedBasePointMatchesVariableBaseMul) {
+  ep_t base;
+  ep_t expected;
+  ep_t actual;
+  bn_t k;
+  ep_null(base);
+  ep_null(expected);
+  ep_null(actual);
+  ep_new(base);
+  ep_new(expected);
+  ep_new(actual);
+  bn_new(k);
+
+  Hash_H1(base, "fixed-base-input");
+  const FixedBasePoint from_point(base);
+  const FixedBasePoint from_bytes(SerializePoint(base));
+
+  for (int i = 0; i < 4; ++i) {
+    Hash_Zn(k, "fixed-base-scalar-" + std::to_string(i));
+    ep_mul(expected, base, k);
+
+    from_point.mul(actual, k);
+    EXPECT_EQ(ep_cmp(actual, expected), RLC_EQ);
+
+    from_bytes.mul(actual, k);
+    EXPECT_EQ(ep_cmp(actual, expected), RLC_EQ);
+  }
+
+  bn_free(k);
+  ep_free(actual);
+  ep_free(expected);
+  ep_free(base);
+}
+
+TEST_F(PrimitiveTest, CompressedPointMatchesStringEncoding) {
+  ep_t p;
+  ep_t q;
+  ep_null(p);
+  ep_null(q);
+  ep_new(p);
+  ep_new(q);
+
+  Hash_H1(p, "compressed-point");
+  const core::CompressedPoint compressed = CompressPoint(p);
+  EXPECT_EQ(compressed.str(), SerializePoint(p));
+
+  DeserializePoint(q, compressed);
+  EXPECT_EQ(ep_cmp(p, q), RLC_EQ);
+
+  core::CompressedPoint copy;
+  SerializePoint(q, &copy);
+  EXPECT_TRUE(copy == compressed);
+  EXPECT_EQ(core::CompressedPointHash()(copy),
+            core::CompressedPointHash()(compressed));
+
+  Hash_H1(q, "other-point");
+  EXPECT_TRUE(CompressPoint(q) != compressed);
+
+  // Infinity is all zeros and decodes back to infinity.
+  ep_set_infty(q);
+  const core::CompressedPoint infinity = CompressPoint(q);
+  for (size_t i = 0; i < core::CompressedPoint::kBytes; ++i) {
+    EXPECT_EQ(infinity.bytes[i], 0);
+  }
+  DeserializePoint(p, infinity);
+  EXPECT_TRUE(ep_is_infty(p));
+
+  ep_free(q);
+  ep_free(p);
+}
+
+TEST_F(PrimitiveTest, SerializePointsMatchesPerPointEncoding) {
+  const size_t count = 6;
+  PointBuffer points(count);
+  Hash_H1(points[0], "batch-base");
+  for (size_t i = 1; i < count; ++i) {
+    ep_add(points[i], points[i - 1], points[0]);  // left projective
+  }
+
+  std::vector<std::string> expected(count);
+  for (size_t i = 0; i < count; ++i) {
+    expected[i] = SerializePoint(points[i]);
+  }
+  std::vector<core::CompressedPoint> encoded(count);
+  SerializePoints(points.data(), count, encoded.data());
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(encoded[i].str(), expected[i]) << "point " << i;
+  }
+
+  // A point at infinity falls back to per-point normalization.
+  ep_set_infty(points[2]);
+  for (size_t i = 3; i < count; ++i) {
+    ep_add(points[i], points[i - 1], points[0]);
+  }
+  SerializePoints(points.data(), count, encoded.data());
+  EXPECT_EQ(encoded[1].str(), expected[1]);
+  EXPECT_EQ(encoded[2].bytes[0], 0);
+  EXPECT_EQ(encoded[3].str(), expected[0]);
+}
+
+TEST_F(PrimitiveTest, HashH1BatchMatchesHashH1) {
+  const size_t count = 70;
+  PointBuffer sequential(count);
+  PointBuffer pooled(count);
+  core::WorkerPool pool(4);
+  Hash_H1_Batch(sequential.data(), "batch-keyword", 5, count, 1);
+  Hash_H1_Batch(pooled.data(), "batch-keyword", 5, count, 1, &pool);
+
+  ep_t expected;
+  ep_null(expected);
+  ep_new(expected);
+  for (size_t i = 0; i < count; ++i) {
+    Hash_H1(expected, "batch-keyword|" + std::to_string(5 + i) + "|1");
+    EXPECT_EQ(ep_cmp(sequential[i], expected), RLC_EQ) << "input " << i;
+    EXPECT_EQ(ep_cmp(pooled[i], expected), RLC_EQ) << "input " << i;
+  }
+  ep_free(expected);
+}
+
+TEST_F(PrimitiveTest, KeyedPrfMatchesOneShotPrf) {
+  const std::string keys[] = {"", "short-key", std::string(100, 'k')};
+  const std::vector<std::string> inputs = {"", "w1|1", "w1|2",
+                                           std::string(200, 'x')};
+  bn_t expected;
+  bn_t actual;
+  bn_new(expected);
+  bn_new(actual);
+  for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); ++k) {
+    const KeyedPrf prf(keys[k]);
+    core::ScalarBuffer batch(inputs.size());
+    prf.F_p_Batch(batch.data(), inputs);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(prf.F(inputs[i]), F(keys[k], inputs[i]));
+      F_p(expected, keys[k], inputs[i]);
+      prf.F_p(actual, inputs[i]);
+      EXPECT_EQ(bn_cmp(actual, expected), RLC_EQ);
+      EXPECT_EQ(bn_cmp(batch[i], expected), RLC_EQ);
+    }
+  }
+
+  bn_t key;
+  bn_new(key);
+  Hash_Zn(key, "scalar-key");
+  const KeyedPrf scalar_prf(key);
+  EXPECT_EQ(scalar_prf.F("in"), F(key, "in"));
+
+  bn_free(key);
+  bn_free(actual);
+  bn_free(expected);
+}
+
+TEST_F(PrimitiveTest, ParseCurveRoundTripsNames) {
+  const Curve curves[] = {Curve::Pairing, Curve::Secp256k1, Curve::P256};
+  for (size_t i = 0; i < sizeof(curves) / sizeof(curves[0]); ++i) {
+    EXPECT_EQ(ParseCurve(CurveName(curves[i])), curves[i]);
+  }
+  EXPECT_THROW(ParseCurve("ed25519"), std::invalid_argument);
+}
+
+TEST_F(PrimitiveTest, PlainCurvesKeepSerializationSizes) {
+  const Curve curves[] = {Curve::Secp256k1, Curve::P256};
+  for (size_t i = 0; i < sizeof(curves) / sizeof(curves[0]); ++i) {
+    try {
+      UseCurve(curves[i]);
+    } catch (const std::runtime_error&) {
+      UseCurve(Curve::Pairing);
+      GTEST_SKIP() << CurveName(curves[i]) << " not built into RELIC";
+    }
+    EXPECT_EQ(DefaultCurve(), curves[i]);
+    EXPECT_EQ(PointBytes(), 33u);
+    EXPECT_EQ(ScalarBytes(), 32u);
+
+    ep_t p;
+    ep_null(p);
+    ep_new(p);
+    Hash_H1(p, "curve-switch");
+    EXPECT_EQ(SerializePoint(p).size(), PointBytes());
+    ep_free(p);
+  }
+  UseCurve(Curve::Pairing);
+  EXPECT_EQ(DefaultCurve(), Curve::Pairing);
+}
@@ -213,3 +213,137 @@ TEST_F(QTreeTest, PositiveProofDiffersForDifferentAddressSets) {
 
   EXPECT_NE(proof_a, proof_b);
 }
+
+namespace {
+
+std::string toHex(const std::string& bytes) {
+  std::string hex;
+  const char* digits = "0123456789abcdef";
+  for (unsigned char c : bytes) {
+    hex.push_back(digits[c >> 4]);
+    hex.push_back(digits[c & 0xf]);
+  }
+  return hex;
+}
+
+}  // namespace
+
+TEST_F(QTreeTest, RootHashMatchesReferenceEncoding) {
+  // SHA-256 over 0x00||bit leaves and 0x01||left||right nodes.
+  QTree tree(4);
+  tree.initialize({true, false, true, false});
+  EXPECT_EQ(toHex(tree.getRootHash()),
+            "d1a739c66bc4fc26c2b34fe1abedc503253cd82e3bce19fddfa00ec800823219");
+}
+
+TEST_F(QTreeTest, EmptyTreeUsesZeroSubtreeDigests) {
+  QTree tree(1u << 20);
+  tree.initialize({});
+  EXPECT_EQ(toHex(tree.getRootHash()),
+            "b9132926ee9aadc5858d8a205c33bb3a2bd9b193e3d0eda00965d92a820c4431");
+
+  const std::string empty_root = tree.getRootHash();
+  tree.updateBits({"zero_a", "zero_b"}, true);
+  ASSERT_NE(tree.getRootHash(), empty_root);
+  EXPECT_TRUE(tree.verifyPath("zero_a", true, tree.generateProof("zero_a"),
+                              tree.getRootHash()));
+  EXPECT_TRUE(tree.verifyPath("zero_c", false, tree.generateProof("zero_c"),
+                              tree.getRootHash()));
+  tree.updateBits({"zero_a", "zero_b"}, false);
+  EXPECT_EQ(tree.getRootHash(), empty_root);
+}
+
+TEST_F(QTreeTest, ParallelInitializeMatchesSequential) {
+  std::vector<bool> bits(4096, false);
+  for (size_t i = 0; i < bits.size(); i += 3) {
+    bits[i] = true;
+  }
+
+  QTree sequential(4096);
+  sequential.initialize(bits);
+  QTree parallel(4096);
+  parallel.setHashThreads(4);
+  parallel.initialize(bits);
+  EXPECT_EQ(parallel.getRootHash(), sequential.getRootHash());
+}
+
+TEST_F(QTreeTest, VerifyPathRejectsMalformedProof) {
+  QTree tree(16);
+  tree.initialize({});
+  tree.updateBits({"addr_a", "addr_b", "addr_c"}, true);
+
+  std::vector<std::string> proof = tree.generateProof("addr_b");
+  ASSERT_EQ(proof.size(), 4u);
+  ASSERT_TRUE(tree.verifyPath("addr_b", true, proof, tree.getRootHash()));
+
+  std::vector<std::string> truncated(proof.begin(), proof.end() - 1);
+  EXPECT_FALSE(tree.verifyPath("addr_b", true, truncated, tree.getRootHash()));
+
+  proof[2].resize(31);
+  EXPECT_FALSE(tree.verifyPath("addr_b", true, proof, tree.getRootHash()));
+}
+
+TEST_F(QTreeTest, BatchUpdateMatchesPerAddressUpdates) {
+  std::vector<std::string> addresses;
+  for (int i = 0; i < 300; ++i) {
+    addresses.push_back("batch_addr_" + std::to_string(i));
+  }
+
+  QTree one_by_one(256);
+  one_by_one.initialize({});
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    one_by_one.updateBit(addresses[i], true);
+  }
+
+  QTree batched(256);
+  batched.setHashThreads(4);
+  batched.initialize({});
+  batched.updateBits(addresses, true);
+
+  EXPECT_EQ(batched.getVersion(), 2u);
+  EXPECT_EQ(batched.getRootHash(), one_by_one.getRootHash());
+  for (size_t i = 0; i < addresses.size(); i += 37) {
+    EXPECT_TRUE(batched.verifyPath(addresses[i], true,
+                                   batched.generateProof(addresses[i]),
+                                   batched.getRootHash()));
+  }
+
+  batched.updateBits({addresses[0], addresses[1]}, false);
+  EXPECT_FALSE(batched.getBit(addresses[0]));
+  EXPECT_EQ(batched.getVersion(), 3u);
+}
+
+TEST_F(QTreeTest, MultiProofSendsSharedSiblingsOnce) {
+  QTree tree(1024);
+  tree.initialize({});
+  std::vector<std::string> addresses;
+  for (int i = 0; i < 64; ++i) {
+    addresses.push_back("multi_addr_" + std::to_string(i));
+  }
+  tree.updateBits(addresses, true);
+
+  const std::string proof = tree.generateMultiProof(addresses);
+  const std::string root = tree.getRootHash();
+  const std::vector<bool> set(addresses.size(), true);
+  EXPECT_TRUE(tree.verifyMultiProof(addresses, set, proof, root));
+  // 64 separate paths would carry 64 * 10 siblings.
+  EXPECT_LT(proof.size(), 4u + 64u * 10u * 32u / 2u);
+
+  std::vector<bool> one_unset = set;
+  one_unset[5] = false;
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, one_unset, proof, root));
+
+  std::vector<std::string> fewer(addresses.begin(), addresses.end() - 1);
+  EXPECT_FALSE(tree.verifyMultiProof(
+      fewer, std::vector<bool>(fewer.size(), true), proof, root));
+
+  std::string tampered = proof;
+  tampered[tampered.size() - 1] ^= 1;
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, set, tampered, root));
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, set,
+                                     proof.substr(0, proof.size() - 32), root));
+
+  const std::vector<std::string> mixed = {"multi_addr_3", "never_set"};
+  EXPECT_TRUE(tree.verifyMultiProof(mixed, {true, false},
+                                    tree.generateMultiProof(mixed), root));
+}
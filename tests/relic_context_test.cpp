@@ -0,0 +1,135 @@
+#include "core/RelicContext.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/Primitive.hpp"
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+class RelicContextTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (core_get() == NULL) {
+      if (core_init() != RLC_OK) {
+        FAIL() << "Failed to initialize RELIC";
+      }
+      if (pc_param_set_any() != RLC_OK) {
+        core_clean();
+        FAIL() << "Failed to set pairing parameters";
+      }
+    }
+  }
+};
+
+TEST_F(RelicContextTest, ScopedContextIsNoOpWhenThreadAlreadyOwnsOne) {
+  ctx_t* before = core_get();
+  {
+    core::ScopedRelicContext scope(ep_param_get());
+    EXPECT_FALSE(scope.ownsContext());
+    EXPECT_EQ(core_get(), before);
+  }
+  EXPECT_EQ(core_get(), before);
+}
+
+TEST_F(RelicContextTest, SingleThreadPoolRunsEveryChunkInline) {
+  core::WorkerPool pool(1);
+  EXPECT_EQ(pool.concurrency(), 1u);
+
+  std::vector<int> hits(37, 0);
+  pool.parallelFor(hits.size(), 5, [&hits](size_t begin, size_t end) {
+    EXPECT_LE(end - begin, 5u);
+    for (size_t i = begin; i < end; ++i) {
+      ++hits[i];
+    }
+  });
+
+  for (int h : hits) {
+    EXPECT_EQ(h, 1);
+  }
+}
+
+TEST_F(RelicContextTest, ParallelForCoversEachIndexExactlyOnce) {
+  core::WorkerPool pool(4);
+
+  std::vector<std::atomic<int>> hits(1000);
+  for (auto& h : hits) {
+    h.store(0);
+  }
+  pool.parallelFor(hits.size(), 7, [&hits](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      hits[i].fetch_add(1);
+    }
+  });
+
+  for (const auto& h : hits) {
+    EXPECT_EQ(h.load(), 1);
+  }
+}
+
+TEST_F(RelicContextTest, WorkersSeeCallerCurveParameters) {
+  core::WorkerPool pool(4);
+
+  const size_t n = 64;
+  std::vector<std::string> expected(n);
+  for (size_t i = 0; i < n; ++i) {
+    ep_t p;
+    ep_null(p);
+    ep_new(p);
+    Hash_H1(p, "ctx-" + std::to_string(i));
+    expected[i] = SerializePoint(p);
+    ep_free(p);
+  }
+
+  std::vector<std::string> actual(n);
+  pool.parallelFor(n, 1, [&actual](size_t begin, size_t end) {
+    ASSERT_NE(core_get(), nullptr);
+    for (size_t i = begin; i < end; ++i) {
+      ep_t p;
+      ep_null(p);
+      ep_new(p);
+      Hash_H1(p, "ctx-" + std::to_string(i));
+      actual[i] = SerializePoint(p);
+      ep_free(p);
+    }
+  });
+
+  EXPECT_EQ(actual, expected);
+}
+
+TEST_F(RelicContextTest, ExceptionFromBodyIsRethrownOnCaller) {
+  core::WorkerPool pool(3);
+
+  EXPECT_THROW(pool.parallelFor(100, 1,
+                                [](size_t begin, size_t) {
+                                  if (begin == 42) {
+                                    throw std::runtime_error("boom");
+                                  }
+                                }),
+               std::runtime_error);
+
+  // The pool must remain usable after a failed job.
+  std::atomic<size_t> total(0);
+  pool.parallelFor(10, 1, [&total](size_t begin, size_t end) {
+    total.fetch_add(end - begin);
+  });
+  EXPECT_EQ(total.load(), 10u);
+}
+
+TEST_F(RelicContextTest, NestedParallelForRunsInline) {
+  core::WorkerPool pool(2);
+
+  std::atomic<size_t> total(0);
+  pool.parallelFor(4, 1, [&pool, &total](size_t, size_t) {
+    pool.parallelFor(8, 2, [&total](size_t begin, size_t end) {
+      total.fetch_add(end - begin);
+    });
+  });
+  EXPECT_EQ(total.load(), 32u);
+}
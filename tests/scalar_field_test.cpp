@@ -0,0 +1,83 @@
+#include "core/ScalarField.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+class ScalarFieldTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (core_get() == NULL) {
+      if (core_init() != RLC_OK) {
+        FAIL() << "Failed to initialize RELIC";
+      }
+      if (pc_param_set_any() != RLC_OK) {
+        core_clean();
+        FAIL() << "Failed to set pairing parameters";
+      }
+    }
+  }
+};
+
+TEST_F(ScalarFieldTest, CachesCurveOrder) {
+  core::ScalarField field;
+  bn_t ord;
+  bn_null(ord);
+  bn_new(ord);
+  ep_curve_get_ord(ord);
+  EXPECT_EQ(bn_cmp(field.order(), ord), RLC_EQ);
+  bn_free(ord);
+}
+
+TEST_F(ScalarFieldTest, BatchInvertMatchesSingleInversion) {
+  core::ScalarField field;
+  const size_t count = 37;
+  core::ScalarBuffer values(count);
+  core::ScalarBuffer expected(count);
+  for (size_t i = 0; i < count; ++i) {
+    bn_rand_mod(values[i], field.order());
+    if (bn_is_zero(values[i])) {
+      bn_set_dig(values[i], 1);
+    }
+    field.inv(expected[i], values[i]);
+  }
+
+  field.batchInvert(values.data(), values.size());
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(bn_cmp(values[i], expected[i]), RLC_EQ) << "index " << i;
+  }
+}
+
+TEST_F(ScalarFieldTest, BatchInvertSingleValueAndEmptyBatch) {
+  core::ScalarField field;
+  core::ScalarBuffer one(1);
+  bn_set_dig(one[0], 2);
+
+  bn_t expected;
+  bn_null(expected);
+  bn_new(expected);
+  field.inv(expected, one[0]);
+
+  field.batchInvert(one.data(), one.size());
+  EXPECT_EQ(bn_cmp(one[0], expected), RLC_EQ);
+  EXPECT_NO_THROW(field.batchInvert(one.data(), 0));
+  bn_free(expected);
+}
+
+TEST_F(ScalarFieldTest, BatchInvertRejectsZeroWithoutModifyingInput) {
+  core::ScalarField field;
+  core::ScalarBuffer values(3);
+  bn_set_dig(values[0], 3);
+  bn_zero(values[1]);
+  bn_set_dig(values[2], 5);
+
+  EXPECT_THROW(field.batchInvert(values.data(), values.size()),
+               std::invalid_argument);
+  EXPECT_EQ(bn_cmp_dig(values[0], 3), RLC_EQ);
+  EXPECT_EQ(bn_cmp_dig(values[2], 5), RLC_EQ);
+  EXPECT_THROW(field.inv(values[0], values[1]), std::invalid_argument);
+}
@@ -0,0 +1,181 @@
+#include "verifiable/SparseQTree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <relic/relic.h>
+}
+
+using namespace verifiable;
+
+class SparseQTreeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (core_get() == NULL) {
+      if (core_init() != RLC_OK) {
+        FAIL() << "Failed to initialize RELIC";
+      }
+      if (pc_param_set_any() != RLC_OK) {
+        core_clean();
+        FAIL() << "Failed to set pairing parameters";
+      }
+    }
+  }
+};
+
+namespace {
+
+std::vector<std::string> Addresses(const std::string& prefix, int count) {
+  std::vector<std::string> addresses;
+  for (int i = 0; i < count; ++i) {
+    addresses.push_back(prefix + std::to_string(i));
+  }
+  return addresses;
+}
+
+}  // namespace
+
+TEST_F(SparseQTreeTest, EmptyTreeHasZeroRoot) {
+  SparseQTree tree;
+  EXPECT_EQ(tree.getRootHash(), "");
+  EXPECT_EQ(tree.getVersion(), 0u);
+
+  tree.initialize({});
+  EXPECT_EQ(tree.getRootHash(), std::string(32, '\0'));
+  EXPECT_EQ(tree.getVersion(), 1u);
+  EXPECT_FALSE(tree.getBit("missing"));
+  EXPECT_TRUE(tree.verifyPath("missing", false, tree.generateProof("missing"),
+                              tree.getRootHash()));
+  EXPECT_THROW(tree.initialize({false, true}), std::invalid_argument);
+}
+
+TEST_F(SparseQTreeTest, MembershipAndNonMembershipProofsVerify) {
+  SparseQTree tree;
+  tree.initialize({});
+  const std::vector<std::string> set = Addresses("member_", 200);
+  tree.updateBits(set, true);
+  EXPECT_EQ(tree.size(), 200u);
+  EXPECT_EQ(tree.getVersion(), 2u);
+
+  const std::string root = tree.getRootHash();
+  for (size_t i = 0; i < set.size(); i += 13) {
+    const std::vector<std::string> proof = tree.generateProof(set[i]);
+    EXPECT_TRUE(tree.getBit(set[i]));
+    EXPECT_TRUE(tree.verifyPath(set[i], true, proof, root));
+    EXPECT_FALSE(tree.verifyPath(set[i], false, proof, root));
+  }
+
+  // Absent addresses end either in an empty subtree or in another key's
+  // leaf; both kinds must prove the bit unset and nothing else.
+  const std::vector<std::string> absent = Addresses("absent_", 50);
+  bool saw_empty = false;
+  bool saw_other = false;
+  for (size_t i = 0; i < absent.size(); ++i) {
+    const std::vector<std::string> proof = tree.generateProof(absent[i]);
+    saw_empty = saw_empty || proof[0] == std::string(1, '\x00');
+    saw_other = saw_other || proof[0][0] == '\x02';
+    EXPECT_FALSE(tree.getBit(absent[i]));
+    EXPECT_TRUE(tree.verifyPath(absent[i], false, proof, root));
+    EXPECT_FALSE(tree.verifyPath(absent[i], true, proof, root));
+  }
+  EXPECT_TRUE(saw_empty);
+  EXPECT_TRUE(saw_other);
+
+  // A member's leaf is not a non-membership proof for that member.
+  std::vector<std::string> forged = tree.generateProof(set[0]);
+  forged[0] = std::string(1, '\x00');
+  EXPECT_FALSE(tree.verifyPath(set[0], false, forged, root));
+}
+
+TEST_F(SparseQTreeTest, RootDependsOnlyOnTheSetBits) {
+  const std::vector<std::string> set = Addresses("order_", 120);
+
+  SparseQTree batched;
+  batched.setHashThreads(4);
+  batched.initialize({});
+  batched.updateBits(set, true);
+
+  SparseQTree reversed;
+  reversed.initialize({});
+  for (size_t i = set.size(); i > 0; --i) {
+    reversed.updateBit(set[i - 1], true);
+  }
+  EXPECT_EQ(batched.getRootHash(), reversed.getRootHash());
+
+  // Removing keys collapses the tree back to the shape of the smaller set.
+  SparseQTree half;
+  half.initialize({});
+  half.updateBits(std::vector<std::string>(set.begin(), set.begin() + 60),
+                  true);
+  batched.updateBits(std::vector<std::string>(set.begin() + 60, set.end()),
+                     false);
+  EXPECT_EQ(batched.size(), 60u);
+  EXPECT_EQ(batched.getRootHash(), half.getRootHash());
+
+  batched.updateBits(std::vector<std::string>(set.begin(), set.begin() + 60),
+                     false);
+  EXPECT_EQ(batched.getRootHash(), std::string(32, '\0'));
+}
+
+TEST_F(SparseQTreeTest, ProofsAreCompressedAndMemoryTracksSetBits) {
+  SparseQTree tree;
+  tree.initialize({});
+  tree.updateBits(Addresses("small_", 16), true);
+  const size_t small_memory = tree.memoryBytes();
+
+  tree.updateBits(Addresses("large_", 4096), true);
+  EXPECT_GT(tree.memoryBytes(), small_memory);
+
+  // About log2(4112) non-empty siblings out of a 256-level address space.
+  const std::vector<std::string> proof = tree.generateProof("large_7");
+  EXPECT_LT(proof.size(), 2u + 32u);
+  EXPECT_TRUE(
+      tree.verifyPath("large_7", true, proof, tree.getRootHash()));
+
+  std::vector<std::string> truncated(proof.begin(), proof.end() - 1);
+  EXPECT_FALSE(
+      tree.verifyPath("large_7", true, truncated, tree.getRootHash()));
+}
+
+TEST_F(SparseQTreeTest, MultiProofCoversMembersAndNonMembers) {
+  SparseQTree tree;
+  tree.initialize({});
+  const std::vector<std::string> set = Addresses("multi_", 500);
+  tree.updateBits(set, true);
+  const std::string root = tree.getRootHash();
+
+  std::vector<std::string> addresses(set.begin(), set.begin() + 40);
+  std::vector<bool> bits(addresses.size(), true);
+  const std::vector<std::string> absent = Addresses("multi_absent_", 10);
+  addresses.insert(addresses.end(), absent.begin(), absent.end());
+  bits.resize(addresses.size(), false);
+
+  const std::string proof = tree.generateMultiProof(addresses);
+  EXPECT_TRUE(tree.verifyMultiProof(addresses, bits, proof, root));
+
+  size_t separate = 0;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    const std::vector<std::string> path = tree.generateProof(addresses[i]);
+    for (size_t p = 0; p < path.size(); ++p) {
+      separate += path[p].size();
+    }
+  }
+  EXPECT_LT(proof.size(), separate);
+
+  std::vector<bool> flipped = bits;
+  flipped[0] = false;
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, flipped, proof, root));
+  flipped = bits;
+  flipped.back() = true;
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, flipped, proof, root));
+
+  std::vector<std::string> fewer(addresses.begin() + 1, addresses.end());
+  std::vector<bool> fewer_bits(bits.begin() + 1, bits.end());
+  EXPECT_FALSE(tree.verifyMultiProof(fewer, fewer_bits, proof, root));
+  EXPECT_FALSE(tree.verifyMultiProof(addresses, bits,
+                                     proof.substr(0, proof.size() - 1), root));
+}
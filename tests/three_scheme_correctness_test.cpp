@@ -343,7 +343,7 @@ LargeScaleWorkload buildLargeScaleWorkload(size_t update_count, uint32_t seed) {
 
 class NomosHarness {
  public:
-  explicit NomosHarness(const std::vector<UpdateCase>& updates) {
+  NomosHarness(const std::vector<UpdateCase>& updates, size_t search_threads) {
     if (m_gatekeeper.setup(10) != 0) {
       throw std::runtime_error("Nomos gatekeeper setup failed");
     }
@@ -351,6 +351,7 @@ class NomosHarness {
       throw std::runtime_error("Nomos client setup failed");
     }
     m_server.setup(m_gatekeeper.getKm());
+    m_server.setSearchThreads(search_threads);
 
     for (size_t i = 0; i < updates.size(); ++i) {
       const nomos::OP op = updates[i].is_add ? nomos::OP_ADD : nomos::OP_DEL;
@@ -382,7 +383,8 @@ class NomosHarness {
 
 class McOdxtHarness {
  public:
-  explicit McOdxtHarness(const std::vector<UpdateCase>& updates) {
+  McOdxtHarness(const std::vector<UpdateCase>& updates,
+                size_t search_threads) {
     if (m_gatekeeper.setup(10) != 0) {
       throw std::runtime_error("MC-ODXT gatekeeper setup failed");
     }
@@ -390,6 +392,7 @@ class McOdxtHarness {
       throw std::runtime_error("MC-ODXT client setup failed");
     }
     m_server.setup(m_gatekeeper.getKm());
+    m_server.setSearchThreads(search_threads);
 
     for (size_t i = 0; i < updates.size(); ++i) {
       const mcodxt::OpType op =
@@ -423,7 +426,7 @@ class McOdxtHarness {
 class VQNomosHarness {
  public:
   VQNomosHarness(const std::vector<UpdateCase>& updates,
-                 size_t qtree_capacity) {
+                 size_t qtree_capacity, size_t search_threads) {
     if (m_gatekeeper.setup(10, qtree_capacity) != 0) {
       throw std::runtime_error("VQNomos gatekeeper setup failed");
     }
@@ -433,6 +436,7 @@ class VQNomosHarness {
       throw std::runtime_error("VQNomos client setup failed");
     }
     m_server.setup(m_gatekeeper.getKm(), initial_anchor, qtree_capacity);
+    m_server.setSearchThreads(search_threads);
 
     for (size_t i = 0; i < updates.size(); ++i) {
       const vqnomos::OP op =
@@ -466,10 +470,11 @@ class VQNomosHarness {
 
 void expectAllSchemesMatch(const std::vector<UpdateCase>& updates,
                            const std::vector<QueryExpectation>& expectations,
-                           size_t qtree_capacity = 1024) {
-  NomosHarness nomos(updates);
-  McOdxtHarness mc_odxt(updates);
-  VQNomosHarness vqnomos(updates, qtree_capacity);
+                           size_t qtree_capacity = 1024,
+                           size_t search_threads = 1) {
+  NomosHarness nomos(updates, search_threads);
+  McOdxtHarness mc_odxt(updates, search_threads);
+  VQNomosHarness vqnomos(updates, qtree_capacity, search_threads);
 
   for (size_t query_index = 0; query_index < expectations.size();
        ++query_index) {
@@ -581,3 +586,10 @@ TEST_F(ThreeSchemeCorrectnessTest, LargeScale1000UpdatesAllSchemesAgree) {
   expectAllSchemesMatch(workload.updates, workload.expectations,
                         workload.qtree_capacity);
 }
+
+TEST_F(ThreeSchemeCorrectnessTest, ParallelServerSearchMatchesReference) {
+  // Slot-parallel server search must not change any scheme's result set.
+  const LargeScaleWorkload workload = buildLargeScaleWorkload(1000, 7);
+  expectAllSchemesMatch(workload.updates, workload.expectations,
+                        workload.qtree_capacity, 4);
+}
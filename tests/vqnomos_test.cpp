@@ -62,6 +62,117 @@ TEST_F(VQNomosTest, MultiKeywordSearchVerifiesAndReturnsIntersection) {
   EXPECT_EQ(result.ids[0], "doc1");
 }
 
+TEST_F(VQNomosTest, ConfigurableEllAndKVerify) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10, 1024, 6, 3), 0);
+
+  const Anchor initial_anchor = gatekeeper.getCurrentAnchor();
+  Client client;
+  ASSERT_EQ(
+      client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, 1024, 10), 0);
+
+  Server server;
+  server.setup(gatekeeper.getKm(), initial_anchor, 1024);
+
+  const UpdateMetadata first = gatekeeper.update(OP_ADD, "doc1", "crypto");
+  EXPECT_EQ(first.xtags.size(), 6u);
+  server.update(first);
+  server.update(gatekeeper.update(OP_ADD, "doc1", "security"));
+  server.update(gatekeeper.update(OP_ADD, "doc2", "security"));
+  server.update(gatekeeper.update(OP_ADD, "doc3", "crypto"));
+
+  const std::vector<std::string> query = {"crypto", "security"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  EXPECT_EQ(token.ell, 6);
+  ASSERT_EQ(token.beta_indices.size(), 3u);
+
+  const SearchRequest request = client.prepareSearch(token, token_request);
+  const SearchResponse response = server.search(request, token);
+  const VerificationResult result =
+      client.decryptAndVerify(response, token, token_request);
+
+  ASSERT_TRUE(result.accepted);
+  ASSERT_EQ(result.ids.size(), 1u);
+  EXPECT_EQ(result.ids[0], "doc1");
+}
+
+TEST_F(VQNomosTest, UpdateBatchAdvancesVersionOnceAndVerifies) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10, 1024), 0);
+  gatekeeper.setUpdateThreads(4);
+
+  const Anchor initial_anchor = gatekeeper.getCurrentAnchor();
+  Client client;
+  ASSERT_EQ(
+      client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, 1024, 10), 0);
+
+  Server server;
+  server.setup(gatekeeper.getKm(), initial_anchor, 1024);
+  server.setUpdateThreads(4);
+
+  std::vector<UpdateRequest> requests;
+  for (int doc_i = 0; doc_i < 40; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    requests.push_back(UpdateRequest(OP_ADD, doc_id, "crypto"));
+    if (doc_i % 5 == 0) {
+      requests.push_back(UpdateRequest(OP_ADD, doc_id, "security"));
+    }
+  }
+  const std::vector<UpdateMetadata> metas = gatekeeper.updateBatch(requests);
+  ASSERT_EQ(metas.size(), requests.size());
+  EXPECT_EQ(metas.front().anchor.version, initial_anchor.version + 1);
+  EXPECT_EQ(metas.back().anchor.root_hash, metas.front().anchor.root_hash);
+  EXPECT_EQ(gatekeeper.getUpdateCount("security"), 8);
+  server.updateBatch(metas);
+
+  const std::vector<std::string> query = {"crypto", "security"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const SearchRequest request = client.prepareSearch(token, token_request);
+  const SearchResponse response = server.search(request, token);
+  const VerificationResult result =
+      client.decryptAndVerify(response, token, token_request);
+
+  ASSERT_TRUE(result.accepted);
+  EXPECT_EQ(result.ids.size(), 8u);
+}
+
+TEST_F(VQNomosTest, SparseQTreeSearchVerifies) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10, 0), 0);
+
+  const Anchor initial_anchor = gatekeeper.getCurrentAnchor();
+  Client client;
+  ASSERT_EQ(
+      client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, 0, 10), 0);
+
+  Server server;
+  server.setup(gatekeeper.getKm(), initial_anchor, 0);
+
+  for (int doc_i = 0; doc_i < 30; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "crypto"));
+    if (doc_i % 3 == 0) {
+      server.update(gatekeeper.update(OP_ADD, doc_id, "security"));
+    }
+  }
+
+  const std::vector<std::string> query = {"security", "crypto"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const SearchRequest request = client.prepareSearch(token, token_request);
+  const SearchResponse response = server.search(request, token);
+  const VerificationResult result =
+      client.decryptAndVerify(response, token, token_request);
+
+  ASSERT_TRUE(result.accepted);
+  EXPECT_EQ(result.ids.size(), 10u);
+}
+
 TEST_F(VQNomosTest, CollisionOnlyQTreeHitDoesNotProduceFalseRejection) {
   Gatekeeper gatekeeper;
   ASSERT_EQ(gatekeeper.setup(10, 1), 0);
@@ -150,6 +261,46 @@ TEST_F(VQNomosTest, TamperedQTreeWitnessIsRejected) {
   EXPECT_FALSE(result.accepted);
 }
 
+TEST_F(VQNomosTest, TamperedQTreeMultiproofIsRejected) {
+  Gatekeeper gatekeeper;
+  ASSERT_EQ(gatekeeper.setup(10, 1024), 0);
+
+  const Anchor initial_anchor = gatekeeper.getCurrentAnchor();
+  Client client;
+  ASSERT_EQ(
+      client.setup(gatekeeper.getPublicKeyPem(), initial_anchor, 1024, 10), 0);
+
+  Server server;
+  server.setup(gatekeeper.getKm(), initial_anchor, 1024);
+
+  for (int doc_i = 0; doc_i < 12; ++doc_i) {
+    const std::string doc_id = "doc" + std::to_string(doc_i);
+    server.update(gatekeeper.update(OP_ADD, doc_id, "crypto"));
+    server.update(gatekeeper.update(OP_ADD, doc_id, "security"));
+  }
+
+  const std::vector<std::string> query = {"crypto", "security"};
+  const TokenRequest token_request =
+      client.genToken(query, gatekeeper.getUpdateCounts());
+  const SearchToken token = gatekeeper.genToken(token_request);
+  const SearchRequest request = client.prepareSearch(token, token_request);
+  SearchResponse response = server.search(request, token);
+  ASSERT_TRUE(client.decryptAndVerify(response, token, token_request).accepted);
+
+  // Set-bit witnesses rely on the shared multiproof alone.
+  for (size_t p = 0; p < response.relation_proofs.size(); ++p) {
+    const QualificationProof& qualification =
+        response.relation_proofs[p].qualification;
+    for (size_t w = 0; w < qualification.witnesses.size(); ++w) {
+      EXPECT_TRUE(qualification.witnesses[w].path.empty());
+    }
+  }
+  ASSERT_FALSE(response.qtree_multiproof.empty());
+  response.qtree_multiproof[response.qtree_multiproof.size() - 1] ^= 1;
+  EXPECT_FALSE(
+      client.decryptAndVerify(response, token, token_request).accepted);
+}
+
 TEST_F(VQNomosTest, MissingMerkleAuthForPositiveProofIsRejected) {
   Gatekeeper gatekeeper;
   ASSERT_EQ(gatekeeper.setup(10, 1024), 0);
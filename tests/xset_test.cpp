@@ -0,0 +1,76 @@
+#include "core/XSet.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+TEST(XSetTest, InsertedXtagsAreMembers) {
+  core::XSet xset;
+  for (int i = 0; i < 1000; ++i) {
+    xset.insert("xtag-" + std::to_string(i));
+  }
+  EXPECT_EQ(xset.size(), 1000u);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(xset.contains("xtag-" + std::to_string(i)));
+  }
+}
+
+TEST(XSetTest, AbsentXtagsAreRejected) {
+  core::XSet with_filter(true);
+  core::XSet without_filter(false);
+  for (int i = 0; i < 2000; ++i) {
+    with_filter.insert("member-" + std::to_string(i));
+    without_filter.insert("member-" + std::to_string(i));
+  }
+  for (int i = 0; i < 2000; ++i) {
+    EXPECT_FALSE(with_filter.contains("absent-" + std::to_string(i)));
+    EXPECT_FALSE(without_filter.contains("absent-" + std::to_string(i)));
+  }
+}
+
+TEST(XSetTest, DuplicateInsertDoesNotGrowSet) {
+  core::XSet xset;
+  xset.insert("same");
+  xset.insert("same");
+  EXPECT_EQ(xset.size(), 1u);
+  EXPECT_FALSE(core::XSet().contains("same"));
+}
+
+TEST(XSetTest, ReservedSetStaysNearSixteenBytesPerXtag) {
+  const size_t count = 100000;
+  core::XSet xset(false);
+  xset.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    xset.insert("xtag-" + std::to_string(i));
+  }
+  EXPECT_LE(xset.memoryBytes() / count, 20u);
+}
+
+TEST(XSetTest, SerializeRoundTripPreservesMembership) {
+  core::XSet original;
+  for (int i = 0; i < 300; ++i) {
+    original.insert("round-" + std::to_string(i));
+  }
+
+  const std::string bytes = original.serialize();
+  EXPECT_EQ(bytes.size(), 4u + 8u + 300u * 16u);
+
+  const core::XSet restored = core::XSet::Deserialize(bytes);
+  EXPECT_EQ(restored.size(), original.size());
+  for (int i = 0; i < 300; ++i) {
+    EXPECT_TRUE(restored.contains("round-" + std::to_string(i)));
+  }
+  EXPECT_FALSE(restored.contains("round-300"));
+}
+
+TEST(XSetTest, DeserializeRejectsMalformedInput) {
+  EXPECT_THROW(core::XSet::Deserialize("NXS"), std::runtime_error);
+  EXPECT_THROW(
+      core::XSet::Deserialize(std::string("XXXX") + std::string(8, '\0')),
+      std::runtime_error);
+
+  std::string truncated = core::XSet().serialize();
+  truncated[11] = 1;  // claims one fingerprint but carries none
+  EXPECT_THROW(core::XSet::Deserialize(truncated), std::runtime_error);
+}